@@ -209,7 +209,8 @@ bool Calibration::key_press_event(int key, int modifiers) {
         double fx, fy, cx, cy, skew;
         Matrix33 R;
         Vector3D t;
-        bool success = calibration(points_3d_, points_2d_, fx, fy, cx, cy, skew, R, t);
+        double rms;
+        bool success = calibration(points_3d_, points_2d_, fx, fy, cx, cy, skew, R, t, true, &rms);
         if (success) {
             mat3 RR(R(0, 0), R(0, 1), R(0, 2),
                     R(1, 0), R(1, 1), R(1, 2),
@@ -35,6 +35,22 @@ class Calibration : public easy3d::Viewer
 public:
     Calibration(const std::string& title, const std::string& model_file);
 
+    /// Calibrates a camera from 3D-2D correspondences. It doesn't touch the viewer state, so it can also be called
+    /// without creating a window (e.g., from the batch calibration tool).
+    /// If verbose is false, nothing is written to std::cout or std::cerr, so it can run concurrently in many threads.
+    /// The result is only validated on request: if rms is not null, the 3D points are projected with the recovered
+    /// parameters, and rms returns the root mean square reprojection error (in pixels).
+    static bool calibration(
+            const std::vector<easy3d::Vector3D>& points_3d,
+            const std::vector<easy3d::Vector2D>& points_2d,
+            double& fx, double& fy,
+            double& cx, double& cy,
+            double& skew,
+            easy3d::Matrix33& R,
+            easy3d::Vector3D& t,
+            bool verbose = true,
+            double* rms = nullptr);
+
 protected:
     bool open() override;
     std::string usage() const override ;
@@ -44,15 +60,6 @@ protected:
 
     void create_cameras_drawable();
 
-    bool calibration(
-            const std::vector<easy3d::Vector3D>& points_3d,
-            const std::vector<easy3d::Vector2D>& points_2d,
-            double& fx, double& fy,
-            double& cx, double& cy,
-            double& skew,
-            easy3d::Matrix33& R,
-            easy3d::Vector3D& t);
-
 private:
     std::vector<easy3d::Vector3D>  points_3d_;
     std::vector<easy3d::Vector2D>  points_2d_;
@@ -27,6 +27,20 @@
 #define EASY3D_CORE_MATRIX_H
 
 #include <vector>
+#include <thread>
+#include <type_traits>
+
+// The AVX2/FMA kernel of gemm_blocked() is always used if the compiler targets these instructions (e.g., -mavx2 -mfma
+// or -march=native). Otherwise, GCC and Clang compile it for x86 CPUs anyway, and it is chosen at runtime if the CPU
+// supports them.
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define EASY3D_GEMM_AVX2
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define EASY3D_GEMM_AVX2
+#define EASY3D_GEMM_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 #include "./vector.h"
 
@@ -34,11 +48,14 @@
 namespace easy3d {
 
 
-    class Matrix33;
+    template <int R, int C>
+    class FixedMatrix;
 
-    class Matrix44;
+    template <typename E>
+    class MatrixExpression;
 
-    class Matrix34;
+    template <typename E>
+    class MatrixTranspose;
 
 
     // -----------------------------------------------------------------------------------------------------------
@@ -59,6 +76,13 @@ namespace easy3d {
          */
         Matrix(const Matrix &A);
 
+        /**
+         * Move constructor. It takes over the storage of A (leaving A empty) instead of copying it, unless the
+         * elements of A are stored inline (i.e., A is a FixedMatrix), in which case they are copied.
+         * @param A Input matrix.
+         */
+        Matrix(Matrix &&A);
+
         /**
          * Construct a matrix by specifying its dimension (i.e., number of rows and number of columns) and initialize
          * all entries to zero.
@@ -92,14 +116,13 @@ namespace easy3d {
          */
         Matrix(int rows, int cols, const double *array);
 
-        /// Constructs a matrix from a 3 by 3 matrix.
-        Matrix(const Matrix33 &rhs);
-
-        /// Constructs a matrix from a 4 by 4 matrix.
-        Matrix(const Matrix44 &rhs);
-
-        /// Constructs a matrix from a 3 by 4 matrix.
-        Matrix(const Matrix34 &rhs);
+        /**
+         * Construct a matrix by evaluating a matrix expression, e.g., Matrix C = A * B + D. The expression is evaluated
+         * row by row directly into the new matrix.
+         * @param expr The expression.
+         */
+        template <typename E>
+        Matrix(const MatrixExpression<E> &expr);
 
         /// Create an identity matrix (i.e., all elements on the diagonal have a value of 1).
         /// @note This function also allow to set the elements on the diagonal to have values other than 1.
@@ -109,6 +132,11 @@ namespace easy3d {
 
         /// Assign A to this matrix
         Matrix &operator=(const Matrix &A);    // overload evaluate operator = from matrix to matrix
+        /// Move A to this matrix (see the move constructor)
+        Matrix &operator=(Matrix &&A);
+        /// Evaluate the expression expr into this matrix (reusing its storage if possible)
+        template <typename E>
+        Matrix &operator=(const MatrixExpression<E> &expr);
         /// Assign x to every entry of this matrix
         Matrix &operator=(double x);            // overload evaluate operator = from scalar to matrix
 
@@ -144,7 +172,12 @@ namespace easy3d {
         /// Return the number of columns.
         int cols() const;
 
-        /// Change the size/dimension of the matrix.
+        /// Change the size/dimension of the matrix. The storage is reused (i.e., no reallocation) if it is large
+        /// enough for the new size, so a matrix that is repeatedly resized (e.g., the result of mult_into() in a loop)
+        /// only allocates memory when it grows.
+        /// \attention The values of the elements are undefined after resizing.
+        /// \attention Growing a FixedMatrix beyond R * C elements moves its elements to the heap. This is allowed for
+        ///     compatibility, but the fixed-size operators assume a FixedMatrix keeps its size.
         Matrix &resize(int rows, int cols);
 
         /// Get the matrix's row vector as a 1D array.
@@ -172,8 +205,8 @@ namespace easy3d {
         /// @note This function also allow to set the elements on the diagonal to have values other than 1.
         void load_identity(double v = 1.0);
 
-        /// Return the transposed matrix.
-        Matrix transpose() const;
+        /// Return the transposed matrix. It is an expression, which is evaluated when assigned to a matrix.
+        MatrixTranspose<Matrix> transpose() const;
 
         /// Return the trace of this matrix, i.e. the sum of the coefficients on the main diagonal.
         /// @note: the matrix can be of any dimension, not necessarily square.
@@ -199,18 +232,28 @@ namespace easy3d {
 
     private:
 
-        // 0-based data pointer
+        // 0-based data pointer (row-major, so the row_th row starts at data_ + row * nColumn_)
         double *data_;
 
-        // 0-based row pointer's pointer
-        double **prow_;
-
         // row number, column number and total number
         int nRow_;
         int nColumn_;
         long nTotal_;
 
+        // the number of elements the storage can hold, i.e., nTotal_ <= nCapacity_
+        long nCapacity_;
+
+        // false if data_ points to an external buffer (e.g., the inline storage of a FixedMatrix)
+        bool owns_data_;
+
+        // true if the storage comes from a MemoryArena (see ArenaScope)
+        bool in_arena_;
+
     protected:
+        /// Constructs a rows by cols matrix on an external buffer of at least (rows * cols) elements. The buffer is
+        /// neither initialized nor freed by the matrix. This allows FixedMatrix to store its elements inline.
+        Matrix(double *buffer, int rows, int cols);
+
         void init(int rows, int cols);
 
         void copy_from_array(const double *v); // copy matrix from normal array
@@ -224,70 +267,300 @@ namespace easy3d {
     // -----------------------------------------------------------------------------------------------------------
 
 
-    /// A class for 3 by 3 matrices
-    class Matrix33 : public Matrix {
+    /// A class for R by C matrices whose dimension is known at compile time, e.g., 3 by 3 rotations and 3 by 4
+    /// projection matrices. The elements are stored inline (i.e., constructing, copying, and destroying it never
+    /// allocates memory), and it can be used wherever a general Matrix is expected.
+    template <int R, int C>
+    class FixedMatrix : public Matrix {
     public:
-        /// Constructor a 3 by 3 matrix.
-        Matrix33(double s00 = 0.0, double s01 = 0.0, double s02 = 0.0,
-                 double s10 = 0.0, double s11 = 0.0, double s12 = 0.0,
-                 double s20 = 0.0, double s21 = 0.0, double s22 = 0.0
-        );
+        /// Construct an R by C matrix with all elements initialized to zero.
+        FixedMatrix();
+
+        /// Construct an R by C matrix from its first elements in row-major order, e.g., Matrix33(s00, s01, s02,
+        /// s10, s11, s12, s20, s21, s22). The remaining elements are initialized to zero.
+        template <typename... FT>
+        FixedMatrix(double s00, FT... others);
+
+        /// Copy constructor.
+        FixedMatrix(const FixedMatrix &rhs);
+
+        /// Construct an R by C matrix from the top-left sub-matrix of general matrix.
+        /// \attention the input matrix must have at least R rows and C columns.
+        FixedMatrix(const Matrix &m);
 
-        /// Construct a 3 by 3 matrix from the top-left sub-matrix of general matrix.
-        /// \attention the input matrix must have at least 3 rows and 3 columns.
-        Matrix33(const Matrix &m);
+        /// Construct an R by C matrix by evaluating (the top-left sub-matrix of) a matrix expression.
+        /// \attention the expression must have at least R rows and C columns.
+        template <typename E>
+        FixedMatrix(const MatrixExpression<E> &expr);
 
-        /// Create a 3 by 4 identity matrix (i.e., all elements on the diagonal have a value of 1).
+        /// Assign rhs to this matrix.
+        FixedMatrix &operator=(const FixedMatrix &rhs);
+
+        /// Create an R by C identity matrix (i.e., all elements on the diagonal have a value of 1).
         /// @note This function also allow to set the elements on the diagonal to have values other than 1.
-        static Matrix33 identity(double v = 1.0);
+        static FixedMatrix identity(double v = 1.0);
+
+        /// Return the transposed matrix.
+        FixedMatrix<C, R> transpose() const;
+
+    private:
+        double elements_[R * C];
     };
 
 
+    /// A class for 3 by 3 matrices
+    typedef FixedMatrix<3, 3> Matrix33;
+
+    /// A class for 4 by 4 matrices
+    typedef FixedMatrix<4, 4> Matrix44;
+
+    /// A class for 3 by 4 matrices
+    typedef FixedMatrix<3, 4> Matrix34;
+
+
+    // -----------------------------------------------------------------------------------------------------------
+    //
+    // Expression templates. The matrix-matrix and matrix-scalar operators (+, -, *, /) and transpose don't compute
+    // their results immediately. They return light-weight expressions that refer to their operands, and a whole chain
+    // (e.g., T1.transpose() * F * T0) is evaluated row by row when it is assigned to (or converted to) a matrix. So no
+    // intermediate matrix is created: a row of a product is computed from the same row of its left operand, and only a
+    // buffer for a single row is needed (which is on the stack for up to 16 columns).
+    // Expressions convert to Matrix implicitly, so they can be passed to any function taking a const Matrix&.
+    //
+    // \attention An expression refers to its operands, so it must be evaluated before they are destroyed, i.e.,
+    //     assign it to a Matrix instead of storing it (e.g., with auto).
+    //
     // -----------------------------------------------------------------------------------------------------------
 
 
-    /// A class for 4 by 4 matrices
-    class Matrix44 : public Matrix {
+    /// The base class of all matrix expressions. E is the actual expression (the curiously recurring template pattern).
+    template <typename E>
+    class MatrixExpression {
     public:
-        /// Constructor a 4 by 4 matrix.
-        Matrix44(double s00 = 0.0, double s01 = 0.0, double s02 = 0.0, double s03 = 0.0,
-                 double s10 = 0.0, double s11 = 0.0, double s12 = 0.0, double s13 = 0.0,
-                 double s20 = 0.0, double s21 = 0.0, double s22 = 0.0, double s23 = 0.0,
-                 double s30 = 0.0, double s31 = 0.0, double s32 = 0.0, double s33 = 0.0
-        );
-
-        /// Construct a 4 by 4 matrix from the top-left sub-matrix of general matrix.
-        /// \attention the input matrix must have at least 4 rows and 4 columns.
-        Matrix44(const Matrix &m);
-
-        /// Create a 4 by 4 identity matrix (i.e., all elements on the diagonal have a value of 1).
-        /// @note This function also allow to set the elements on the diagonal to have values other than 1.
-        static Matrix44 identity(double v = 1.0);
+        /// The actual expression.
+        const E &derived() const { return static_cast<const E &>(*this); }
+
+        /// Return the number of rows.
+        int rows() const { return derived().rows(); }
+
+        /// Return the number of columns.
+        int cols() const { return derived().cols(); }
+
+        /// Return the element at (row, col). Elements of products are computed on every call, so evaluate the
+        /// expression into a matrix instead of reading many elements this way.
+        double operator()(int row, int col) const { return derived().coeff(row, col); }
     };
 
 
-    // -----------------------------------------------------------------------------------------------------------
+    namespace details {
+
+        /// True for matrices (including fixed-size ones) and matrix expressions.
+        template <typename T>
+        struct is_matrix_expression {
+            static const bool value = std::is_base_of<Matrix, T>::value || std::is_base_of<MatrixExpression<T>, T>::value;
+        };
+
+        /// The type representing an operand in an expression, i.e., Matrix for all matrices and the expression itself
+        /// otherwise.
+        template <typename T, bool = std::is_base_of<Matrix, T>::value>
+        struct operand_type { typedef T type; };
+
+        template <typename T>
+        struct operand_type<T, true> { typedef Matrix type; };
+
+        /// How an operand is stored in an expression: matrices by reference, expressions (which are small) by value.
+        template <typename T>
+        struct operand_storage { typedef const T type; };
+
+        template <>
+        struct operand_storage<Matrix> { typedef const Matrix &type; };
+
+        /// The expression resulting from a binary operation (if both operands are matrices or matrix expressions).
+        template <typename L, typename R, template <typename, typename> class Node>
+        struct binary_expression
+                : std::enable_if<is_matrix_expression<L>::value && is_matrix_expression<R>::value,
+                        Node<typename operand_type<L>::type, typename operand_type<R>::type> > {
+        };
+
+        /// The expression resulting from a unary operation (if the operand is a matrix or a matrix expression).
+        template <typename E, template <typename> class Node>
+        struct unary_expression
+                : std::enable_if<is_matrix_expression<E>::value, Node<typename operand_type<E>::type> > {
+        };
+
+        /// A buffer for a row of an expression. Short rows (e.g., of 3 by 3 and 4 by 4 matrices) stay on the stack.
+        class RowBuffer {
+        public:
+            RowBuffer() {}
+            RowBuffer(const RowBuffer &) {}  // the content is scratch and never copied
+            double *get(int n);
+
+        private:
+            enum { kStackSize = 16 };
+            double stack_[kStackSize];
+            std::vector<double> heap_;
+        };
+
+        /// Evaluates the rows and elements of an operand. Elements are cheap to access unless the operand contains a
+        /// product.
+        template <typename E>
+        struct evaluator {
+            static const bool cheap_coeff = E::cheap_coeff;
+            static void row(const E &e, int r, double *out) { e.eval_row(r, out); }
+            static const double *row_ptr(const E &e, int r, RowBuffer &buffer);
+            static double coeff(const E &e, int r, int c) { return e.coeff(r, c); }
+            static void axpy_row(const E &e, int r, double a, double *out); // out += a * (the r_th row of e)
+            static bool references(const E &e, const Matrix &m) { return e.references(m); }
+        };
+
+        template <>
+        struct evaluator<Matrix> {
+            static const bool cheap_coeff = true;
+            static void row(const Matrix &e, int r, double *out);
+            static const double *row_ptr(const Matrix &e, int r, RowBuffer &) { return e[r]; }
+            static double coeff(const Matrix &e, int r, int c) { return e(r, c); }
+            static void axpy_row(const Matrix &e, int r, double a, double *out);
+            static bool references(const Matrix &e, const Matrix &m) { return e.data() && e.data() == m.data(); }
+        };
+
+        /// Element access to the right operand of a product or the operand of a transpose. An operand containing a
+        /// product would compute each of its elements many times, so it is evaluated into a matrix (once) instead.
+        template <typename E, bool cheap = evaluator<E>::cheap_coeff>
+        class CoeffAccess {
+        public:
+            CoeffAccess(const E &e) : e_(e) {}
+            const E &expression() const { return e_; }
+            int rows() const { return e_.rows(); }
+            int cols() const { return e_.cols(); }
+            double operator()(int r, int c) const { return evaluator<E>::coeff(e_, r, c); }
+            void axpy_row(int r, double a, double *out) const { evaluator<E>::axpy_row(e_, r, a, out); }
+            bool references(const Matrix &m) const { return evaluator<E>::references(e_, m); }
+
+        private:
+            typename operand_storage<E>::type e_;
+        };
+
+        template <typename E>
+        class CoeffAccess<E, false> {
+        public:
+            CoeffAccess(const E &e) : e_(e), evaluated_(false) {}
+            CoeffAccess(const CoeffAccess &other) : e_(other.e_), evaluated_(false) {}
+            const E &expression() const { return e_; }
+            int rows() const { return e_.rows(); }
+            int cols() const { return e_.cols(); }
+            double operator()(int r, int c) const { return value()(r, c); }
+            void axpy_row(int r, double a, double *out) const { evaluator<Matrix>::axpy_row(value(), r, a, out); }
+            bool references(const Matrix &m) const { return evaluator<E>::references(e_, m); }
+
+        private:
+            const Matrix &value() const;
+
+            typename operand_storage<E>::type e_;
+            mutable Matrix value_;
+            mutable bool evaluated_;
+        };
+
+    } // namespace details
+
+
+    /// The sum (or difference) of two matrix expressions.
+    template <typename L, typename R>
+    class MatrixSum : public MatrixExpression<MatrixSum<L, R> > {
+    public:
+        static const bool cheap_coeff = details::evaluator<L>::cheap_coeff && details::evaluator<R>::cheap_coeff;
 
+        MatrixSum(const L &lhs, const R &rhs, bool subtract = false);
 
-    /// A class for 3 by 4 matrices
-    class Matrix34 : public Matrix {
+        int rows() const { return lhs_.rows(); }
+        int cols() const { return lhs_.cols(); }
+        void eval_row(int r, double *out) const;
+        double coeff(int r, int c) const;
+        bool references(const Matrix &m) const;
+
+    private:
+        typename details::operand_storage<L>::type lhs_;
+        typename details::operand_storage<R>::type rhs_;
+        bool subtract_;
+        mutable details::RowBuffer buffer_;
+    };
+
+
+    /// A matrix expression multiplied (or divided) by a scalar.
+    template <typename E>
+    class MatrixScaled : public MatrixExpression<MatrixScaled<E> > {
     public:
-        /// Constructor a 3 by 4 matrix.
-        Matrix34(double s00 = 0.0, double s01 = 0.0, double s02 = 0.0, double s03 = 0.0,
-                 double s10 = 0.0, double s11 = 0.0, double s12 = 0.0, double s13 = 0.0,
-                 double s20 = 0.0, double s21 = 0.0, double s22 = 0.0, double s23 = 0.0
-        );
+        static const bool cheap_coeff = details::evaluator<E>::cheap_coeff;
 
-        /// Construct a 3 by 4 matrix from the top-left sub-matrix of general matrix.
-        /// \attention the input matrix must have at least 3 rows and 4 columns.
-        Matrix34(const Matrix &m);
+        MatrixScaled(const E &e, double s, bool divide = false);
 
-        /// Create a 3 by 4 identity matrix (i.e., all elements on the diagonal have a value of 1).
-        /// @note This function also allow to set the elements on the diagonal to have values other than 1.
-        static Matrix34 identity(double v = 1.0);
+        int rows() const { return e_.rows(); }
+        int cols() const { return e_.cols(); }
+        void eval_row(int r, double *out) const;
+        double coeff(int r, int c) const;
+        bool references(const Matrix &m) const { return details::evaluator<E>::references(e_, m); }
+
+    private:
+        typename details::operand_storage<E>::type e_;
+        double s_;
+        bool divide_;
     };
 
 
+    /// The product of two matrix expressions.
+    template <typename L, typename R>
+    class MatrixProduct : public MatrixExpression<MatrixProduct<L, R> > {
+    public:
+        static const bool cheap_coeff = false;
+
+        MatrixProduct(const L &lhs, const R &rhs);
+
+        const L &lhs() const { return lhs_; }
+        const R &rhs() const { return rhs_.expression(); }
+
+        int rows() const { return lhs_.rows(); }
+        int cols() const { return rhs_.cols(); }
+        void eval_row(int r, double *out) const;
+        double coeff(int r, int c) const;
+        bool references(const Matrix &m) const;
+
+    private:
+        typename details::operand_storage<L>::type lhs_;
+        details::CoeffAccess<R> rhs_;
+        mutable details::RowBuffer buffer_;
+    };
+
+
+    /// The transpose of a matrix expression.
+    template <typename E>
+    class MatrixTranspose : public MatrixExpression<MatrixTranspose<E> > {
+    public:
+        // an operand containing a product is evaluated once (see CoeffAccess), so the elements are always cheap
+        static const bool cheap_coeff = true;
+
+        MatrixTranspose(const E &e) : e_(e) {}
+
+        int rows() const { return e_.cols(); }
+        int cols() const { return e_.rows(); }
+        void eval_row(int r, double *out) const;
+        double coeff(int r, int c) const { return e_(c, r); }
+        bool references(const Matrix &m) const { return e_.references(m); }
+
+    private:
+        details::CoeffAccess<E> e_;
+    };
+
+
+    namespace details {
+
+        /// Evaluates an expression into the row-major array dst (of the size of the expression), row by row.
+        template <typename E>
+        void evaluate(const E &expr, double *dst);
+
+        /// The product of two matrices is evaluated by gemm(), which is faster for large matrices.
+        void evaluate(const MatrixProduct<Matrix, Matrix> &expr, double *dst);
+    }
+
+
     //------------------------------------------------------------------------------------------------------------------
 
     /// Overload of the output stream.
@@ -298,8 +571,12 @@ namespace easy3d {
 
     //------------------------------------------------------------------------------------------------------------------
 
+    // The operators taking matrices or matrix expressions (see MatrixExpression) return expressions, which are
+    // evaluated when assigned to a matrix.
+
     /// get negative matrix
-    Matrix operator-(const Matrix &);
+    template <typename E>
+    typename details::unary_expression<E, MatrixScaled>::type operator-(const E &);
 
     /// matrix-scalar addition
     Matrix operator+(const Matrix &, double);
@@ -308,7 +585,8 @@ namespace easy3d {
     Matrix operator+(double, const Matrix &);
 
     /// matrix-matrix addition
-    Matrix operator+(const Matrix &, const Matrix &);
+    template <typename L, typename R>
+    typename details::binary_expression<L, R, MatrixSum>::type operator+(const L &, const R &);
 
     /// matrix-scalar subtraction
     Matrix operator-(const Matrix &, double);
@@ -317,19 +595,24 @@ namespace easy3d {
     Matrix operator-(double, const Matrix &);
 
     /// matrix-matrix subtraction
-    Matrix operator-(const Matrix &, const Matrix &);
+    template <typename L, typename R>
+    typename details::binary_expression<L, R, MatrixSum>::type operator-(const L &, const R &);
 
     /// matrix-matrix multiplication
-    Matrix operator*(const Matrix &, const Matrix &);
+    template <typename L, typename R>
+    typename details::binary_expression<L, R, MatrixProduct>::type operator*(const L &, const R &);
 
     /// matrix-scalar multiplication
-    Matrix operator*(const Matrix &, double);
+    template <typename E>
+    typename details::unary_expression<E, MatrixScaled>::type operator*(const E &, double);
 
     /// scalar-matrix multiplication
-    Matrix operator*(double, const Matrix &);
+    template <typename E>
+    typename details::unary_expression<E, MatrixScaled>::type operator*(double, const E &);
 
     /// matrix-scalar division
-    Matrix operator/(const Matrix &, double);
+    template <typename E>
+    typename details::unary_expression<E, MatrixScaled>::type operator/(const E &, double);
 
     /// scalar-matrix division
     Matrix operator/(double, const Matrix &);
@@ -337,6 +620,47 @@ namespace easy3d {
     /// matrix-vector multiplication
     Vector operator*(const Matrix &A, const Vector &b);
 
+    /// matrix-vector multiplication
+    template <typename E>
+    Vector operator*(const MatrixExpression<E> &A, const Vector &b);
+
+    //------------------------------------------------------------------------------------------------------------------
+
+    // The fixed-size overloads below are preferred over the general ones when both operands have a fixed size. They
+    // return fixed-size results, so small-matrix expressions like K * (R * P + t) don't allocate any memory.
+
+    /// get negative matrix
+    template <int R, int C>
+    FixedMatrix<R, C> operator-(const FixedMatrix<R, C> &);
+
+    /// matrix-matrix addition
+    template <int R, int C>
+    FixedMatrix<R, C> operator+(const FixedMatrix<R, C> &, const FixedMatrix<R, C> &);
+
+    /// matrix-matrix subtraction
+    template <int R, int C>
+    FixedMatrix<R, C> operator-(const FixedMatrix<R, C> &, const FixedMatrix<R, C> &);
+
+    /// matrix-matrix multiplication
+    template <int R, int K, int C>
+    FixedMatrix<R, C> operator*(const FixedMatrix<R, K> &, const FixedMatrix<K, C> &);
+
+    /// matrix-scalar multiplication
+    template <int R, int C>
+    FixedMatrix<R, C> operator*(const FixedMatrix<R, C> &, double);
+
+    /// scalar-matrix multiplication
+    template <int R, int C>
+    FixedMatrix<R, C> operator*(double, const FixedMatrix<R, C> &);
+
+    /// matrix-scalar division
+    template <int R, int C>
+    FixedMatrix<R, C> operator/(const FixedMatrix<R, C> &, double);
+
+    /// matrix-vector multiplication
+    template <int R, int C>
+    FixedVector<R> operator*(const FixedMatrix<R, C> &A, const FixedVector<C> &b);
+
     //------------------------------------------------------------------------------------------------------------------
 
     /// matrix-matrix multiplication (result has already been allocated)
@@ -353,8 +677,78 @@ namespace easy3d {
 
     //------------------------------------------------------------------------------------------------------------------
 
+    // The *_into() functions write the result into an existing matrix/vector, which is resized if needed (reusing its
+    // storage). Calling them in a loop with the same destination allocates memory only once.
+
+    /// matrix-matrix addition, i.e., C = A + B. C can be A or B.
+    void add_into(const Matrix &A, const Matrix &B, Matrix &C);
+
+    /// matrix-matrix subtraction, i.e., C = A - B. C can be A or B.
+    void sub_into(const Matrix &A, const Matrix &B, Matrix &C);
+
+    /// matrix-scalar multiplication, i.e., C = A * s. C can be A.
+    void scale_into(const Matrix &A, double s, Matrix &C);
+
+    /// matrix-matrix multiplication, i.e., C = A * B. Large products are computed by a cache-blocked (and, above a
+    /// size threshold, multithreaded) kernel, see details::gemm().
+    /// \attention C must not be A or B.
+    void mult_into(const Matrix &A, const Matrix &B, Matrix &C);
+
+    /// matrix-vector multiplication, i.e., c = A * b.
+    /// \attention c must not be b.
+    void mult_into(const Matrix &A, const Vector &b, Vector &c);
+
+    /// transpose, i.e., T = A^T.
+    /// \attention T must not be A.
+    void transpose_into(const Matrix &A, Matrix &T);
+
+    //------------------------------------------------------------------------------------------------------------------
+
+    namespace details {
+
+        /// Products with at least this many multiply-adds (i.e., M * N * K) use the cache-blocked kernel. Smaller ones
+        /// (e.g., 3 by 3 and 4 by 4) are faster with the plain loop.
+        const long kGemmBlockedThreshold = 8L * 8L * 8L;
+
+        /// Products with at least this many multiply-adds are split among threads (by rows of the result).
+        const long kGemmParallelThreshold = 160L * 160L * 160L;
+
+        /**
+         * C = A * B for row-major arrays, i.e., A is M by K, B is K by N, and C is M by N. The kernel is chosen by the
+         * size of the product: the plain triple loop, the cache-blocked kernel, or the cache-blocked kernel running on
+         * all hardware threads. The multiply-adds of each element are accumulated in the order of k in all cases (so
+         * the results are identical unless the cache-blocked kernel uses FMA instructions, see gemm_has_avx2()).
+         * \attention C must not overlap A or B.
+         */
+        void gemm(const double *A, const double *B, double *C, int M, int N, int K);
+
+        /// The plain triple loop (an inner product per element of C).
+        void gemm_naive(const double *A, const double *B, double *C, int M, int N, int K);
+
+        /**
+         * The cache-blocked kernel. B is processed in panels fitting into the L2 cache and 4 rows of C are updated at
+         * a time from each row of a panel (using AVX2/FMA intrinsics if gemm_has_avx2()). The rows of C are split among
+         * num_threads threads.
+         */
+        void gemm_blocked(const double *A, const double *B, double *C, int M, int N, int K, int num_threads = 1);
+
+        /// Whether gemm_blocked() uses AVX2/FMA instructions, i.e., the compiler targets them, or (with GCC and Clang
+        /// on x86) the CPU supports them.
+        bool gemm_has_avx2();
+
+        /// The number of threads gemm() uses for large products.
+        int gemm_num_threads();
+    }
+
+    //------------------------------------------------------------------------------------------------------------------
+
+    /// transpose
+    template <typename E>
+    typename details::unary_expression<E, MatrixTranspose>::type transpose(const E &);
+
     /// transpose
-    Matrix transpose(const Matrix &);
+    template <int R, int C>
+    FixedMatrix<C, R> transpose(const FixedMatrix<R, C> &);
 
     //------------------------------------------------------------------------------------------------------------------
 
@@ -389,6 +783,7 @@ namespace easy3d {
 #include <algorithm> // for std::min, std::max
 #include <cmath>     // for std::sqrt
 #include <iostream>
+#include <utility>   // for std::move
 
 
 namespace easy3d {
@@ -399,16 +794,10 @@ namespace easy3d {
         nColumn_ = cols;
         nTotal_ = nRow_ * nColumn_;
 
-        data_ = new double[nTotal_];
-        prow_ = new double *[nRow_];
+        data_ = details::allocate_elements(nTotal_, in_arena_);
+        nCapacity_ = nTotal_;
+        owns_data_ = true;
         assert(data_);
-        assert(prow_);
-
-        double *p = data_;
-        for (int i = 0; i < nRow_; ++i) {
-            prow_[i] = p;
-            p += nColumn_;
-        }
     }
 
 
@@ -434,13 +823,13 @@ namespace easy3d {
     * destroy the matrix
     */
     inline void Matrix::destroy() {
-        if (data_ == NULL)
-            return;
-        else
-            delete[] data_;
-
-        if (prow_ != NULL)
-            delete[] prow_;
+        if (owns_data_)
+            details::free_elements(data_, nCapacity_, in_arena_);
+        data_ = NULL;
+        nRow_ = nColumn_ = 0;
+        nTotal_ = nCapacity_ = 0;
+        owns_data_ = false;
+        in_arena_ = false;
     }
 
 
@@ -448,7 +837,12 @@ namespace easy3d {
     * constructors and destructor
     */
     inline Matrix::Matrix()
-            : data_(0), prow_(0), nRow_(0), nColumn_(0), nTotal_(0) {
+            : data_(0), nRow_(0), nColumn_(0), nTotal_(0), nCapacity_(0), owns_data_(false), in_arena_(false) {
+    }
+
+    inline Matrix::Matrix(double *buffer, int rows, int cols)
+            : data_(buffer), nRow_(rows), nColumn_(cols), nTotal_(rows * cols), nCapacity_(rows * cols),
+              owns_data_(false), in_arena_(false) {
     }
 
     inline Matrix::Matrix(const Matrix &A) {
@@ -456,19 +850,9 @@ namespace easy3d {
         copy_from_array(A.data_);
     }
 
-    inline Matrix::Matrix(const Matrix33 &rhs) {
-        init(3, 3);
-        copy_from_array(rhs.data());
-    }
-
-    inline Matrix::Matrix(const Matrix44 &rhs) {
-        init(4, 4);
-        copy_from_array(rhs.data());
-    }
-
-    inline Matrix::Matrix(const Matrix34 &rhs) {
-        init(3, 4);
-        copy_from_array(rhs.data());
+    inline Matrix::Matrix(Matrix &&A)
+            : data_(0), nRow_(0), nColumn_(0), nTotal_(0), nCapacity_(0), owns_data_(false), in_arena_(false) {
+        *this = std::move(A);
     }
 
     inline Matrix::Matrix(int rows, int cols, double x) {
@@ -507,18 +891,43 @@ namespace easy3d {
         if (data_ == A.data_)
             return *this;
 
-        if (nRow_ == A.nRow_ && nColumn_ == A.nColumn_)
-            copy_from_array(A.data_);
-        else {
-            destroy();
-            init(A.nRow_, A.nColumn_);
-            copy_from_array(A.data_);
-        }
+        resize(A.nRow_, A.nColumn_);
+        copy_from_array(A.data_);
 
         return *this;
     }
 
 
+    /**
+    * move A to this matrix
+    */
+    inline Matrix &Matrix::operator=(Matrix &&A) {
+        if (this == &A)
+            return *this;
+
+        // Only heap (or arena) storage can be taken over, and an external buffer (e.g., the inline storage of a
+        // FixedMatrix) must stay in use. Storage from the arena is not taken by a matrix on the heap (or vice versa),
+        // which would outlive it. All these cases fall back to copying.
+        if (!A.owns_data_ || (data_ != NULL && !owns_data_) ||
+            !details::can_take_elements(data_ != NULL, in_arena_, A.in_arena_))
+            return *this = static_cast<const Matrix &>(A);
+
+        destroy();
+        data_ = A.data_;
+        nRow_ = A.nRow_;
+        nColumn_ = A.nColumn_;
+        nTotal_ = A.nTotal_;
+        nCapacity_ = A.nCapacity_;
+        owns_data_ = true;
+        in_arena_ = A.in_arena_;
+
+        A.data_ = NULL;
+        A.owns_data_ = false;
+        A.destroy();
+        return *this;
+    }
+
+
     /**
     * overload evaluate operator = from scalar to matrix
     */
@@ -534,13 +943,13 @@ namespace easy3d {
     inline double *Matrix::operator[](int row) {
         assert(0 <= row);
         assert(row < nRow_);
-        return prow_[row];
+        return data_ + row * nColumn_;
     }
 
     inline const double *Matrix::operator[](int row) const {
         assert(0 <= row);
         assert(row < nRow_);
-        return prow_[row];
+        return data_ + row * nColumn_;
     }
 
     inline double &Matrix::operator()(int row, int col) {
@@ -548,7 +957,7 @@ namespace easy3d {
         assert(row < nRow_);
         assert(0 <= col);
         assert(col < nColumn_);
-        return prow_[row][col];
+        return data_[row * nColumn_ + col];
     }
 
     inline const double &Matrix::operator()(int row, int col) const {
@@ -556,7 +965,7 @@ namespace easy3d {
         assert(row < nRow_);
         assert(0 <= col);
         assert(col < nColumn_);
-        return prow_[row][col];
+        return data_[row * nColumn_ + col];
     }
 
     inline void Matrix::set(int row, int col, double v) {
@@ -564,7 +973,7 @@ namespace easy3d {
         assert(row < nRow_);
         assert(0 <= col);
         assert(col < nColumn_);
-        prow_[row][col] = v;
+        data_[row * nColumn_ + col] = v;
     }
 
     inline const double &Matrix::get(int row, int col) const {
@@ -572,7 +981,7 @@ namespace easy3d {
         assert(row < nRow_);
         assert(0 <= col);
         assert(col < nColumn_);
-        return prow_[row][col];
+        return data_[row * nColumn_ + col];
     }
 
 
@@ -581,11 +990,7 @@ namespace easy3d {
     * This resets all values to 0 (zero)
     */
     inline void Matrix::load_zero() {
-        for (int i = 0; i < nRow_; i++) {
-            for (int j = 0; j < nColumn_; j++) {
-                prow_[i][j] = 0.0;
-            }
-        }
+        set_by_scalar(0.0);
     }
 
     /**
@@ -596,7 +1001,7 @@ namespace easy3d {
     inline void Matrix::load_identity(double v /* = double(1.0)*/) {
         for (int i = 0; i < nRow_; i++) {
             for (int j = 0; j < nColumn_; j++) {
-                prow_[i][j] = (i == j) ? v : 0.0;
+                data_[i * nColumn_ + j] = (i == j) ? v : 0.0;
             }
         }
     }
@@ -618,6 +1023,13 @@ namespace easy3d {
         if (rows == nRow_ && cols == nColumn_)
             return *this;
 
+        if (static_cast<long>(rows) * cols <= nCapacity_) {
+            nRow_ = rows;
+            nColumn_ = cols;
+            nTotal_ = static_cast<long>(rows) * cols;
+            return *this;
+        }
+
         destroy();
         init(rows, cols);
 
@@ -633,7 +1045,7 @@ namespace easy3d {
         assert(row < nRow_);
         Vector tmp(nColumn_);
         for (int j = 0; j < nColumn_; ++j)
-            tmp[j] = prow_[row][j];
+            tmp[j] = data_[row * nColumn_ + j];
 
         return tmp;
     }
@@ -647,7 +1059,7 @@ namespace easy3d {
         assert(col < nColumn_);
         Vector tmp(nRow_);
         for (int i = 0; i < nRow_; ++i)
-            tmp[i] = prow_[i][col];
+            tmp[i] = data_[i * nColumn_ + col];
 
         return tmp;
     }
@@ -661,7 +1073,7 @@ namespace easy3d {
         assert(row < nRow_);
         assert(v.size() == nColumn_);
         for (int j = 0; j < nColumn_; ++j)
-            prow_[row][j] = v[j];
+            data_[row * nColumn_ + j] = v[j];
     }
 
     inline void Matrix::set_row(int row, const std::vector<double> &v) {
@@ -669,7 +1081,7 @@ namespace easy3d {
         assert(row < nRow_);
         assert(v.size() == nColumn_);
         for (int j = 0; j < nColumn_; ++j)
-            prow_[row][j] = v[j];
+            data_[row * nColumn_ + j] = v[j];
     }
 
 
@@ -681,7 +1093,7 @@ namespace easy3d {
         assert(col < nColumn_);
         assert(v.size() == nRow_);
         for (int i = 0; i < nRow_; ++i)
-            prow_[i][col] = v[i];
+            data_[i * nColumn_ + col] = v[i];
     }
 
     inline void Matrix::set_column(int col, const std::vector<double> &v) {
@@ -689,18 +1101,12 @@ namespace easy3d {
         assert(col < nColumn_);
         assert(v.size() == nRow_);
         for (int i = 0; i < nRow_; ++i)
-            prow_[i][col] = v[i];
+            data_[i * nColumn_ + col] = v[i];
     }
 
 
-    inline Matrix Matrix::transpose() const {
-        Matrix t(nColumn_, nRow_);
-        for (int r = 0; r < nRow_; r++) {
-            for (int c = 0; c < nColumn_; c++) {
-                t(c, r) = (*this)(r, c);
-            }
-        }
-        return t;
+    inline MatrixTranspose<Matrix> Matrix::transpose() const {
+        return MatrixTranspose<Matrix>(*this);
     }
 
 
@@ -717,14 +1123,8 @@ namespace easy3d {
     * compound assignment operators +=
     */
     inline Matrix &Matrix::operator+=(double x) {
-        double **rowPtr = prow_;
-        double *colPtr = 0;
-
-        for (int i = 0; i < nRow_; ++i) {
-            colPtr = *rowPtr++;
-            for (int j = 0; j < nColumn_; ++j)
-                *colPtr++ += x;
-        }
+        for (long i = 0; i < nTotal_; ++i)
+            data_[i] += x;
 
         return *this;
     }
@@ -733,17 +1133,8 @@ namespace easy3d {
         assert(nRow_ == rhs.rows());
         assert(nColumn_ == rhs.cols());
 
-        double **rowPtrL = prow_;
-        double *colPtrL = 0;
-        double **rowPtrR = rhs.prow_;
-        const double *colPtrR = 0;
-
-        for (int i = 0; i < nRow_; ++i) {
-            colPtrL = *rowPtrL++;
-            colPtrR = *rowPtrR++;
-            for (int j = 0; j < nColumn_; ++j)
-                *colPtrL++ += *colPtrR++;
-        }
+        for (long i = 0; i < nTotal_; ++i)
+            data_[i] += rhs.data_[i];
 
         return *this;
     }
@@ -753,14 +1144,8 @@ namespace easy3d {
     * compound assignment operators -=
     */
     inline Matrix &Matrix::operator-=(double x) {
-        double **rowPtr = prow_;
-        double *colPtr = 0;
-
-        for (int i = 0; i < nRow_; ++i) {
-            colPtr = *rowPtr++;
-            for (int j = 0; j < nColumn_; ++j)
-                *colPtr++ -= x;
-        }
+        for (long i = 0; i < nTotal_; ++i)
+            data_[i] -= x;
 
         return *this;
     }
@@ -769,17 +1154,8 @@ namespace easy3d {
         assert(nRow_ == rhs.rows());
         assert(nColumn_ == rhs.cols());
 
-        double **rowPtrL = prow_;
-        double *colPtrL = 0;
-        double **rowPtrR = rhs.prow_;
-        const double *colPtrR = 0;
-
-        for (int i = 0; i < nRow_; ++i) {
-            colPtrL = *rowPtrL++;
-            colPtrR = *rowPtrR++;
-            for (int j = 0; j < nColumn_; ++j)
-                *colPtrL++ -= *colPtrR++;
-        }
+        for (long i = 0; i < nTotal_; ++i)
+            data_[i] -= rhs.data_[i];
 
         return *this;
     }
@@ -789,14 +1165,8 @@ namespace easy3d {
     * compound assignment operators *=
     */
     inline Matrix &Matrix::operator*=(double x) {
-        double **rowPtr = prow_;
-        double *colPtr = 0;
-
-        for (int i = 0; i < nRow_; ++i) {
-            colPtr = *rowPtr++;
-            for (int j = 0; j < nColumn_; ++j)
-                *colPtr++ *= x;
-        }
+        for (long i = 0; i < nTotal_; ++i)
+            data_[i] *= x;
 
         return *this;
     }
@@ -806,14 +1176,8 @@ namespace easy3d {
     * compound assignment operators /=
     */
     inline Matrix &Matrix::operator/=(double x) {
-        double **rowPtr = prow_;
-        double *colPtr = 0;
-
-        for (int i = 0; i < nRow_; ++i) {
-            colPtr = *rowPtr++;
-            for (int j = 0; j < nColumn_; ++j)
-                *colPtr++ /= x;
-        }
+        for (long i = 0; i < nTotal_; ++i)
+            data_[i] /= x;
 
         return *this;
     }
@@ -861,16 +1225,9 @@ namespace easy3d {
     /**
     * get negative matrix
     */
-    inline Matrix operator-(const Matrix &A) {
-        int rows = A.rows();
-        int cols = A.cols();
-
-        Matrix tmp(rows, cols);
-        for (int i = 0; i < rows; ++i)
-            for (int j = 0; j < cols; ++j)
-                tmp[i][j] = -A[i][j];
-
-        return tmp;
+    template <typename E>
+    inline typename details::unary_expression<E, MatrixScaled>::type operator-(const E &A) {
+        return typename details::unary_expression<E, MatrixScaled>::type(A, -1.0);
     }
 
 
@@ -879,7 +1236,8 @@ namespace easy3d {
     */
     inline Matrix operator+(const Matrix &A, double x) {
         Matrix tmp(A);
-        return tmp += x;
+        tmp += x;
+        return tmp;
     }
 
     inline Matrix operator+(double x, const Matrix &A) {
@@ -890,9 +1248,11 @@ namespace easy3d {
     /**
     * matrix-matrix addition
     */
-    inline Matrix operator+(const Matrix &A1, const Matrix &A2) {
-        Matrix tmp(A1);
-        return tmp += A2;
+    template <typename L, typename R>
+    inline typename details::binary_expression<L, R, MatrixSum>::type operator+(const L &A1, const R &A2) {
+        assert(A1.rows() == A2.rows());
+        assert(A1.cols() == A2.cols());
+        return typename details::binary_expression<L, R, MatrixSum>::type(A1, A2);
     }
 
 
@@ -901,36 +1261,34 @@ namespace easy3d {
     */
     inline Matrix operator-(const Matrix &A, double x) {
         Matrix tmp(A);
-        return tmp -= x;
+        tmp -= x;
+        return tmp;
     }
 
     inline Matrix operator-(double x, const Matrix &A) {
-        Matrix tmp(A);
-        return -tmp += x;
+        Matrix tmp = -A;
+        tmp += x;
+        return tmp;
     }
 
 
     /**
     * matrix-matrix subtraction
     */
-    inline Matrix operator-(const Matrix &A1, const Matrix &A2) {
-        Matrix tmp(A1);
-        return tmp -= A2;
+    template <typename L, typename R>
+    inline typename details::binary_expression<L, R, MatrixSum>::type operator-(const L &A1, const R &A2) {
+        assert(A1.rows() == A2.rows());
+        assert(A1.cols() == A2.cols());
+        return typename details::binary_expression<L, R, MatrixSum>::type(A1, A2, true);
     }
 
     /**
     * matrix-matrix multiplication
     */
-    inline Matrix operator*(const Matrix &A1, const Matrix &A2) {
+    template <typename L, typename R>
+    inline typename details::binary_expression<L, R, MatrixProduct>::type operator*(const L &A1, const R &A2) {
         assert(A1.cols() == A2.rows());
-
-        int rows = A1.rows();
-        int cols = A2.cols();
-
-        Matrix tmp(rows, cols);
-        mult(A1, A2, tmp);
-
-        return tmp;
+        return typename details::binary_expression<L, R, MatrixProduct>::type(A1, A2);
     }
 
 
@@ -940,30 +1298,50 @@ namespace easy3d {
     inline Vector operator*(const Matrix &A, const Vector &b) {
         assert(A.cols() == b.size());
 
-        int rows = A.rows();
-        //	int cols = A.cols();
+        Vector tmp(A.rows());
+        mult_into(A, b, tmp);
+
+        return tmp;
+    }
+
+    /**
+    * matrix-vector multiplication, where each row of the matrix expression is evaluated only when it is needed
+    */
+    template <typename E>
+    inline Vector operator*(const MatrixExpression<E> &A, const Vector &b) {
+        const int rows = A.rows();
+        const int cols = A.cols();
+        assert(cols == b.size());
 
         Vector tmp(rows);
-        mult(A, b, tmp);
+        details::RowBuffer buffer;
+        for (int i = 0; i < rows; ++i) {
+            const double *row = details::evaluator<E>::row_ptr(A.derived(), i, buffer);
+            double sum = 0;
+            for (int j = 0; j < cols; ++j)
+                sum += row[j] * b[j];
+            tmp[i] = sum;
+        }
 
         return tmp;
     }
 
     /// matrix-scalar multiplication
-    inline Matrix operator*(const Matrix &A, double s) {
-        Matrix tmp(A);
-        return tmp *= s;
+    template <typename E>
+    inline typename details::unary_expression<E, MatrixScaled>::type operator*(const E &A, double s) {
+        return typename details::unary_expression<E, MatrixScaled>::type(A, s);
     }
 
     // scalar-matrix multiplication
-    inline Matrix operator*(double s, const Matrix &A) {
-        return A * s;
+    template <typename E>
+    inline typename details::unary_expression<E, MatrixScaled>::type operator*(double s, const E &A) {
+        return typename details::unary_expression<E, MatrixScaled>::type(A, s);
     }
 
     // matrix-scalar division
-    inline Matrix operator/(const Matrix &A, double s) {
-        Matrix tmp(A);
-        return tmp /= s;
+    template <typename E>
+    inline typename details::unary_expression<E, MatrixScaled>::type operator/(const E &A, double s) {
+        return typename details::unary_expression<E, MatrixScaled>::type(A, s, true);
     }
 
     // scalar-matrix division
@@ -984,41 +1362,88 @@ namespace easy3d {
     * where the destination matrix has already been allocated.
     */
     inline void mult(const Matrix &A, const Matrix &B, Matrix &C) {
+        mult_into(A, B, C);
+    }
+
+
+    /**
+    * This is an optimized version of matrix and vector multiplication,
+    * where the destination vector has already been allocated.
+    */
+    inline void mult(const Matrix &A, const Vector &b, Vector &c) {
+        mult_into(A, b, c);
+    }
+
+
+    inline Matrix mult(const Matrix &A, const Matrix &B) {
+        Matrix C;
+        mult_into(A, B, C);
+        return C;
+    }
+
+
+    inline Vector mult(const Matrix &A, const Vector &b) {
+        Vector c(A.rows());
+        mult_into(A, b, c);
+        return c;
+    }
+
+
+    inline void add_into(const Matrix &A, const Matrix &B, Matrix &C) {
+        assert(A.rows() == B.rows());
+        assert(A.cols() == B.cols());
+
+        C.resize(A.rows(), A.cols());
+        const long num = static_cast<long>(A.rows()) * A.cols();
+        const double *a = A.data(), *b = B.data();
+        double *c = C.data();
+        for (long i = 0; i < num; ++i)
+            c[i] = a[i] + b[i];
+    }
+
+
+    inline void sub_into(const Matrix &A, const Matrix &B, Matrix &C) {
+        assert(A.rows() == B.rows());
+        assert(A.cols() == B.cols());
+
+        C.resize(A.rows(), A.cols());
+        const long num = static_cast<long>(A.rows()) * A.cols();
+        const double *a = A.data(), *b = B.data();
+        double *c = C.data();
+        for (long i = 0; i < num; ++i)
+            c[i] = a[i] - b[i];
+    }
+
+
+    inline void scale_into(const Matrix &A, double s, Matrix &C) {
+        C.resize(A.rows(), A.cols());
+        const long num = static_cast<long>(A.rows()) * A.cols();
+        const double *a = A.data();
+        double *c = C.data();
+        for (long i = 0; i < num; ++i)
+            c[i] = a[i] * s;
+    }
+
+
+    inline void mult_into(const Matrix &A, const Matrix &B, Matrix &C) {
         int M = A.rows();
         int N = B.cols();
         int K = A.cols();
 
         assert(B.rows() == K);
+        assert(&C != &A && &C != &B);
 
         C.resize(M, N);
-        double sum = 0;
-        const double *pRow, *pCol;
-
-        for (int i = 0; i < M; i++)
-            for (int j = 0; j < N; ++j) {
-                pRow = &A[i][0];
-                pCol = &B[0][j];
-                sum = 0;
-
-                for (int k = 0; k < K; ++k) {
-                    sum += (*pRow) * (*pCol);
-                    pRow++;
-                    pCol += N;
-                }
-                C[i][j] = sum;
-            }
+        details::gemm(A.data(), B.data(), C.data(), M, N, K);
     }
 
 
-    /**
-    * This is an optimized version of matrix and vector multiplication,
-    * where the destination vector has already been allocated.
-    */
-    inline void mult(const Matrix &A, const Vector &b, Vector &c) {
+    inline void mult_into(const Matrix &A, const Vector &b, Vector &c) {
         int M = A.rows();
         int N = A.cols();
 
         assert(b.size() == N);
+        assert(&c != &b);
 
         c.resize(M);
         double sum = 0;
@@ -1039,81 +1464,186 @@ namespace easy3d {
     }
 
 
-    /**
-    * This is an optimized version of matrix multiplication,
-    * where the destination matrix has already been allocated.
-    */
-    inline Matrix mult(const Matrix &A, const Matrix &B) {
-        int M = A.rows();
-        int N = B.cols();
-        int K = A.cols();
-
-        assert(B.rows() == K);
+    namespace details {
 
-        Matrix C(M, N);
-        double sum = 0;
-        const double *pRow, *pCol;
+        inline void gemm_naive(const double *A, const double *B, double *C, int M, int N, int K) {
+            for (int i = 0; i < M; i++)
+                for (int j = 0; j < N; ++j) {
+                    const double *pRow = A + static_cast<long>(i) * K;
+                    const double *pCol = B + j;
+                    double sum = 0;
 
-        for (int i = 0; i < M; i++)
-            for (int j = 0; j < N; ++j) {
-                pRow = &A[i][0];
-                pCol = &B[0][j];
-                sum = 0;
-
-                for (int k = 0; k < K; ++k) {
-                    sum += (*pRow) * (*pCol);
-                    pRow++;
-                    pCol += N;
+                    for (int k = 0; k < K; ++k) {
+                        sum += (*pRow) * (*pCol);
+                        pRow++;
+                        pCol += N;
+                    }
+                    C[static_cast<long>(i) * N + j] = sum;
                 }
-                C[i][j] = sum;
+        }
+
+
+#ifdef EASY3D_GEMM_AVX2
+        /// The AVX2/FMA part of gemm_axpy4(), i.e., for the first multiple of 4 elements. Returns the number done.
+#ifdef EASY3D_GEMM_AVX2_DISPATCH
+        __attribute__((target("avx2,fma")))
+#endif
+        inline int gemm_axpy4_avx2(const double *a, const double *b,
+                                   double *c0, double *c1, double *c2, double *c3, int n) {
+            int j = 0;
+            const __m256d a0 = _mm256_set1_pd(a[0]);
+            const __m256d a1 = _mm256_set1_pd(a[1]);
+            const __m256d a2 = _mm256_set1_pd(a[2]);
+            const __m256d a3 = _mm256_set1_pd(a[3]);
+            for (; j + 4 <= n; j += 4) {
+                const __m256d bj = _mm256_loadu_pd(b + j);
+                _mm256_storeu_pd(c0 + j, _mm256_fmadd_pd(a0, bj, _mm256_loadu_pd(c0 + j)));
+                _mm256_storeu_pd(c1 + j, _mm256_fmadd_pd(a1, bj, _mm256_loadu_pd(c1 + j)));
+                _mm256_storeu_pd(c2 + j, _mm256_fmadd_pd(a2, bj, _mm256_loadu_pd(c2 + j)));
+                _mm256_storeu_pd(c3 + j, _mm256_fmadd_pd(a3, bj, _mm256_loadu_pd(c3 + j)));
             }
-        return C;
-    }
+            return j;
+        }
+#endif
+
+
+        inline bool gemm_has_avx2() {
+#if defined(EASY3D_GEMM_AVX2_DISPATCH)
+            static const bool supported = []() {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+            }();
+            return supported;
+#elif defined(EASY3D_GEMM_AVX2)
+            return true;
+#else
+            return false;
+#endif
+        }
 
 
-    /**
-    * This is an optimized version of matrix and vector multiplication,
-    * where the destination vector has already been allocated.
-    */
-    inline Vector mult(const Matrix &A, const Vector &b) {
-        int M = A.rows();
-        int N = A.cols();
+        /// c_r += a[r] * b for 4 rows r of C, where b is a row of B. Each element of b is loaded once for all rows.
+        /// avx2 must only be true if gemm_has_avx2().
+        inline void gemm_axpy4(const double *a, const double *b, double *c0, double *c1, double *c2, double *c3, int n,
+                               bool avx2) {
+            int j = 0;
+#ifdef EASY3D_GEMM_AVX2
+            if (avx2)
+                j = gemm_axpy4_avx2(a, b, c0, c1, c2, c3, n);
+#else
+            (void) avx2;
+#endif
+            for (; j < n; ++j) {
+                const double bj = b[j];
+                c0[j] += a[0] * bj;
+                c1[j] += a[1] * bj;
+                c2[j] += a[2] * bj;
+                c3[j] += a[3] * bj;
+            }
+        }
 
-        assert(b.size() == N);
 
-        Vector c(M);
-        double sum = 0;
-        const double *pRow, *pCol;
+        /// Rows [row_begin, row_end) of C = A * B.
+        inline void gemm_blocked_rows(const double *A, const double *B, double *C, int N, int K,
+                                      int row_begin, int row_end) {
+            // a panel of B (kBlockK by kBlockN) is 256 KB, which stays in the L2 cache while it is used for all rows,
+            // and 4 rows of C (4 by kBlockN) stay in the L1 cache while a panel is applied to them.
+            const int kBlockN = 256;
+            const int kBlockK = 128;
+            const bool avx2 = gemm_has_avx2();
 
-        for (int i = 0; i < M; i++) {
-            pRow = &A[i][0];
-            pCol = &b[0];
-            sum = 0;
+            for (long i = row_begin; i < row_end; ++i) {
+                double *c = C + i * N;
+                for (int j = 0; j < N; ++j)
+                    c[j] = 0;
+            }
 
-            for (int j = 0; j < N; ++j) {
-                sum += (*pRow) * (*pCol);
-                pRow++;
-                pCol++;
+            for (int j0 = 0; j0 < N; j0 += kBlockN) {
+                const int nb = std::min(N - j0, kBlockN);
+                for (int k0 = 0; k0 < K; k0 += kBlockK) {
+                    const int k1 = std::min(K, k0 + kBlockK);
+                    int i = row_begin;
+                    for (; i + 4 <= row_end; i += 4) {
+                        double *c0 = C + static_cast<long>(i) * N + j0;
+                        const double *a0 = A + static_cast<long>(i) * K;
+                        for (int k = k0; k < k1; ++k) {
+                            const double a[4] = {a0[k], a0[K + k], a0[2 * K + k], a0[3 * K + k]};
+                            gemm_axpy4(a, B + static_cast<long>(k) * N + j0, c0, c0 + N, c0 + 2 * N, c0 + 3 * N, nb,
+                                       avx2);
+                        }
+                    }
+                    for (; i < row_end; ++i) {   // the remaining rows
+                        double *c = C + static_cast<long>(i) * N + j0;
+                        const double *a = A + static_cast<long>(i) * K;
+                        for (int k = k0; k < k1; ++k) {
+                            const double *b = B + static_cast<long>(k) * N + j0;
+                            for (int j = 0; j < nb; ++j)
+                                c[j] += a[k] * b[j];
+                        }
+                    }
+                }
             }
-            c[i] = sum;
         }
-        return c;
+
+
+        inline void gemm_blocked(const double *A, const double *B, double *C, int M, int N, int K, int num_threads) {
+            // each thread gets a multiple of 4 rows
+            const int max_threads = (M + 3) / 4;
+            num_threads = std::max(1, std::min(num_threads, max_threads));
+            if (num_threads == 1) {
+                gemm_blocked_rows(A, B, C, N, K, 0, M);
+                return;
+            }
+
+            const int rows_per_thread = ((M + num_threads - 1) / num_threads + 3) / 4 * 4;
+            std::vector<std::thread> threads;
+            threads.reserve(num_threads - 1);
+            for (int begin = rows_per_thread; begin < M; begin += rows_per_thread) {
+                const int end = std::min(M, begin + rows_per_thread);
+                threads.push_back(std::thread(gemm_blocked_rows, A, B, C, N, K, begin, end));
+            }
+            gemm_blocked_rows(A, B, C, N, K, 0, std::min(M, rows_per_thread));
+            for (auto &t : threads)
+                t.join();
+        }
+
+
+        inline int gemm_num_threads() {
+            static const int num = std::max(1u, std::thread::hardware_concurrency());
+            return num;
+        }
+
+
+        inline void gemm(const double *A, const double *B, double *C, int M, int N, int K) {
+            const long size = static_cast<long>(M) * N * K;
+            if (size < kGemmBlockedThreshold)
+                gemm_naive(A, B, C, M, N, K);
+            else
+                gemm_blocked(A, B, C, M, N, K, size < kGemmParallelThreshold ? 1 : gemm_num_threads());
+        }
+
     }
 
 
-    /**
-    * matrix transpose
-    */
-    inline Matrix transpose(const Matrix &A) {
+    inline void transpose_into(const Matrix &A, Matrix &T) {
+        assert(&T != &A);
+
         int rows = A.cols();
         int clumns = A.rows();
 
-        Matrix tmp(rows, clumns);
+        T.resize(rows, clumns);
         for (int i = 0; i < rows; ++i)
             for (int j = 0; j < clumns; ++j)
-                tmp[i][j] = A[j][i];
+                T[i][j] = A[j][i];
+    }
 
-        return tmp;
+
+    /**
+    * matrix transpose
+    */
+    template <typename E>
+    inline typename details::unary_expression<E, MatrixTranspose>::type transpose(const E &A) {
+        return typename details::unary_expression<E, MatrixTranspose>::type(A);
     }
 
 
@@ -1209,116 +1739,373 @@ namespace easy3d {
     // -----------------------------------------------------------------------------------------------------------
 
 
-    inline Matrix33::Matrix33(double s00, double s01, double s02,
-                              double s10, double s11, double s12,
-                              double s20, double s21, double s22) : Matrix(3, 3) {
-        (*this)(0, 0) = s00;
-        (*this)(0, 1) = s01;
-        (*this)(0, 2) = s02;
-        (*this)(1, 0) = s10;
-        (*this)(1, 1) = s11;
-        (*this)(1, 2) = s12;
-        (*this)(2, 0) = s20;
-        (*this)(2, 1) = s21;
-        (*this)(2, 2) = s22;
+    template <typename E>
+    inline Matrix::Matrix(const MatrixExpression<E> &expr) {
+        const int rows = expr.rows();
+        const int cols = expr.cols();
+        init(rows, cols);
+        details::evaluate(expr.derived(), data_);
     }
 
 
-    inline Matrix33::Matrix33(const Matrix &m) : Matrix(3, 3) {
-        assert(m.rows() >= 3);
-        assert(m.cols() >= 3);
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 0; j < 3; ++j)
-                (*this)(i, j) = m(i, j);
+    /**
+    * evaluate a matrix expression into this matrix
+    */
+    template <typename E>
+    inline Matrix &Matrix::operator=(const MatrixExpression<E> &expr) {
+        // the rows of an expression referring to this matrix (e.g., A = A * B) would be overwritten before they have
+        // been completely used, so it is evaluated into a temporary first.
+        if (details::evaluator<E>::references(expr.derived(), *this)) {
+            Matrix tmp(expr);
+            return *this = std::move(tmp);
         }
+
+        const int rows = expr.rows();
+        const int cols = expr.cols();
+        resize(rows, cols);
+        details::evaluate(expr.derived(), data_);
+        return *this;
     }
 
 
-    inline Matrix33 Matrix33::identity(double v) {
-        return Matrix::identity(3, 3, v);
+    namespace details {
+
+        template <typename E>
+        inline const double *evaluator<E>::row_ptr(const E &e, int r, RowBuffer &buffer) {
+            double *row = buffer.get(e.cols());
+            e.eval_row(r, row);
+            return row;
+        }
+
+        template <typename E>
+        inline void evaluator<E>::axpy_row(const E &e, int r, double a, double *out) {
+            const int cols = e.cols();
+            for (int c = 0; c < cols; ++c)
+                out[c] += a * e.coeff(r, c);
+        }
+
+        inline void evaluator<Matrix>::row(const Matrix &e, int r, double *out) {
+            const int cols = e.cols();
+            const double *row = e[r];
+            for (int c = 0; c < cols; ++c)
+                out[c] = row[c];
+        }
+
+        inline void evaluator<Matrix>::axpy_row(const Matrix &e, int r, double a, double *out) {
+            const int cols = e.cols();
+            const double *row = e[r];
+            for (int c = 0; c < cols; ++c)
+                out[c] += a * row[c];
+        }
+
+        inline double *RowBuffer::get(int n) {
+            if (n <= kStackSize)
+                return stack_;
+            if (heap_.size() < static_cast<std::size_t>(n))
+                heap_.resize(n);
+            return heap_.data();
+        }
+
+        template <typename E>
+        inline void evaluate(const E &expr, double *dst) {
+            const int rows = expr.rows();
+            const int cols = expr.cols();
+            for (int i = 0; i < rows; ++i)
+                evaluator<E>::row(expr, i, dst + static_cast<long>(i) * cols);
+        }
+
+        inline void evaluate(const MatrixProduct<Matrix, Matrix> &expr, double *dst) {
+            gemm(expr.lhs().data(), expr.rhs().data(), dst, expr.rows(), expr.cols(), expr.lhs().cols());
+        }
+
+        template <typename E>
+        inline const Matrix &CoeffAccess<E, false>::value() const {
+            if (!evaluated_) {
+                value_ = e_;
+                evaluated_ = true;
+            }
+            return value_;
+        }
+
+    } // namespace details
+
+
+    template <typename L, typename R>
+    inline MatrixSum<L, R>::MatrixSum(const L &lhs, const R &rhs, bool subtract)
+            : lhs_(lhs), rhs_(rhs), subtract_(subtract) {
+    }
+
+    template <typename L, typename R>
+    inline void MatrixSum<L, R>::eval_row(int r, double *out) const {
+        const int cols = this->cols();
+        details::evaluator<L>::row(lhs_, r, out);
+        const double *b = details::evaluator<R>::row_ptr(rhs_, r, buffer_);
+        if (subtract_) {
+            for (int c = 0; c < cols; ++c)
+                out[c] -= b[c];
+        } else {
+            for (int c = 0; c < cols; ++c)
+                out[c] += b[c];
+        }
+    }
+
+    template <typename L, typename R>
+    inline double MatrixSum<L, R>::coeff(int r, int c) const {
+        const double a = details::evaluator<L>::coeff(lhs_, r, c);
+        const double b = details::evaluator<R>::coeff(rhs_, r, c);
+        return subtract_ ? a - b : a + b;
+    }
+
+    template <typename L, typename R>
+    inline bool MatrixSum<L, R>::references(const Matrix &m) const {
+        return details::evaluator<L>::references(lhs_, m) || details::evaluator<R>::references(rhs_, m);
     }
 
+
+    template <typename E>
+    inline MatrixScaled<E>::MatrixScaled(const E &e, double s, bool divide)
+            : e_(e), s_(s), divide_(divide) {
+    }
+
+    template <typename E>
+    inline void MatrixScaled<E>::eval_row(int r, double *out) const {
+        const int cols = this->cols();
+        details::evaluator<E>::row(e_, r, out);
+        if (divide_) {
+            for (int c = 0; c < cols; ++c)
+                out[c] /= s_;
+        } else {
+            for (int c = 0; c < cols; ++c)
+                out[c] *= s_;
+        }
+    }
+
+    template <typename E>
+    inline double MatrixScaled<E>::coeff(int r, int c) const {
+        const double a = details::evaluator<E>::coeff(e_, r, c);
+        return divide_ ? a / s_ : a * s_;
+    }
+
+
+    template <typename L, typename R>
+    inline MatrixProduct<L, R>::MatrixProduct(const L &lhs, const R &rhs)
+            : lhs_(lhs), rhs_(rhs) {
+    }
+
+    /**
+    * The r_th row of the product is the sum of the rows of the right operand weighted by the elements of the r_th row of
+    * the left operand. The elements are accumulated in the same order as in mult(), so the results are identical.
+    */
+    template <typename L, typename R>
+    inline void MatrixProduct<L, R>::eval_row(int r, double *out) const {
+        const int K = lhs_.cols();
+        const int N = rhs_.cols();
+        const double *a = details::evaluator<L>::row_ptr(lhs_, r, buffer_);
+        for (int c = 0; c < N; ++c)
+            out[c] = 0;
+        for (int k = 0; k < K; ++k)
+            rhs_.axpy_row(k, a[k], out);
+    }
+
+    template <typename L, typename R>
+    inline double MatrixProduct<L, R>::coeff(int r, int c) const {
+        const int K = lhs_.cols();
+        double sum = 0;
+        for (int k = 0; k < K; ++k)
+            sum += details::evaluator<L>::coeff(lhs_, r, k) * rhs_(k, c);
+        return sum;
+    }
+
+    template <typename L, typename R>
+    inline bool MatrixProduct<L, R>::references(const Matrix &m) const {
+        return details::evaluator<L>::references(lhs_, m) || rhs_.references(m);
+    }
+
+
+    template <typename E>
+    inline void MatrixTranspose<E>::eval_row(int r, double *out) const {
+        const int cols = this->cols();
+        for (int c = 0; c < cols; ++c)
+            out[c] = e_(c, r);
+    }
+
+
+
     // -----------------------------------------------------------------------------------------------------------
 
 
-    inline Matrix44::Matrix44(
-            double s00, double s01, double s02, double s03,
-            double s10, double s11, double s12, double s13,
-            double s20, double s21, double s22, double s23,
-            double s30, double s31, double s32, double s33
-    ) : Matrix(4, 4) {
-        (*this)(0, 0) = s00;
-        (*this)(0, 1) = s01;
-        (*this)(0, 2) = s02;
-        (*this)(0, 3) = s03;
-        (*this)(1, 0) = s10;
-        (*this)(1, 1) = s11;
-        (*this)(1, 2) = s12;
-        (*this)(1, 3) = s13;
-        (*this)(2, 0) = s20;
-        (*this)(2, 1) = s21;
-        (*this)(2, 2) = s22;
-        (*this)(2, 3) = s23;
-        (*this)(3, 0) = s30;
-        (*this)(3, 1) = s31;
-        (*this)(3, 2) = s32;
-        (*this)(3, 3) = s33;
-    }
-
-
-    inline Matrix44::Matrix44(const Matrix &m) : Matrix(4, 4) {
-        assert(m.rows() >= 4);
-        assert(m.cols() >= 4);
-        for (int i = 0; i < 4; ++i) {
-            for (int j = 0; j < 4; ++j)
-                (*this)(i, j) = m(i, j);
+    template <int R, int C>
+    inline FixedMatrix<R, C>::FixedMatrix() : Matrix(elements_, R, C) {
+        set_by_scalar(0.0);
+    }
+
+
+    template <int R, int C>
+    template <typename... FT>
+    inline FixedMatrix<R, C>::FixedMatrix(double s00, FT... others) : Matrix(elements_, R, C) {
+        static_assert(sizeof...(FT) < R * C, "too many elements for the matrix");
+        const double values[] = {s00, static_cast<double>(others)...};
+        const int num = static_cast<int>(sizeof(values) / sizeof(double));
+        for (int i = 0; i < num; ++i)
+            elements_[i] = values[i];
+        for (int i = num; i < R * C; ++i)
+            elements_[i] = 0.0;
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<R, C>::FixedMatrix(const FixedMatrix &rhs) : Matrix(elements_, R, C) {
+        copy_from_array(rhs.data());
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<R, C>::FixedMatrix(const Matrix &m) : Matrix(elements_, R, C) {
+        assert(m.rows() >= R);
+        assert(m.cols() >= C);
+        for (int i = 0; i < R; ++i) {
+            for (int j = 0; j < C; ++j)
+                elements_[i * C + j] = m(i, j);
+        }
+    }
+
+
+    template <int R, int C>
+    template <typename E>
+    inline FixedMatrix<R, C>::FixedMatrix(const MatrixExpression<E> &expr) : Matrix(elements_, R, C) {
+        const int cols = expr.cols();
+        assert(expr.rows() >= R);
+        assert(cols >= C);
+        if (cols == C) {
+            for (int i = 0; i < R; ++i)
+                details::evaluator<E>::row(expr.derived(), i, elements_ + i * C);
+        } else {
+            details::RowBuffer buffer;
+            for (int i = 0; i < R; ++i) {
+                const double *row = details::evaluator<E>::row_ptr(expr.derived(), i, buffer);
+                for (int j = 0; j < C; ++j)
+                    elements_[i * C + j] = row[j];
+            }
         }
     }
 
 
-    inline Matrix44 Matrix44::identity(double v) {
-        return Matrix::identity(4, 4, v);
+    template <int R, int C>
+    inline FixedMatrix<R, C> &FixedMatrix<R, C>::operator=(const FixedMatrix &rhs) {
+        Matrix::operator=(rhs);
+        return *this;
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<R, C> FixedMatrix<R, C>::identity(double v) {
+        FixedMatrix<R, C> m;
+        m.load_identity(v);
+        return m;
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<C, R> FixedMatrix<R, C>::transpose() const {
+        return easy3d::transpose(*this);
     }
 
 
     // -----------------------------------------------------------------------------------------------------------
 
 
-    inline Matrix34::Matrix34(
-            double s00, double s01, double s02, double s03,
-            double s10, double s11, double s12, double s13,
-            double s20, double s21, double s22, double s23
-    ) : Matrix(3, 4) {
-        (*this)(0, 0) = s00;
-        (*this)(0, 1) = s01;
-        (*this)(0, 2) = s02;
-        (*this)(0, 3) = s03;
-        (*this)(1, 0) = s10;
-        (*this)(1, 1) = s11;
-        (*this)(1, 2) = s12;
-        (*this)(1, 3) = s13;
-        (*this)(2, 0) = s20;
-        (*this)(2, 1) = s21;
-        (*this)(2, 2) = s22;
-        (*this)(2, 3) = s23;
-    }
-
-
-    inline Matrix34::Matrix34(const Matrix &m) : Matrix(3, 4) {
-        assert(m.rows() >= 3);
-        assert(m.cols() >= 4);
-        for (int i = 0; i < 3; ++i) {
-            for (int j = 0; j < 4; ++j)
-                (*this)(i, j) = m(i, j);
+    template <int R, int C>
+    inline FixedMatrix<R, C> operator-(const FixedMatrix<R, C> &A) {
+        FixedMatrix<R, C> tmp;
+        for (int i = 0; i < R * C; ++i)
+            tmp.data()[i] = -A.data()[i];
+        return tmp;
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<R, C> operator+(const FixedMatrix<R, C> &A1, const FixedMatrix<R, C> &A2) {
+        FixedMatrix<R, C> tmp;
+        for (int i = 0; i < R * C; ++i)
+            tmp.data()[i] = A1.data()[i] + A2.data()[i];
+        return tmp;
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<R, C> operator-(const FixedMatrix<R, C> &A1, const FixedMatrix<R, C> &A2) {
+        FixedMatrix<R, C> tmp;
+        for (int i = 0; i < R * C; ++i)
+            tmp.data()[i] = A1.data()[i] - A2.data()[i];
+        return tmp;
+    }
+
+
+    template <int R, int K, int C>
+    inline FixedMatrix<R, C> operator*(const FixedMatrix<R, K> &A, const FixedMatrix<K, C> &B) {
+        const double *a = A.data();
+        const double *b = B.data();
+        FixedMatrix<R, C> tmp;
+        double *c = tmp.data();
+        for (int i = 0; i < R; ++i) {
+            for (int j = 0; j < C; ++j) {
+                double sum = 0.0;
+                for (int k = 0; k < K; ++k)
+                    sum += a[i * K + k] * b[k * C + j];
+                c[i * C + j] = sum;
+            }
         }
+        return tmp;
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<R, C> operator*(const FixedMatrix<R, C> &A, double s) {
+        FixedMatrix<R, C> tmp;
+        for (int i = 0; i < R * C; ++i)
+            tmp.data()[i] = A.data()[i] * s;
+        return tmp;
     }
 
 
-    inline Matrix34 Matrix34::identity(double v) {
-        return Matrix::identity(3, 4, v);
+    template <int R, int C>
+    inline FixedMatrix<R, C> operator*(double s, const FixedMatrix<R, C> &A) {
+        return A * s;
     }
 
 
+    template <int R, int C>
+    inline FixedMatrix<R, C> operator/(const FixedMatrix<R, C> &A, double s) {
+        FixedMatrix<R, C> tmp;
+        for (int i = 0; i < R * C; ++i)
+            tmp.data()[i] = A.data()[i] / s;
+        return tmp;
+    }
+
+
+    template <int R, int C>
+    inline FixedVector<R> operator*(const FixedMatrix<R, C> &A, const FixedVector<C> &b) {
+        const double *a = A.data();
+        FixedVector<R> tmp;
+        for (int i = 0; i < R; ++i) {
+            double sum = 0.0;
+            for (int j = 0; j < C; ++j)
+                sum += a[i * C + j] * b[j];
+            tmp[i] = sum;
+        }
+        return tmp;
+    }
+
+
+    template <int R, int C>
+    inline FixedMatrix<C, R> transpose(const FixedMatrix<R, C> &A) {
+        FixedMatrix<C, R> tmp;
+        for (int i = 0; i < C; ++i)
+            for (int j = 0; j < R; ++j)
+                tmp(i, j) = A(j, i);
+        return tmp;
+    }
+
 }
 
 
@@ -25,21 +25,565 @@
 
 #include "matrix_algo.h"
 #include <iostream>
+#include <thread>
+#include <limits>
 #include <3rd_party/Eigen/Dense>
+#include <easy3d/core/rq_decomposition.h>
+#include <easy3d/core/eigen_solver.h>
 
 
 namespace easy3d {
 
 
+    namespace {
+
+        // A Matrix stores its elements contiguously in row-major order, so Eigen can work on them in place through
+        // maps, and the results can be written directly into the output matrices.
+        typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RowMajorMatrixXd;
+
+        Eigen::Map<const RowMajorMatrixXd> map(const Matrix &A) {
+            return Eigen::Map<const RowMajorMatrixXd>(A.data(), A.rows(), A.cols());
+        }
+
+        Eigen::Map<RowMajorMatrixXd> map(Matrix &A) {
+            return Eigen::Map<RowMajorMatrixXd>(A.data(), A.rows(), A.cols());
+        }
+
+        // The same for matrices whose size is known at compile time, for which Eigen uses closed-form determinants
+        // and inverses (up to 4 by 4) and doesn't allocate anything.
+        template <int R, int C>
+        Eigen::Map<const Eigen::Matrix<double, R, C, Eigen::RowMajor> > map(const Matrix &A) {
+            return Eigen::Map<const Eigen::Matrix<double, R, C, Eigen::RowMajor> >(A.data());
+        }
+
+        template <int R, int C>
+        Eigen::Map<Eigen::Matrix<double, R, C, Eigen::RowMajor> > map(Matrix &A) {
+            return Eigen::Map<Eigen::Matrix<double, R, C, Eigen::RowMajor> >(A.data());
+        }
+
+
+        template <int N>
+        double fixed_determinant(const Matrix &A) {
+            return map<N, N>(A).determinant();
+        }
+
+
+        template <int N>
+        void fixed_inverse(const Matrix &A, Matrix &invA) {
+            // evaluated into a temporary first, because invA may be A itself
+            const Eigen::Matrix<double, N, N, Eigen::RowMajor> inv = map<N, N>(A).inverse();
+            map<N, N>(invA) = inv;
+        }
+
+
+        // The options of Eigen's SVD classes computing the requested parts.
+        unsigned int svd_options(SVDOutput output) {
+            switch (output) {
+                case SVD_THIN_U:
+                    return Eigen::ComputeThinU | Eigen::ComputeFullV;
+                case SVD_VALUES_ONLY:
+                    return 0;
+                default:
+                    return Eigen::ComputeFullU | Eigen::ComputeFullV;
+            }
+        }
+
+
+        // Writes the result of an Eigen SVD into U, S, and V.
+        template <typename SVD>
+        void extract_svd(const SVD &svd, SVDOutput output, Matrix &U, Matrix &S, Matrix &V) {
+            if (output != SVD_VALUES_ONLY) {
+                map(U.resize(svd.matrixU().rows(), svd.matrixU().cols())) = svd.matrixU();
+                map(V.resize(svd.matrixV().rows(), svd.matrixV().cols())) = svd.matrixV();
+            }
+
+            const auto &values = svd.singularValues();
+            S.resize(output == SVD_THIN_U ? static_cast<int>(values.size()) : svd.rows(), svd.cols());
+            S.load_zero();
+            for (int i = 0; i < values.size(); ++i)
+                S(i, i) = values(i);
+        }
+
+
+        template <int M, int N>
+        void fixed_svd(const Matrix &A, SVDOutput output, Matrix &U, Matrix &S, Matrix &V) {
+            // the fixed sizes are not taller than wide, so the thin U is the full U
+            const unsigned int options = svd_options(output == SVD_THIN_U ? SVD_FULL : output);
+            const Eigen::JacobiSVD<Eigen::Matrix<double, M, N> > svd(map<M, N>(A), options);
+            extract_svd(svd, output, U, S, V);
+        }
+
+
+        template <int M, int N>
+        void fixed_null_vector(const Matrix &A, Eigen::Map<Eigen::VectorXd> &x) {
+            const Eigen::JacobiSVD<Eigen::Matrix<double, M, N> > svd(map<M, N>(A), Eigen::ComputeFullV);
+            x = svd.matrixV().col(N - 1);
+        }
+
+
+        // A^T * A, whose eigenvalues are the squared singular values of A and whose eigenvectors are the right
+        // singular vectors of A.
+        Eigen::MatrixXd normal_matrix(const Matrix &A) {
+            Eigen::MatrixXd AtA = Eigen::MatrixXd::Zero(A.cols(), A.cols());
+            AtA.selfadjointView<Eigen::Lower>().rankUpdate(map(A).transpose());
+            return AtA;
+        }
+
+
+        // The eigen-decomposition of the symmetric n by n matrix (of which only the lower triangle is used) by
+        // easy3d's EigenSolver. rows points to the n rows of a working copy, which ends up holding the eigenvectors.
+        // subd is a workspace of n entries, so nothing is allocated.
+        bool eigen_solver(const double *A, int n, double **rows, double *values, double *subd) {
+            if (n == 1) {
+                values[0] = A[0];
+                rows[0][0] = 1.0;
+                return true;
+            }
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j <= i; ++j)
+                    rows[i][j] = rows[j][i] = A[i * n + j];
+            }
+            return EigenSolver<double>::solve(n, rows, values, subd, EigenSolver<double>::INCREASING);
+        }
+
+
+        template <int N>
+        bool fixed_symmetric_eigen(const Matrix &A, Vector &values, Matrix &vectors) {
+            double storage[N][N];
+            double subd[N];
+            double *rows[N];
+            for (int i = 0; i < N; ++i)
+                rows[i] = storage[i];
+            values.resize(N);
+            if (!eigen_solver(A.data(), N, rows, values.data(), subd))
+                return false;
+            vectors.resize(N, N);
+            std::copy(storage[0], storage[0] + N * N, vectors.data());
+            return true;
+        }
+
+
+        void symmetric_eigen_svd(const Matrix &A, SVDOutput output, Matrix &S, Matrix &V) {
+            const int m = A.rows();
+            const int n = A.cols();
+            const int k = std::min(m, n);
+            Matrix AtA(n, n);
+            map(AtA) = normal_matrix(A);
+            Vector values(n);
+            Matrix vectors(n, n);
+            symmetric_eigen(AtA, values, vectors);
+
+            // the eigenvalues are in increasing order, so both are reversed
+            S.resize(output == SVD_THIN_U ? k : m, n);
+            S.load_zero();
+            for (int i = 0; i < k; ++i)
+                S(i, i) = std::sqrt(std::max(0.0, values[n - 1 - i]));
+
+            if (output != SVD_VALUES_ONLY) {
+                V.resize(n, n);
+                for (int i = 0; i < n; ++i) {
+                    for (int j = 0; j < n; ++j)
+                        V(i, j) = vectors(i, n - 1 - j);
+                }
+            }
+        }
+
+
+
+        // Matrices of a batch are decomposed in blocks of this many, whose working copies stay in the L1 cache.
+        const std::size_t kBatchBlock = 64;
+
+        // Batches of at least this many matrices are split among threads.
+        const std::size_t kBatchParallelThreshold = 4096;
+
+
+        // Calls func(begin, end) for ranges of [0, count) that are multiples of kBatchBlock, on all hardware threads if
+        // count is large.
+        template <typename FUNC>
+        void parallel_for_blocks(std::size_t count, const FUNC &func) {
+            const std::size_t num_blocks = (count + kBatchBlock - 1) / kBatchBlock;
+            std::size_t num_threads = 1;
+            if (count >= kBatchParallelThreshold)
+                num_threads = std::min<std::size_t>(num_blocks, std::max(1u, std::thread::hardware_concurrency()));
+            if (num_threads <= 1) {
+                func(0, count);
+                return;
+            }
+
+            const std::size_t range = (num_blocks + num_threads - 1) / num_threads * kBatchBlock;
+            std::vector<std::thread> threads;
+            for (std::size_t begin = range; begin < count; begin += range)
+                threads.push_back(std::thread(func, begin, std::min(count, begin + range)));
+            func(0, std::min(count, range));
+            for (auto &t : threads)
+                t.join();
+        }
+
+
+        // One-sided (Hestenes) Jacobi SVD of a block of N by N matrices. Element e of the l_th matrix of the block is
+        // at a[e * kBatchBlock + l]. The columns of each matrix are rotated pairwise until they are mutually
+        // orthogonal, i.e., A * V = U * S. Upon return, a holds U * S and v holds V.
+        // A block is always full (unused matrices are zero and never rotated), so the loops over the matrices have a
+        // fixed length, which the compiler vectorizes even with its cheapest cost model (e.g., GCC at -O2).
+        template <int N>
+        void jacobi_sweeps(double *a, double *v) {
+            const int B = kBatchBlock;
+            for (int e = 0; e < N * N; ++e) {
+                const double d = (e / N == e % N) ? 1.0 : 0.0;
+                for (int l = 0; l < B; ++l)
+                    v[e * B + l] = d;
+            }
+
+            const double eps = std::numeric_limits<double>::epsilon();
+            const int kMaxSweeps = 16;  // it converges in 5 to 8 sweeps for 4 by 4 matrices
+            double alpha[kBatchBlock], beta[kBatchBlock], gamma[kBatchBlock], c[kBatchBlock], s[kBatchBlock];
+            double xp[kBatchBlock], xq[kBatchBlock];
+            for (int sweep = 0; sweep < kMaxSweeps; ++sweep) {
+                int rotated = 0;
+                for (int p = 0; p < N - 1; ++p) {
+                    for (int q = p + 1; q < N; ++q) {
+                        // All loops over the matrices are innermost and free of branches, so they can be vectorized.
+                        for (int l = 0; l < B; ++l)
+                            alpha[l] = beta[l] = gamma[l] = 0.0;
+                        for (int i = 0; i < N; ++i) {
+                            const double *ap = a + (i * N + p) * B;
+                            const double *aq = a + (i * N + q) * B;
+                            for (int l = 0; l < B; ++l) {
+                                alpha[l] += ap[l] * ap[l];
+                                beta[l] += aq[l] * aq[l];
+                                gamma[l] += ap[l] * aq[l];
+                            }
+                        }
+
+                        // the rotations making the columns p and q orthogonal
+                        for (int l = 0; l < B; ++l) {
+                            const bool rotate = std::fabs(gamma[l]) > eps * std::sqrt(alpha[l] * beta[l]);
+                            const double zeta = rotate ? (beta[l] - alpha[l]) / (2.0 * gamma[l]) : 0.0;
+                            const double t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                            c[l] = rotate ? 1.0 / std::sqrt(1.0 + t * t) : 1.0;
+                            s[l] = rotate ? c[l] * t : 0.0;
+                            rotated += rotate;
+                        }
+
+                        // the rotated columns go through local buffers first, so that the compiler doesn't have to
+                        // prove that the columns p and q never overlap
+                        for (int k = 0; k < 2; ++k) {
+                            double *m = (k == 0) ? a : v;
+                            for (int i = 0; i < N; ++i) {
+                                double *mp = m + (i * N + p) * B;
+                                double *mq = m + (i * N + q) * B;
+                                for (int l = 0; l < B; ++l) {
+                                    xp[l] = c[l] * mp[l] - s[l] * mq[l];
+                                    xq[l] = s[l] * mp[l] + c[l] * mq[l];
+                                }
+                                for (int l = 0; l < B; ++l)
+                                    mp[l] = xp[l];
+                                for (int l = 0; l < B; ++l)
+                                    mq[l] = xq[l];
+                            }
+                        }
+                    }
+                }
+                if (rotated == 0)
+                    break;
+            }
+        }
+
+
+        // The order of the columns of the l_th matrix of a block (after the Jacobi sweeps) by decreasing singular
+        // values, which are returned in sigma.
+        template <int N>
+        void sort_singular_values(const double *a, int l, double *sigma, int *order) {
+            for (int j = 0; j < N; ++j) {
+                double sum = 0.0;
+                for (int i = 0; i < N; ++i) {
+                    const double x = a[(i * N + j) * kBatchBlock + l];
+                    sum += x * x;
+                }
+                sigma[j] = std::sqrt(sum);
+                order[j] = j;
+            }
+            for (int i = 1; i < N; ++i) {   // insertion sort
+                for (int j = i; j > 0 && sigma[order[j]] > sigma[order[j - 1]]; --j)
+                    std::swap(order[j], order[j - 1]);
+            }
+        }
+
+
+        template <int N>
+        void svd_decompose_batch(std::size_t count, const double *A, double *U, double *S, double *V) {
+            parallel_for_blocks(count, [=](std::size_t begin, std::size_t end) {
+                const std::size_t B = kBatchBlock;
+                double a[N * N * kBatchBlock], v[N * N * kBatchBlock];
+                for (std::size_t first = begin; first < end; first += B) {
+                    const int lanes = static_cast<int>(std::min(B, end - first));
+                    for (int e = 0; e < N * N; ++e) {
+                        std::copy(A + e * count + first, A + e * count + first + lanes, a + e * B);
+                        std::fill(a + e * B + lanes, a + (e + 1) * B, 0.0);
+                    }
+
+                    jacobi_sweeps<N>(a, v);
+
+                    for (int l = 0; l < lanes; ++l) {
+                        const std::size_t k = first + l;
+                        double sigma[N];
+                        int order[N];
+                        sort_singular_values<N>(a, l, sigma, order);
+
+                        if (S) {
+                            for (int j = 0; j < N; ++j)
+                                S[j * count + k] = sigma[order[j]];
+                        }
+                        if (V) {
+                            for (int i = 0; i < N; ++i) {
+                                for (int j = 0; j < N; ++j)
+                                    V[(i * N + j) * count + k] = v[(i * N + order[j]) * B + l];
+                            }
+                        }
+                        if (U) {
+                            // U = A * V * S^-1. The columns of (numerically) zero singular values are completed to
+                            // an orthonormal basis by Gram-Schmidt on the unit vectors.
+                            double u[N][N];   // the columns of U
+                            int next_unit = 0;
+                            for (int j = 0; j < N; ++j) {
+                                const double s = sigma[order[j]];
+                                if (s > N * std::numeric_limits<double>::epsilon() * sigma[order[0]]) {
+                                    for (int i = 0; i < N; ++i)
+                                        u[j][i] = a[(i * N + order[j]) * B + l] / s;
+                                    continue;
+                                }
+                                double norm = 0.0;
+                                while (norm < 0.5 && next_unit < N) {
+                                    for (int i = 0; i < N; ++i)
+                                        u[j][i] = (i == next_unit) ? 1.0 : 0.0;
+                                    ++next_unit;
+                                    for (int jj = 0; jj < j; ++jj) {
+                                        double d = 0.0;
+                                        for (int i = 0; i < N; ++i)
+                                            d += u[j][i] * u[jj][i];
+                                        for (int i = 0; i < N; ++i)
+                                            u[j][i] -= d * u[jj][i];
+                                    }
+                                    norm = 0.0;
+                                    for (int i = 0; i < N; ++i)
+                                        norm += u[j][i] * u[j][i];
+                                    norm = std::sqrt(norm);
+                                }
+                                for (int i = 0; i < N; ++i)
+                                    u[j][i] /= norm;
+                            }
+                            for (int i = 0; i < N; ++i) {
+                                for (int j = 0; j < N; ++j)
+                                    U[(i * N + j) * count + k] = u[j][i];
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+
+        template <int N>
+        void null_vector_batch(std::size_t count, const double *A, double *x) {
+            parallel_for_blocks(count, [=](std::size_t begin, std::size_t end) {
+                const std::size_t B = kBatchBlock;
+                double a[N * N * kBatchBlock], v[N * N * kBatchBlock];
+                for (std::size_t first = begin; first < end; first += B) {
+                    const int lanes = static_cast<int>(std::min(B, end - first));
+                    for (int e = 0; e < N * N; ++e) {
+                        std::copy(A + e * count + first, A + e * count + first + lanes, a + e * B);
+                        std::fill(a + e * B + lanes, a + (e + 1) * B, 0.0);
+                    }
+
+                    jacobi_sweeps<N>(a, v);
+
+                    for (int l = 0; l < lanes; ++l) {
+                        double sigma[N];
+                        int order[N];
+                        sort_singular_values<N>(a, l, sigma, order);
+                        for (int i = 0; i < N; ++i)
+                            x[i * count + first + l] = v[(i * N + order[N - 1]) * B + l];
+                    }
+                }
+            });
+        }
+
+
+        // The vector operations of the iterative solvers.
+
+        double dot(const std::vector<double> &a, const std::vector<double> &b) {
+            double sum = 0.0;
+            for (std::size_t i = 0; i < a.size(); ++i)
+                sum += a[i] * b[i];
+            return sum;
+        }
+
+
+        double norm(const std::vector<double> &a) {
+            return std::sqrt(dot(a, a));
+        }
+
+
+        // y += s * x
+        void axpy(double s, const std::vector<double> &x, std::vector<double> &y) {
+            for (std::size_t i = 0; i < y.size(); ++i)
+                y[i] += s * x[i];
+        }
+
+
+        // The iterative solvers. Each returns the number of iterations, or -1 if it didn't converge. x is zero on input.
+
+        int cgls(const SparseMatrix &A, const std::vector<double> &b, std::vector<double> &x, double tolerance,
+                 int max_iterations) {
+            std::vector<double> r(b), s(A.cols()), p(A.cols()), q(A.rows());
+            A.mult_transpose(r.data(), s.data());
+            p = s;
+            double gamma = dot(s, s);
+            const double stop = tolerance * std::sqrt(gamma);
+            if (gamma == 0.0)
+                return 0;
+
+            for (int iter = 1; iter <= max_iterations; ++iter) {
+                A.mult(p.data(), q.data());
+                const double qq = dot(q, q);
+                if (qq == 0.0)
+                    return iter;
+                const double alpha = gamma / qq;
+                axpy(alpha, p, x);
+                axpy(-alpha, q, r);
+                A.mult_transpose(r.data(), s.data());
+                const double gamma_new = dot(s, s);
+                if (std::sqrt(gamma_new) <= stop)
+                    return iter;
+                const double beta = gamma_new / gamma;
+                gamma = gamma_new;
+                for (std::size_t i = 0; i < p.size(); ++i)
+                    p[i] = s[i] + beta * p[i];
+            }
+            return -1;
+        }
+
+
+        int pcg_normal(const SparseMatrix &A, const std::vector<double> &b, std::vector<double> &x, double tolerance,
+                       int max_iterations) {
+            // the Jacobi preconditioner, i.e., the diagonal of A^T * A (the squared norms of the columns of A)
+            std::vector<double> d(A.cols(), 0.0);
+            for (long k = 0; k < A.nonzeros(); ++k)
+                d[A.col_indices()[k]] += A.values()[k] * A.values()[k];
+            for (std::size_t i = 0; i < d.size(); ++i)
+                d[i] = (d[i] > 0.0) ? 1.0 / d[i] : 1.0;
+
+            // r is the residual of the normal equations, updated by (A^T * A) * p instead of being recomputed
+            std::vector<double> r(A.cols()), z(A.cols()), p(A.cols()), q(A.rows()), Np(A.cols());
+            A.mult_transpose(b.data(), r.data());
+            const double stop = tolerance * norm(r);
+            if (stop == 0.0)
+                return 0;
+            for (std::size_t i = 0; i < z.size(); ++i)
+                z[i] = d[i] * r[i];
+            p = z;
+            double rz = dot(r, z);
+
+            for (int iter = 1; iter <= max_iterations; ++iter) {
+                A.mult(p.data(), q.data());
+                const double qq = dot(q, q);
+                if (qq == 0.0)
+                    return iter;
+                A.mult_transpose(q.data(), Np.data());
+                const double alpha = rz / qq;
+                axpy(alpha, p, x);
+                axpy(-alpha, Np, r);
+                if (norm(r) <= stop)
+                    return iter;
+                for (std::size_t i = 0; i < z.size(); ++i)
+                    z[i] = d[i] * r[i];
+                const double rz_new = dot(r, z);
+                const double beta = rz_new / rz;
+                rz = rz_new;
+                for (std::size_t i = 0; i < p.size(); ++i)
+                    p[i] = z[i] + beta * p[i];
+            }
+            return -1;
+        }
+
+
+        // C. C. Paige and M. A. Saunders. LSQR: An algorithm for sparse linear equations and sparse least squares.
+        // ACM Transactions on Mathematical Software, 8(1), 1982.
+        int lsqr(const SparseMatrix &A, const std::vector<double> &b, std::vector<double> &x, double tolerance,
+                 int max_iterations) {
+            // the Golub-Kahan bidiagonalization, starting with beta * u = b and alpha * v = A^T * u
+            std::vector<double> u(b), v(A.cols()), w(A.cols()), tmp_u(A.rows()), tmp_v(A.cols());
+            double beta = norm(u);
+            if (beta == 0.0)
+                return 0;
+            for (std::size_t i = 0; i < u.size(); ++i)
+                u[i] /= beta;
+            A.mult_transpose(u.data(), v.data());
+            double alpha = norm(v);
+            if (alpha == 0.0)
+                return 0;
+            for (std::size_t i = 0; i < v.size(); ++i)
+                v[i] /= alpha;
+            w = v;
+
+            const double stop = tolerance * alpha * beta;   // ||A^T * b|| = alpha * beta
+            double phibar = beta, rhobar = alpha;
+            for (int iter = 1; iter <= max_iterations; ++iter) {
+                A.mult(v.data(), tmp_u.data());
+                for (std::size_t i = 0; i < u.size(); ++i)
+                    u[i] = tmp_u[i] - alpha * u[i];
+                beta = norm(u);
+                if (beta > 0.0) {
+                    for (std::size_t i = 0; i < u.size(); ++i)
+                        u[i] /= beta;
+                }
+                A.mult_transpose(u.data(), tmp_v.data());
+                for (std::size_t i = 0; i < v.size(); ++i)
+                    v[i] = tmp_v[i] - beta * v[i];
+                alpha = norm(v);
+                if (alpha > 0.0) {
+                    for (std::size_t i = 0; i < v.size(); ++i)
+                        v[i] /= alpha;
+                }
+
+                // eliminate the subdiagonal of the bidiagonal matrix by a plane rotation
+                const double rho = std::sqrt(rhobar * rhobar + beta * beta);
+                const double c = rhobar / rho;
+                const double s = beta / rho;
+                const double theta = s * alpha;
+                rhobar = -c * alpha;
+                const double phi = c * phibar;
+                phibar = s * phibar;
+
+                for (std::size_t i = 0; i < x.size(); ++i) {
+                    x[i] += (phi / rho) * w[i];
+                    w[i] = v[i] - (theta / rho) * w[i];
+                }
+
+                // ||A^T * r|| of the current estimate, without computing r
+                if (phibar * alpha * std::fabs(c) <= stop)
+                    return iter;
+            }
+            return -1;
+        }
+
+    }
+
+
     double determinant(const Matrix &A) {
         const int m = A.rows();
         const int n = A.cols();
-        Eigen::MatrixXd C(m, n);
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j)
-                C(i, j) = A(i, j);
+        if (m == n) {
+            switch (n) {
+                case 2: return fixed_determinant<2>(A);
+                case 3: return fixed_determinant<3>(A);
+                case 4: return fixed_determinant<4>(A);
+                default: break;
+            }
         }
-        return C.determinant();
+
+        // the LU decomposition is computed in its own (column-major) storage anyway
+        return Eigen::PartialPivLU<Eigen::MatrixXd>(map(A)).determinant();
     }
 
 
@@ -51,18 +595,16 @@ namespace easy3d {
             return false;
         }
 
-        Eigen::MatrixXd C(m, n);
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j)
-                C(i, j) = A(i, j);
-        }
-
         invA.resize(m, n);
-        const Eigen::MatrixXd invC = C.inverse();
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j)
-                invA(i, j) = invC(i, j);
+        switch (n) {
+            case 2: fixed_inverse<2>(A, invA); return true;
+            case 3: fixed_inverse<3>(A, invA); return true;
+            case 4: fixed_inverse<4>(A, invA); return true;
+            default: break;
         }
+
+        const Eigen::PartialPivLU<Eigen::MatrixXd> lu(map(A));
+        map(invA) = lu.inverse();
         return true;
     }
 
@@ -79,33 +621,120 @@ namespace easy3d {
     }
 
     
-    void svd_decompose(const Matrix &A, Matrix &U, Matrix &S, Matrix &V) {
+    bool symmetric_eigen(const Matrix &A, Vector &values, Matrix &vectors) {
+        const int n = A.rows();
+        if (A.cols() != n) {
+            std::cerr << "could not compute eigen-decomposition: A is not square" << std::endl;
+            return false;
+        }
+
+        bool converged;
+        switch (n) {
+            case 2: converged = fixed_symmetric_eigen<2>(A, values, vectors); break;
+            case 3: converged = fixed_symmetric_eigen<3>(A, values, vectors); break;
+            case 4: converged = fixed_symmetric_eigen<4>(A, values, vectors); break;
+            case 9: converged = fixed_symmetric_eigen<9>(A, values, vectors); break;
+            case 12: converged = fixed_symmetric_eigen<12>(A, values, vectors); break;
+            default: {
+                vectors.resize(n, n);
+                std::vector<double *> rows(n);
+                for (int i = 0; i < n; ++i)
+                    rows[i] = vectors[i];
+                std::vector<double> subd(n);
+                values.resize(n);
+                converged = (n == 0) || eigen_solver(A.data(), n, rows.data(), values.data(), subd.data());
+                break;
+            }
+        }
+        if (!converged)
+            std::cerr << "could not compute eigen-decomposition: no convergence" << std::endl;
+        return converged;
+    }
+
+
+    void svd_decompose(const Matrix &A, Matrix &U, Matrix &S, Matrix &V, SVDMethod method, SVDOutput output) {
         const int m = A.rows();
         const int n = A.cols();
-        Eigen::MatrixXd C(m, n);
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j)
-                C(i, j) = A(i, j);
+
+        switch (method) {
+            case SVD_SYMMETRIC_EIGEN:
+                return symmetric_eigen_svd(A, output, S, V);
+            case SVD_BDC:
+                return extract_svd(Eigen::BDCSVD<Eigen::MatrixXd>(map(A), svd_options(output)), output, U, S, V);
+            default:
+                break;
         }
 
-        Eigen::JacobiSVD<Eigen::MatrixXd> svd(C, Eigen::ComputeFullU | Eigen::ComputeFullV);
-        const Eigen::MatrixXd &eU = svd.matrixU();
-        const Eigen::MatrixXd &eV = svd.matrixV();
-        const auto &eS = svd.singularValues();
+        if (m == 3 && n == 3)
+            return fixed_svd<3, 3>(A, output, U, S, V);
+        else if (m == 4 && n == 4)
+            return fixed_svd<4, 4>(A, output, U, S, V);
+        else if (m == 3 && n == 4)
+            return fixed_svd<3, 4>(A, output, U, S, V);
+
+        extract_svd(Eigen::JacobiSVD<Eigen::MatrixXd>(map(A), svd_options(output)), output, U, S, V);
+    }
+
+
+    void null_vector(const Matrix &A, Vector &x, SVDMethod method) {
+        const int m = A.rows();
+        const int n = A.cols();
+        x.resize(n);
+        Eigen::Map<Eigen::VectorXd> X(x.data(), n);
 
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < m; ++j)
-                U(i, j) = eU(i, j);
+        switch (method) {
+            case SVD_SYMMETRIC_EIGEN: {
+                Matrix AtA(n, n), vectors(n, n);
+                map(AtA) = normal_matrix(A);
+                Vector values(n);
+                symmetric_eigen(AtA, values, vectors);
+                for (int i = 0; i < n; ++i)
+                    X(i) = vectors(i, 0);
+                return;
+            }
+            case SVD_BDC:
+                X = Eigen::BDCSVD<Eigen::MatrixXd>(map(A), Eigen::ComputeFullV).matrixV().col(n - 1);
+                return;
+            default:
+                break;
         }
 
-        for (int i = 0; i < n; ++i) {
-            for (int j = 0; j < n; ++j)
-                V(i, j) = eV(i, j);
+        if (m == 3 && n == 3)
+            return fixed_null_vector<3, 3>(A, X);
+        else if (m == 4 && n == 4)
+            return fixed_null_vector<4, 4>(A, X);
+
+        X = Eigen::JacobiSVD<Eigen::MatrixXd>(map(A), Eigen::ComputeFullV).matrixV().col(n - 1);
+    }
+
+
+    Vector null_vector(const Matrix &A, SVDMethod method) {
+        Vector x(A.cols());
+        null_vector(A, x, method);
+        return x;
+    }
+
+
+    bool svd_decompose_batch(int n, std::size_t count, const double *A, double *U, double *S, double *V) {
+        switch (n) {
+            case 3: svd_decompose_batch<3>(count, A, U, S, V); return true;
+            case 4: svd_decompose_batch<4>(count, A, U, S, V); return true;
+            default:
+                std::cerr << "could not decompose: only batches of 3 by 3 and 4 by 4 matrices are supported" << std::endl;
+                return false;
         }
+    }
 
-        S.load_zero();
-        for (int i = 0; i < std::min(m, n); ++i)
-            S(i, i) = eS(i);
+
+    bool null_vector_batch(int n, std::size_t count, const double *A, double *x) {
+        switch (n) {
+            case 3: null_vector_batch<3>(count, A, x); return true;
+            case 4: null_vector_batch<4>(count, A, x); return true;
+            default:
+                std::cerr << "could not compute null vectors: only batches of 3 by 3 and 4 by 4 matrices are supported"
+                          << std::endl;
+                return false;
+        }
     }
 
 
@@ -122,34 +751,82 @@ namespace easy3d {
             return false;
         }
 
-        Eigen::MatrixXd M(m, n);
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j)
-                M(i, j) = A(i, j);
-        }
-
-        Eigen::MatrixXd C(m, 1);
-        for (int i = 0; i < n; ++i)
-            C(i, 0) = b[i];
+        const Eigen::Map<const Eigen::VectorXd> B(b.data(), m);
+        x.resize(n);
+        Eigen::Map<Eigen::VectorXd> X(x.data(), n);
 
         // https://eigen.tuxfamily.org/dox/group__LeastSquares.html
 #if 0
         // The solve() method in the BDCSVD class can be directly used to solve linear squares systems. It is not
         // enough to compute only the singular values (the default for this class); you also need the singular
         // vectors but the thin SVD decomposition suffices for computing least squares solutions.
-        Eigen::MatrixXd X = M.bdcSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(C);
+        X = Eigen::BDCSVD<Eigen::MatrixXd>(map(A), Eigen::ComputeThinU | Eigen::ComputeThinV).solve(B);
 #else
         // The solve() method in QR decomposition classes also computes the least squares solution. There are three
         // QR decomposition classes: HouseholderQR (no pivoting, so fast but unstable), ColPivHouseholderQR (column
         // pivoting, thus a bit slower but more accurate) and FullPivHouseholderQR (full pivoting, so slowest and
         // most stable). Here we use the one with column pivoting.
-        Eigen::MatrixXd X = M.colPivHouseholderQr().solve(C);
+        X = Eigen::ColPivHouseholderQR<Eigen::MatrixXd>(map(A)).solve(B);
 #endif
 
-        x.resize(n);
-        for (int i = 0; i < n; ++i)
-            x[i] = X(i, 0);
+        return true;
+    }
 
+
+    bool solve_least_squares(const SparseMatrix &A, const std::vector<double> &b, std::vector<double> &x,
+                             IterativeMethod method, double tolerance, int max_iterations) {
+        if (static_cast<std::size_t>(A.rows()) != b.size()) {
+            std::cerr << "could not solve: sizes of A and b don't match" << std::endl;
+            return false;
+        }
+        if (max_iterations <= 0)
+            max_iterations = std::max(100, 4 * A.cols());
+
+        x.assign(A.cols(), 0.0);
+        int iterations = -1;
+        switch (method) {
+            case ITERATIVE_CGLS:
+                iterations = cgls(A, b, x, tolerance, max_iterations);
+                break;
+            case ITERATIVE_LSQR:
+                iterations = lsqr(A, b, x, tolerance, max_iterations);
+                break;
+            case ITERATIVE_PCG:
+                iterations = pcg_normal(A, b, x, tolerance, max_iterations);
+                break;
+        }
+        if (iterations < 0) {
+            std::cerr << "could not solve: no convergence in " << max_iterations << " iterations" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+
+    bool decompose_projection(const Matrix &M, Matrix33 &K, Matrix33 &R, Vector3D &t) {
+        if (M.rows() != 3 || M.cols() != 4) {
+            std::cerr << "could not decompose: M is not a 3 by 4 matrix" << std::endl;
+            return false;
+        }
+
+        double m[3][4], k[3][3], r[3][3], v[3];
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 4; ++j)
+                m[i][j] = M(i, j);
+        }
+
+        if (!easy3d::decompose_projection(m, k, r, v)) {
+            std::cerr << "could not decompose: M is degenerate" << std::endl;
+            return false;
+        }
+
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                K(i, j) = k[i][j];
+                R(i, j) = r[i][j];
+            }
+            t[i] = v[i];
+        }
         return true;
     }
-}
\ No newline at end of file
+}
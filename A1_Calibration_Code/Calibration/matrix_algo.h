@@ -27,6 +27,7 @@
 
 
 #include "matrix.h"
+#include "sparse_matrix.h"
 
 namespace easy3d {
 
@@ -56,8 +57,43 @@ namespace easy3d {
     Matrix inverse(const Matrix &A);
 
 
+    /// The algorithms computing a singular value decomposition.
+    enum SVDMethod {
+        SVD_JACOBI,         ///< Eigen's JacobiSVD, the most accurate one and fast for small matrices (the default)
+        SVD_BDC,            ///< Eigen's BDCSVD (divide and conquer), much faster for large matrices
+        /// The eigen-decomposition of the (small) symmetric matrix A^T * A. It is the fastest for tall matrices, but
+        /// it squares the condition number, so it is only suited for well-conditioned (e.g., normalized) data. U is
+        /// not computed.
+        SVD_SYMMETRIC_EIGEN
+    };
+
+    /// The parts of a singular value decomposition to compute.
+    enum SVDOutput {
+        SVD_FULL,           ///< U, S, and V (the default)
+        SVD_THIN_U,         ///< the first min(M, N) columns of U only, i.e., U is M by min(M, N), S is min(M, N) by N
+        SVD_VALUES_ONLY     ///< the singular values (i.e., S) only, U and V are left untouched
+    };
+
+
+    /**
+     * Compute the eigenvalues and eigenvectors of a symmetric matrix. Many problems reduce to the eigenvector of the
+     * smallest eigenvalue of a small symmetric matrix, e.g., that of A^T * A is the null vector of A. This uses
+     * easy3d's EigenSolver (Householder tridiagonalization and the QL algorithm), which is several times faster than
+     * an SVD of the same matrix.
+     *
+     * @param A The n by n symmetric matrix. Only its lower triangle is used.
+     * @param values The eigenvalues in increasing order (n dimensional).
+     * @param vectors The eigenvectors, stored as the columns in the same order as the values (n by n).
+     * @return false if failed (i.e., A is not square or the iterations didn't converge).
+     * @note values and vectors are resized if needed. The 2, 3, 4, 9 (e.g., W^T * W of the fundamental matrix) and 12
+     *      (e.g., P^T * P of the calibration) dimensional matrices are processed on the stack.
+     */
+    bool symmetric_eigen(const Matrix &A, Vector &values, Matrix &vectors);
+
+
     /**
-     * Compute the Singular Value Decomposition (SVD) of an M by N matrix. This is a wrapper around Eigen's JacobiSVD.
+     * Compute the Singular Value Decomposition (SVD) of an M by N matrix. This is a wrapper around Eigen's JacobiSVD
+     * (or the algorithm selected by method).
      *
      * For an m-by-n matrix A, the singular value decomposition is an m-by-m orthogonal matrix U, an m-by-n diagonal
      * matrix S, and an n-by-n orthogonal matrix V so that A = U*S*V^T.
@@ -70,12 +106,70 @@ namespace easy3d {
      * @param U The left side M by M orthogonal matrix.
      * @param S The middle M by N diagonal matrix, with zero elements outside of its main diagonal.
      * @param V The right side N by N orthogonal matrix V.
+     * @param method The algorithm to use.
+     * @param output The parts of the decomposition to compute. The full U is M by M, which is huge for tall matrices
+     *      and often not needed.
      *
      * @return Upon return, U, S, and V carry the result of the SVD decomposition.
      *
      * @attention V is returned (instead of V^T).
+     * @note U, S, and V are resized if needed. 3 by 3, 4 by 4, and 3 by 4 matrices are decomposed using fixed-size
+     *       Eigen types, which avoids any allocation.
+     */
+    void svd_decompose(const Matrix &A, Matrix &U, Matrix &S, Matrix &V,
+                       SVDMethod method = SVD_JACOBI, SVDOutput output = SVD_FULL);
+
+
+    /**
+     * Compute the right singular vector of a matrix corresponding to its smallest singular value, i.e., the unit vector
+     * x minimizing ||Ax|| (the solution of a homogeneous linear system Ax = 0, e.g., in DLT methods). This is the last
+     * column of V of the SVD, but neither U nor S is computed.
+     * @param A The M by N input matrix.
+     * @param x Returns the N dimensional null vector.
+     * @param method The algorithm to use.
+     */
+    void null_vector(const Matrix &A, Vector &x, SVDMethod method = SVD_JACOBI);
+
+
+    /**
+     * Compute the right singular vector of a matrix corresponding to its smallest singular value.
+     * @param A The M by N input matrix.
+     * @param method The algorithm to use.
+     * @return The N dimensional null vector.
+     */
+    Vector null_vector(const Matrix &A, SVDMethod method = SVD_JACOBI);
+
+
+    /**
+     * Compute the SVDs of many small N by N matrices (N = 3 or 4) at once, e.g., of the 4 by 4 systems triangulating
+     * thousands of points. The matrices are decomposed by one-sided Jacobi sweeps running on blocks of matrices, with
+     * the innermost loops over the matrices of a block so that the compiler can vectorize them. Large batches are
+     * split among threads.
+     *
+     * All arrays store the batch as a structure of arrays: element e (in row-major order) of the k_th matrix is at
+     * [e * count + k], so the same element of consecutive matrices is contiguous.
+     *
+     * @param n The size of the matrices (3 or 4).
+     * @param count The number of matrices.
+     * @param A The input matrices (n * n * count elements).
+     * @param U Returns the left singular vectors (n * n * count elements), or nullptr if not needed.
+     * @param S Returns the singular values (n * count elements) in decreasing order, or nullptr if not needed.
+     * @param V Returns the right singular vectors (n * n * count elements), or nullptr if not needed.
+     * @return false if n is not supported.
+     */
+    bool svd_decompose_batch(int n, std::size_t count, const double *A, double *U, double *S, double *V);
+
+
+    /**
+     * Compute the null vectors (i.e., the right singular vectors corresponding to the smallest singular values) of
+     * many small N by N matrices (N = 3 or 4) at once. See svd_decompose_batch() for the algorithm and the layout.
+     * @param n The size of the matrices (3 or 4).
+     * @param count The number of matrices.
+     * @param A The input matrices (n * n * count elements).
+     * @param x Returns the null vectors (n * count elements), i.e., element i of the k_th vector is at [i * count + k].
+     * @return false if n is not supported.
      */
-    void svd_decompose(const Matrix &A, Matrix &U, Matrix &S, Matrix &V);
+    bool null_vector_batch(int n, std::size_t count, const double *A, double *x);
 
 
     /**
@@ -87,6 +181,51 @@ namespace easy3d {
      * @return false if failed. If true, x carries the least-squares solution to the linear system.
      */
     bool solve_least_squares(const Matrix &A, const std::vector<double> &b, std::vector<double> &x);
+
+
+    /// The iterative methods solving a sparse linear system in the least squares sense. All of them only need the
+    /// products of A and A^T with vectors, i.e., A^T * A is never formed.
+    enum IterativeMethod {
+        ITERATIVE_CGLS, ///< conjugate gradients on the normal equations A^T * A * x = A^T * b
+        ITERATIVE_LSQR, ///< LSQR (Paige and Saunders), equivalent to CGLS but more stable for ill-conditioned systems
+        ITERATIVE_PCG   ///< conjugate gradients on the normal equations, preconditioned by the diagonal of A^T * A
+    };
+
+
+    /**
+     * Solve a sparse linear system (Ax=b) in the least squares sense by an iterative method. Each iteration costs one
+     * product with A and one with A^T (both parallel for large matrices), so the time and memory grow with the number
+     * of nonzero elements of A rather than its size. If A has more columns than rows (or is rank deficient), the
+     * solution of minimum norm is returned.
+     *
+     * @param A The m-by-n sparse coefficient matrix.
+     * @param b The right-hand constant vector (m dimensional).
+     * @param x The result of the system was successfully solved (n dimensional).
+     * @param method The iterative method.
+     * @param tolerance The iterations stop when the residual of the normal equations, ||A^T * (b - A * x)||, drops
+     *      below tolerance * ||A^T * b||.
+     * @param max_iterations The maximum number of iterations. If not positive, max(100, 4 * n) is used.
+     * @return false if failed (i.e., the sizes don't match or it didn't converge). If it didn't converge, x still
+     *      carries the last estimate of the solution.
+     */
+    bool solve_least_squares(const SparseMatrix &A, const std::vector<double> &b, std::vector<double> &x,
+                             IterativeMethod method = ITERATIVE_LSQR, double tolerance = 1e-10, int max_iterations = 0);
+
+
+    /**
+     * Decompose a 3 by 4 camera projection matrix M = s * K * [R, t] into its intrinsic and extrinsic parameters.
+     *
+     * The left 3 by 3 block of M is factored by an RQ decomposition using three Givens rotations on fixed-size arrays,
+     * so no trigonometric function is evaluated and nothing is allocated. The unknown scale s (including its sign)
+     * is factored out such that K[2][2] = 1, the diagonal of K is positive, and det(R) = 1.
+     *
+     * @param M The 3 by 4 projection matrix, e.g., the null vector of the calibration linear system.
+     * @param K Returns the 3 by 3 intrinsic matrix, i.e., [fx, skew, cx; 0, fy, cy; 0, 0, 1].
+     * @param R Returns the 3 by 3 rotation matrix.
+     * @param t Returns the translation vector, i.e., p = K * (R * P + t).
+     * @return false if failed (M is not 3 by 4, or its left 3 by 3 block is singular).
+     */
+    bool decompose_projection(const Matrix &M, Matrix33 &K, Matrix33 &R, Vector3D &t);
 }
 
 #endif // EASY3D_MATRIX_ALGOTHMS_H
@@ -0,0 +1,272 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_CORE_MEMORY_ARENA_H
+#define EASY3D_CORE_MEMORY_ARENA_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+
+namespace easy3d {
+
+
+    /// A bump-pointer allocator for the elements of short-lived matrices and vectors. Memory is taken from large
+    /// blocks by moving a pointer, and it is released all at once by moving the pointer back (see rewind()). The
+    /// blocks are kept for reuse, so a loop that runs in an ArenaScope doesn't allocate any memory after its first
+    /// iteration.
+    /// Each thread has its own arena, which Matrix and Vector draw from while an ArenaScope is active on that thread.
+    class MemoryArena {
+    public:
+        /// A position in the arena, i.e., everything allocated after it is released by rewind().
+        struct Mark {
+            std::size_t block;
+            std::size_t offset;
+        };
+
+        /// Constructs an arena that reserves memory in blocks of (at least) block_size elements.
+        explicit MemoryArena(std::size_t block_size = 64 * 1024);
+
+        ~MemoryArena();
+
+        /// Returns uninitialized storage for n elements. A larger block is reserved if n exceeds the block size.
+        double *allocate(std::size_t n);
+
+        /// Whether p (of n elements) is the latest allocation, i.e., the storage on top of the arena.
+        bool is_latest(const double *p, std::size_t n) const {
+            return block_ < blocks_.size() && n <= offset_ && p == blocks_[block_].data + offset_ - n;
+        }
+
+        /// Gives back the storage of n elements, which must be the latest allocation (see is_latest()), i.e.,
+        /// temporaries destroyed in the reverse order of their creation are recycled immediately. Any other storage is
+        /// released by the next rewind().
+        void deallocate(double *p, std::size_t n);
+
+        /// The current position of the arena.
+        Mark mark() const { return Mark{block_, offset_}; }
+
+        /// Releases everything allocated after mark m in O(1), i.e., no memory is freed or touched.
+        void rewind(const Mark &m) {
+            block_ = m.block;
+            offset_ = m.offset;
+        }
+
+        /// The total number of elements reserved by the arena (i.e., its peak usage).
+        std::size_t capacity() const;
+
+        /// Returns the arena of the calling thread if an ArenaScope is active on it, otherwise NULL.
+        static MemoryArena *current() { return active(); }
+
+    private:
+        friend class ArenaScope;
+
+        // the arena owned by the calling thread (created on its first use)
+        static MemoryArena &thread_arena();
+
+        // the arena Matrix and Vector draw from on the calling thread, NULL outside of any scope
+        static MemoryArena *&active();
+
+        // copying would free the blocks twice
+        MemoryArena(const MemoryArena &);
+        MemoryArena &operator=(const MemoryArena &);
+
+    private:
+        struct Block {
+            double *data;
+            std::size_t size;
+        };
+        std::vector<Block> blocks_;
+        std::size_t block_;     // the block being filled
+        std::size_t offset_;    // the number of elements used in that block
+        std::size_t block_size_;
+    };
+
+
+    /// Makes Matrix and Vector allocate their elements from the arena of the calling thread while it exists, e.g.,
+    ///     \code
+    ///         for (...) {
+    ///             ArenaScope scope;
+    ///             Matrix A = ...;     // no new/delete after the first iteration
+    ///         }
+    ///     \endcode
+    /// Everything allocated in the scope is released at once when it ends. Scopes can be nested, and an inner scope
+    /// only releases what was allocated in it.
+    /// \attention A matrix or vector that gets its storage in a scope must not be used after the scope ends. This also
+    ///     holds for a matrix or vector created outside but (re)allocated in the scope, e.g., by resize() to a larger
+    ///     size or by assigning a larger matrix to it. Fixed-size matrices and vectors (e.g., Matrix33 and Vector3D)
+    ///     store their elements inline and are not affected. Moving a temporary into a matrix or vector only takes
+    ///     over its storage if both come from the arena or both from the heap (see details::can_take_elements()), so
+    ///     a matrix that lives on the heap stays there, e.g.,
+    ///     \code
+    ///         Matrix A(3, 3, 0.0);
+    ///         {
+    ///             ArenaScope scope;
+    ///             A = B * C;          // the product is copied into the heap storage of A
+    ///         }
+    ///     \endcode
+    class ArenaScope {
+    public:
+        ArenaScope();
+        ~ArenaScope();
+
+    private:
+        ArenaScope(const ArenaScope &);
+        ArenaScope &operator=(const ArenaScope &);
+
+    private:
+        MemoryArena *previous_;
+        MemoryArena::Mark mark_;
+    };
+
+
+    namespace details {
+
+        /// Allocates the storage of n elements for a Matrix or a Vector, from the arena if an ArenaScope is active and
+        /// otherwise from the heap. in_arena tells where it comes from, which must be passed to free_elements().
+        double *allocate_elements(std::size_t n, bool &in_arena);
+
+        /// Frees the storage allocated by allocate_elements().
+        void free_elements(double *p, std::size_t n, bool in_arena);
+
+        /// Whether a Matrix or a Vector can take over the storage of another one (from the arena if src_in_arena),
+        /// instead of copying its elements. This is only the case if the storage comes from where its own does (or
+        /// would, if has_storage is false), so a matrix or vector on the heap never ends up in the arena.
+        bool can_take_elements(bool has_storage, bool in_arena, bool src_in_arena);
+
+    }
+
+}
+
+
+// ----------------------- Implementation -----------------------------
+
+
+namespace easy3d {
+
+
+    inline MemoryArena::MemoryArena(std::size_t block_size)
+            : block_(0), offset_(0), block_size_(block_size > 0 ? block_size : 1) {
+    }
+
+
+    inline MemoryArena::~MemoryArena() {
+        for (std::size_t i = 0; i < blocks_.size(); ++i)
+            delete[] blocks_[i].data;
+    }
+
+
+    inline double *MemoryArena::allocate(std::size_t n) {
+        if (block_ < blocks_.size() && offset_ + n <= blocks_[block_].size) {
+            double *p = blocks_[block_].data + offset_;
+            offset_ += n;
+            return p;
+        }
+
+        // move on to the next block that is large enough (the skipped ones are unused until the next rewind)
+        std::size_t b = blocks_.empty() ? 0 : block_ + 1;
+        while (b < blocks_.size() && blocks_[b].size < n)
+            ++b;
+        if (b == blocks_.size()) {
+            const std::size_t size = (n > block_size_) ? n : block_size_;
+            blocks_.push_back(Block{new double[size], size});
+        }
+        block_ = b;
+        offset_ = n;
+        return blocks_[b].data;
+    }
+
+
+    inline void MemoryArena::deallocate(double *p, std::size_t n) {
+        assert(is_latest(p, n));
+        if (is_latest(p, n))
+            offset_ -= n;
+    }
+
+
+    inline std::size_t MemoryArena::capacity() const {
+        std::size_t size = 0;
+        for (std::size_t i = 0; i < blocks_.size(); ++i)
+            size += blocks_[i].size;
+        return size;
+    }
+
+
+    inline MemoryArena &MemoryArena::thread_arena() {
+        static thread_local MemoryArena arena;
+        return arena;
+    }
+
+
+    inline MemoryArena *&MemoryArena::active() {
+        static thread_local MemoryArena *arena = NULL;
+        return arena;
+    }
+
+
+    inline ArenaScope::ArenaScope() : previous_(MemoryArena::active()) {
+        MemoryArena &arena = MemoryArena::thread_arena();
+        mark_ = arena.mark();
+        MemoryArena::active() = &arena;
+    }
+
+
+    inline ArenaScope::~ArenaScope() {
+        MemoryArena::thread_arena().rewind(mark_);
+        MemoryArena::active() = previous_;
+    }
+
+
+    namespace details {
+
+        inline double *allocate_elements(std::size_t n, bool &in_arena) {
+            MemoryArena *arena = MemoryArena::current();
+            in_arena = (arena != NULL);
+            return in_arena ? arena->allocate(n) : new double[n];
+        }
+
+
+        inline void free_elements(double *p, std::size_t n, bool in_arena) {
+            if (!in_arena) {
+                delete[] p;
+                return;
+            }
+            // storage below the top of the arena (or of a scope that has ended) is released by the rewind
+            MemoryArena *arena = MemoryArena::current();
+            if (arena && arena->is_latest(p, n))
+                arena->deallocate(p, n);
+        }
+
+
+        inline bool can_take_elements(bool has_storage, bool in_arena, bool src_in_arena) {
+            const bool target_in_arena = has_storage ? in_arena : (MemoryArena::current() != NULL);
+            return target_in_arena == src_in_arena;
+        }
+
+    }
+
+}
+
+
+#endif // EASY3D_CORE_MEMORY_ARENA_H
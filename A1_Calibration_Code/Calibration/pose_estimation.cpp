@@ -0,0 +1,611 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "pose_estimation.h"
+#include "matrix_algo.h"
+
+#include <cmath>
+#include <limits>
+#include <iostream>
+
+
+namespace easy3d {
+
+    namespace {
+
+        // The pairs of control points. The distances between them are preserved by the rigid transformation,
+        // which gives the constraints to solve for the betas. With 3 control points (i.e., planar points), only the
+        // first 3 pairs exist.
+        const int kPairs[6][2] = {{0, 1}, {0, 2}, {1, 2}, {0, 3}, {1, 3}, {2, 3}};
+
+        // the betas are not divided by a (nearly) zero beta
+        const double kBetaEpsilon = 1e-12;
+
+
+        // The state of EPnP. The per-point data is stored in flat arrays (instead of Matrix/Vector instances) so
+        // the O(n) passes over the points don't allocate.
+        struct EPnP {
+            int n;
+            int m;                      // the number of control points, 4 (or 3 if the points are coplanar)
+            std::vector<double> pws;    // 3D points in the world frame, 3 x n
+            std::vector<double> us;     // normalized image points (i.e., K^-1 * p), 2 x n
+            std::vector<double> alphas; // barycentric coordinates w.r.t. the control points, 4 x n
+            std::vector<double> pcs;    // 3D points in the camera frame, 3 x n
+            double cws[4][3];           // control points in the world frame
+            double ccs[4][3];           // control points in the camera frame
+            double v[4][12];            // null space of M, v[0] corresponds to the smallest singular value
+            double L[6][10];
+            double rho[6];
+
+            int num_pairs() const { return m * (m - 1) / 2; }
+        };
+
+
+        // The first control point is the centroid, the others are along the principal directions. If the points are
+        // coplanar (e.g., the corners of a checkerboard), only the two directions in their plane are used, i.e., 3
+        // control points (the planar case of EPnP).
+        bool choose_control_points(EPnP &p) {
+            for (int k = 0; k < 3; ++k)
+                p.cws[0][k] = 0.0;
+            for (int i = 0; i < p.n; ++i) {
+                for (int k = 0; k < 3; ++k)
+                    p.cws[0][k] += p.pws[3 * i + k];
+            }
+            for (int k = 0; k < 3; ++k)
+                p.cws[0][k] /= p.n;
+
+            Matrix33 cov;
+            for (int i = 0; i < p.n; ++i) {
+                const double d[3] = {p.pws[3 * i] - p.cws[0][0],
+                                     p.pws[3 * i + 1] - p.cws[0][1],
+                                     p.pws[3 * i + 2] - p.cws[0][2]};
+                for (int r = 0; r < 3; ++r) {
+                    for (int c = 0; c < 3; ++c)
+                        cov(r, c) += d[r] * d[c];
+                }
+            }
+
+            Matrix33 U, S, V;
+            svd_decompose(cov, U, S, V);
+            if (S(1, 1) <= 1e-10 * S(0, 0)) {
+                std::cerr << "could not estimate pose: the 3D points are (nearly) collinear" << std::endl;
+                return false;
+            }
+            p.m = (S(2, 2) <= 1e-10 * S(0, 0)) ? 3 : 4;
+
+            for (int i = 1; i < p.m; ++i) {
+                const double k = std::sqrt(S(i - 1, i - 1) / p.n);
+                for (int j = 0; j < 3; ++j)
+                    p.cws[i][j] = p.cws[0][j] + k * V(j, i - 1);
+            }
+            return true;
+        }
+
+
+        // The control points are along orthogonal directions from the centroid, so the coordinates of a point are its
+        // projections onto these directions (which also holds in the planar case, where the points are in their plane).
+        void compute_barycentric_coordinates(EPnP &p) {
+            double axes[3][3];
+            for (int j = 1; j < p.m; ++j) {
+                double len2 = 0.0;
+                for (int k = 0; k < 3; ++k) {
+                    axes[j - 1][k] = p.cws[j][k] - p.cws[0][k];
+                    len2 += axes[j - 1][k] * axes[j - 1][k];
+                }
+                for (int k = 0; k < 3; ++k)
+                    axes[j - 1][k] /= len2;
+            }
+
+            p.alphas.assign(4 * p.n, 0.0);
+            for (int i = 0; i < p.n; ++i) {
+                const double *pw = &p.pws[3 * i];
+                const double d[3] = {pw[0] - p.cws[0][0], pw[1] - p.cws[0][1], pw[2] - p.cws[0][2]};
+                double *a = &p.alphas[4 * i];
+                a[0] = 1.0;
+                for (int j = 1; j < p.m; ++j) {
+                    a[j] = axes[j - 1][0] * d[0] + axes[j - 1][1] * d[1] + axes[j - 1][2] * d[2];
+                    a[0] -= a[j];
+                }
+            }
+        }
+
+
+        // Accumulates M^T * M (12 x 12, or 9 x 9 in the planar case) directly, instead of building the 2n x 12 matrix
+        // M, and extracts the eigenvectors corresponding to the four smallest eigenvalues.
+        void compute_null_space(EPnP &p) {
+            const int dim = 3 * p.m;
+            Matrix MtM(dim, dim, 0.0);
+            double r1[12], r2[12];
+            for (int i = 0; i < p.n; ++i) {
+                const double *a = &p.alphas[4 * i];
+                const double x = p.us[2 * i];
+                const double y = p.us[2 * i + 1];
+                for (int j = 0; j < p.m; ++j) {
+                    r1[3 * j] = a[j];
+                    r1[3 * j + 1] = 0.0;
+                    r1[3 * j + 2] = -a[j] * x;
+                    r2[3 * j] = 0.0;
+                    r2[3 * j + 1] = a[j];
+                    r2[3 * j + 2] = -a[j] * y;
+                }
+                for (int r = 0; r < dim; ++r) {
+                    double *row = MtM[r];
+                    for (int c = r; c < dim; ++c)
+                        row[c] += r1[r] * r1[c] + r2[r] * r2[c];
+                }
+            }
+            for (int r = 0; r < dim; ++r) {
+                for (int c = 0; c < r; ++c)
+                    MtM(r, c) = MtM(c, r);
+            }
+
+            Matrix U(dim, dim), S(dim, dim), V(dim, dim);
+            svd_decompose(MtM, U, S, V);
+            for (int i = 0; i < 4; ++i) {
+                for (int j = 0; j < 12; ++j)
+                    p.v[i][j] = (j < dim) ? V(j, dim - 1 - i) : 0.0;
+            }
+        }
+
+
+        void compute_L_and_rho(EPnP &p) {
+            for (int k = 0; k < p.num_pairs(); ++k) {
+                const int a = kPairs[k][0];
+                const int b = kPairs[k][1];
+
+                double dv[4][3];
+                for (int i = 0; i < 4; ++i) {
+                    for (int j = 0; j < 3; ++j)
+                        dv[i][j] = p.v[i][3 * a + j] - p.v[i][3 * b + j];
+                }
+
+                auto dot = [&dv](int i, int j) {
+                    return dv[i][0] * dv[j][0] + dv[i][1] * dv[j][1] + dv[i][2] * dv[j][2];
+                };
+
+                // the columns correspond to [b00, b01, b11, b02, b12, b22, b03, b13, b23, b33], with bij = bi * bj
+                double *L = p.L[k];
+                L[0] = dot(0, 0);
+                L[1] = 2.0 * dot(0, 1);
+                L[2] = dot(1, 1);
+                L[3] = 2.0 * dot(0, 2);
+                L[4] = 2.0 * dot(1, 2);
+                L[5] = dot(2, 2);
+                L[6] = 2.0 * dot(0, 3);
+                L[7] = 2.0 * dot(1, 3);
+                L[8] = 2.0 * dot(2, 3);
+                L[9] = dot(3, 3);
+
+                double d2 = 0.0;
+                for (int j = 0; j < 3; ++j) {
+                    const double d = p.cws[a][j] - p.cws[b][j];
+                    d2 += d * d;
+                }
+                p.rho[k] = d2;
+            }
+        }
+
+
+        // Solves the linearized system for the given columns of L, i.e., L[:, cols] * x = rho.
+        bool solve_linearized(const EPnP &p, const int *cols, int num_cols, std::vector<double> &x) {
+            const int num_pairs = p.num_pairs();
+            Matrix A(num_pairs, num_cols);
+            std::vector<double> b(p.rho, p.rho + num_pairs);
+            for (int k = 0; k < num_pairs; ++k) {
+                for (int j = 0; j < num_cols; ++j)
+                    A(k, j) = p.L[k][cols[j]];
+            }
+            return solve_least_squares(A, b, x) && static_cast<int>(x.size()) == num_cols;
+        }
+
+
+        // N = 4, using [b00, b01, b02, b03]
+        void find_betas_approx_1(const EPnP &p, double *betas) {
+            const int cols[4] = {0, 1, 3, 6};
+            std::vector<double> B;
+            betas[0] = betas[1] = betas[2] = betas[3] = 0.0;
+            if (!solve_linearized(p, cols, 4, B))
+                return;
+            const double sign = (B[0] < 0) ? -1.0 : 1.0;
+            betas[0] = std::sqrt(sign * B[0]);
+            if (betas[0] > kBetaEpsilon) {
+                betas[1] = sign * B[1] / betas[0];
+                betas[2] = sign * B[2] / betas[0];
+                betas[3] = sign * B[3] / betas[0];
+            }
+        }
+
+
+        // N = 1, using [b00] (for the planar case, which has too few constraints for approximation 1)
+        void find_betas_approx_planar(const EPnP &p, double *betas) {
+            const int cols[1] = {0};
+            std::vector<double> B;
+            betas[0] = betas[1] = betas[2] = betas[3] = 0.0;
+            if (!solve_linearized(p, cols, 1, B))
+                return;
+            betas[0] = std::sqrt(std::abs(B[0]));
+        }
+
+
+        // N = 2, using [b00, b01, b11]
+        void find_betas_approx_2(const EPnP &p, double *betas) {
+            const int cols[3] = {0, 1, 2};
+            std::vector<double> B;
+            betas[0] = betas[1] = betas[2] = betas[3] = 0.0;
+            if (!solve_linearized(p, cols, 3, B))
+                return;
+            if (B[0] < 0) {
+                betas[0] = std::sqrt(-B[0]);
+                betas[1] = (B[2] < 0) ? std::sqrt(-B[2]) : 0.0;
+            } else {
+                betas[0] = std::sqrt(B[0]);
+                betas[1] = (B[2] > 0) ? std::sqrt(B[2]) : 0.0;
+            }
+            if (B[1] < 0)
+                betas[0] = -betas[0];
+            betas[2] = 0.0;
+            betas[3] = 0.0;
+        }
+
+
+        // N = 3, using [b00, b01, b11, b02, b12]
+        void find_betas_approx_3(const EPnP &p, double *betas) {
+            const int cols[5] = {0, 1, 2, 3, 4};
+            std::vector<double> B;
+            betas[0] = betas[1] = betas[2] = betas[3] = 0.0;
+            if (!solve_linearized(p, cols, 5, B))
+                return;
+            if (B[0] < 0) {
+                betas[0] = std::sqrt(-B[0]);
+                betas[1] = (B[2] < 0) ? std::sqrt(-B[2]) : 0.0;
+            } else {
+                betas[0] = std::sqrt(B[0]);
+                betas[1] = (B[2] > 0) ? std::sqrt(B[2]) : 0.0;
+            }
+            if (B[1] < 0)
+                betas[0] = -betas[0];
+            betas[2] = (std::abs(betas[0]) > kBetaEpsilon) ? B[3] / betas[0] : 0.0;
+            betas[3] = 0.0;
+        }
+
+
+        // Refines the betas by Gauss-Newton iterations on the (nonlinear) distance constraints. In the planar case,
+        // there are only 3 constraints, and beta 3 stays zero.
+        void gauss_newton(const EPnP &p, double *betas) {
+            const int num_iterations = 5;
+            const int num_pairs = p.num_pairs();
+            const int num_betas = (p.m == 4) ? 4 : 3;
+            Matrix A(num_pairs, num_betas);
+            std::vector<double> b(num_pairs), x;
+            for (int iter = 0; iter < num_iterations; ++iter) {
+                for (int k = 0; k < num_pairs; ++k) {
+                    const double *L = p.L[k];
+                    A(k, 0) = 2 * L[0] * betas[0] + L[1] * betas[1] + L[3] * betas[2] + L[6] * betas[3];
+                    A(k, 1) = L[1] * betas[0] + 2 * L[2] * betas[1] + L[4] * betas[2] + L[7] * betas[3];
+                    A(k, 2) = L[3] * betas[0] + L[4] * betas[1] + 2 * L[5] * betas[2] + L[8] * betas[3];
+                    if (num_betas == 4)
+                        A(k, 3) = L[6] * betas[0] + L[7] * betas[1] + L[8] * betas[2] + 2 * L[9] * betas[3];
+                    b[k] = p.rho[k] - (
+                            L[0] * betas[0] * betas[0] +
+                            L[1] * betas[0] * betas[1] +
+                            L[2] * betas[1] * betas[1] +
+                            L[3] * betas[0] * betas[2] +
+                            L[4] * betas[1] * betas[2] +
+                            L[5] * betas[2] * betas[2] +
+                            L[6] * betas[0] * betas[3] +
+                            L[7] * betas[1] * betas[3] +
+                            L[8] * betas[2] * betas[3] +
+                            L[9] * betas[3] * betas[3]);
+                }
+                if (!solve_least_squares(A, b, x))
+                    return;
+                for (int i = 0; i < num_betas; ++i)
+                    betas[i] += x[i];
+            }
+        }
+
+
+        // The rigid transformation that best aligns the world points to the camera points.
+        void estimate_R_and_t(const EPnP &p, Matrix33 &R, Vector3D &t) {
+            double pc0[3] = {0, 0, 0}, pw0[3] = {0, 0, 0};
+            for (int i = 0; i < p.n; ++i) {
+                for (int k = 0; k < 3; ++k) {
+                    pc0[k] += p.pcs[3 * i + k];
+                    pw0[k] += p.pws[3 * i + k];
+                }
+            }
+            for (int k = 0; k < 3; ++k) {
+                pc0[k] /= p.n;
+                pw0[k] /= p.n;
+            }
+
+            Matrix33 H;
+            for (int i = 0; i < p.n; ++i) {
+                const double *pc = &p.pcs[3 * i];
+                const double *pw = &p.pws[3 * i];
+                for (int r = 0; r < 3; ++r) {
+                    for (int c = 0; c < 3; ++c)
+                        H(r, c) += (pc[r] - pc0[r]) * (pw[c] - pw0[c]);
+                }
+            }
+
+            Matrix33 U, S, V;
+            svd_decompose(H, U, S, V);
+            R = U * transpose(V);
+            if (determinant(R) < 0) {   // a reflection, flip the direction of the least significant axis
+                for (int r = 0; r < 3; ++r)
+                    U(r, 2) = -U(r, 2);
+                R = U * transpose(V);
+            }
+
+            for (int k = 0; k < 3; ++k)
+                t[k] = pc0[k] - (R(k, 0) * pw0[0] + R(k, 1) * pw0[1] + R(k, 2) * pw0[2]);
+        }
+
+
+        // The mean squared reprojection error in normalized image coordinates.
+        double reprojection_error(const EPnP &p, const Matrix33 &R, const Vector3D &t) {
+            double sum = 0.0;
+            for (int i = 0; i < p.n; ++i) {
+                const double *pw = &p.pws[3 * i];
+                const double X = R(0, 0) * pw[0] + R(0, 1) * pw[1] + R(0, 2) * pw[2] + t[0];
+                const double Y = R(1, 0) * pw[0] + R(1, 1) * pw[1] + R(1, 2) * pw[2] + t[1];
+                const double Z = R(2, 0) * pw[0] + R(2, 1) * pw[1] + R(2, 2) * pw[2] + t[2];
+                const double dx = X / Z - p.us[2 * i];
+                const double dy = Y / Z - p.us[2 * i + 1];
+                sum += dx * dx + dy * dy;
+            }
+            return sum / p.n;
+        }
+
+
+        double compute_R_and_t(EPnP &p, const double *betas, Matrix33 &R, Vector3D &t) {
+            for (int j = 0; j < p.m; ++j) {
+                for (int k = 0; k < 3; ++k) {
+                    p.ccs[j][k] = 0.0;
+                    for (int i = 0; i < 4; ++i)
+                        p.ccs[j][k] += betas[i] * p.v[i][3 * j + k];
+                }
+            }
+
+            p.pcs.resize(3 * p.n);
+            for (int i = 0; i < p.n; ++i) {
+                const double *a = &p.alphas[4 * i];
+                for (int k = 0; k < 3; ++k) {
+                    p.pcs[3 * i + k] = 0.0;
+                    for (int j = 0; j < p.m; ++j)   // in the planar case, the 4th control point is not set
+                        p.pcs[3 * i + k] += a[j] * p.ccs[j][k];
+                }
+            }
+
+            // the points must be in front of the camera
+            if (p.pcs[2] < 0.0) {
+                for (int j = 0; j < p.m; ++j) {
+                    for (int k = 0; k < 3; ++k)
+                        p.ccs[j][k] = -p.ccs[j][k];
+                }
+                for (auto &v : p.pcs)
+                    v = -v;
+            }
+
+            estimate_R_and_t(p, R, t);
+            return reprojection_error(p, R, t);
+        }
+
+
+        // The rotation matrix of the axis-angle vector w (i.e., Rodrigues' formula).
+        Matrix33 rotation_from_axis_angle(const double *w) {
+            const double theta = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+            const Matrix33 W(0, -w[2], w[1],
+                             w[2], 0, -w[0],
+                             -w[1], w[0], 0);
+            Matrix33 R;
+            R.load_identity();
+            if (theta < 1e-12)
+                return R + W;
+            const double a = std::sin(theta) / theta;
+            const double b = (1.0 - std::cos(theta)) / (theta * theta);
+            return R + a * W + b * (W * W);
+        }
+    }
+
+
+    bool solve_pnp(const std::vector<Vector3D> &points_3d,
+                   const std::vector<Vector2D> &points_2d,
+                   const Matrix33 &K,
+                   Matrix33 &R,
+                   Vector3D &t,
+                   bool refine)
+    {
+        if (points_3d.size() != points_2d.size()) {
+            std::cerr << "could not estimate pose: the numbers of 3D and 2D points don't match" << std::endl;
+            return false;
+        }
+        if (points_3d.size() < 4) {
+            std::cerr << "could not estimate pose: at least 4 correspondences are required" << std::endl;
+            return false;
+        }
+        const double fx = K(0, 0), fy = K(1, 1), skew = K(0, 1), cx = K(0, 2), cy = K(1, 2);
+        if (std::abs(fx) < std::numeric_limits<double>::epsilon() || std::abs(fy) < std::numeric_limits<double>::epsilon()) {
+            std::cerr << "could not estimate pose: invalid intrinsic parameters" << std::endl;
+            return false;
+        }
+
+        EPnP p;
+        p.n = static_cast<int>(points_3d.size());
+        p.pws.resize(3 * p.n);
+        p.us.resize(2 * p.n);
+        for (int i = 0; i < p.n; ++i) {
+            const Vector3D &P = points_3d[i];
+            p.pws[3 * i] = P.x();
+            p.pws[3 * i + 1] = P.y();
+            p.pws[3 * i + 2] = P.z();
+            // K^-1 * p, exploiting that K is upper triangular
+            const double y = (points_2d[i].y() - cy) / fy;
+            p.us[2 * i] = (points_2d[i].x() - cx - skew * y) / fx;
+            p.us[2 * i + 1] = y;
+        }
+
+        if (!choose_control_points(p))
+            return false;
+        // With 4 non-coplanar points, the null space of M has 4 dimensions and none of the approximations of the
+        // betas is exact, so Gauss-Newton may converge to a wrong pose (in about a quarter of random scenes). With 5
+        // or more points (or coplanar ones), the null space is at most 2 dimensional and the betas are exact.
+        if (p.m == 4 && p.n < 5) {
+            std::cerr << "could not estimate pose: at least 5 correspondences are required if the 3D points are not "
+                         "coplanar" << std::endl;
+            return false;
+        }
+        compute_barycentric_coordinates(p);
+        compute_null_space(p);
+        compute_L_and_rho(p);
+
+        // try the approximations and keep the one with the smallest reprojection error. The planar case only has 3
+        // constraints, which are too few for approximations 1 and 3.
+        typedef void (*FindBetas)(const EPnP &, double *);
+        const FindBetas approximations[3] = {find_betas_approx_1, find_betas_approx_2, find_betas_approx_3};
+        const FindBetas planar_approximations[2] = {find_betas_approx_planar, find_betas_approx_2};
+        const FindBetas *begin = (p.m == 4) ? approximations : planar_approximations;
+        const FindBetas *end = (p.m == 4) ? approximations + 3 : planar_approximations + 2;
+        double best_error = std::numeric_limits<double>::max();
+        for (const FindBetas *find_betas = begin; find_betas != end; ++find_betas) {
+            double betas[4];
+            (*find_betas)(p, betas);
+            gauss_newton(p, betas);
+
+            Matrix33 R_i;
+            Vector3D t_i;
+            const double error = compute_R_and_t(p, betas, R_i, t_i);
+            if (error < best_error) {
+                best_error = error;
+                R = R_i;
+                t = t_i;
+            }
+        }
+
+        if (best_error == std::numeric_limits<double>::max() || std::isnan(best_error)) {
+            std::cerr << "could not estimate pose: EPnP failed" << std::endl;
+            return false;
+        }
+
+        if (refine)
+            refine_pose(points_3d, points_2d, K, R, t);
+        return true;
+    }
+
+
+    double refine_pose(const std::vector<Vector3D> &points_3d,
+                       const std::vector<Vector2D> &points_2d,
+                       const Matrix33 &K,
+                       Matrix33 &R,
+                       Vector3D &t,
+                       int max_iterations)
+    {
+        const std::size_t n = points_3d.size();
+        if (n == 0 || n != points_2d.size())
+            return 0.0;
+
+        const double fx = K(0, 0), fy = K(1, 1), skew = K(0, 1), cx = K(0, 2), cy = K(1, 2);
+
+        // Evaluates the squared reprojection error and, if required, the normal equations J^T * J * dx = -J^T * r
+        // for the parameters [w, t], where the rotation is perturbed by exp([w]x) * R.
+        auto evaluate = [&](const Matrix33 &rot, const Vector3D &trans, Matrix *JtJ, std::vector<double> *Jtr) {
+            if (JtJ) {
+                JtJ->load_zero();
+                std::fill(Jtr->begin(), Jtr->end(), 0.0);
+            }
+            double cost = 0.0;
+            for (std::size_t i = 0; i < n; ++i) {
+                const Vector3D &P = points_3d[i];
+                // the point rotated only, and the point in the camera frame
+                const double RP[3] = {rot(0, 0) * P.x() + rot(0, 1) * P.y() + rot(0, 2) * P.z(),
+                                      rot(1, 0) * P.x() + rot(1, 1) * P.y() + rot(1, 2) * P.z(),
+                                      rot(2, 0) * P.x() + rot(2, 1) * P.y() + rot(2, 2) * P.z()};
+                const double X = RP[0] + trans[0], Y = RP[1] + trans[1], Z = RP[2] + trans[2];
+                const double iz = 1.0 / Z;
+                const double x = X * iz, y = Y * iz;
+                const double r[2] = {fx * x + skew * y + cx - points_2d[i].x(),
+                                     fy * y + cy - points_2d[i].y()};
+                cost += r[0] * r[0] + r[1] * r[1];
+                if (!JtJ)
+                    continue;
+
+                // d(pixel)/d(camera point) = [fx, skew; 0, fy] * [1/Z, 0, -X/Z^2; 0, 1/Z, -Y/Z^2]
+                const double Jp[2][3] = {{fx * iz, skew * iz, -(fx * x + skew * y) * iz},
+                                         {0.0,     fy * iz,   -fy * y * iz}};
+                // d(camera point)/d[w, t] = [-[RP]x, I]
+                double J[2][6];
+                for (int k = 0; k < 2; ++k) {
+                    J[k][0] = Jp[k][2] * RP[1] - Jp[k][1] * RP[2];
+                    J[k][1] = Jp[k][0] * RP[2] - Jp[k][2] * RP[0];
+                    J[k][2] = Jp[k][1] * RP[0] - Jp[k][0] * RP[1];
+                    J[k][3] = Jp[k][0];
+                    J[k][4] = Jp[k][1];
+                    J[k][5] = Jp[k][2];
+                }
+                for (int a = 0; a < 6; ++a) {
+                    double *row = (*JtJ)[a];
+                    for (int b = a; b < 6; ++b)
+                        row[b] += J[0][a] * J[0][b] + J[1][a] * J[1][b];
+                    (*Jtr)[a] -= J[0][a] * r[0] + J[1][a] * r[1];
+                }
+            }
+            if (JtJ) {
+                for (int a = 0; a < 6; ++a) {
+                    for (int b = 0; b < a; ++b)
+                        (*JtJ)(a, b) = (*JtJ)(b, a);
+                }
+            }
+            return cost;
+        };
+
+        Matrix JtJ(6, 6);
+        std::vector<double> Jtr(6), dx;
+        double cost = evaluate(R, t, &JtJ, &Jtr);
+        for (int iter = 0; iter < max_iterations; ++iter) {
+            if (!solve_least_squares(JtJ, Jtr, dx))
+                break;
+
+            const Matrix33 new_R = rotation_from_axis_angle(&dx[0]) * R;
+            const Vector3D new_t(t[0] + dx[3], t[1] + dx[4], t[2] + dx[5]);
+            const double new_cost = evaluate(new_R, new_t, nullptr, nullptr);
+            if (!(new_cost < cost))     // no improvement (or NaN), keep the current pose
+                break;
+
+            R = new_R;
+            t = new_t;
+            const double step = dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2] +
+                                dx[3] * dx[3] + dx[4] * dx[4] + dx[5] * dx[5];
+            const bool converged = (cost - new_cost < 1e-12 * cost) || (step < 1e-24);
+            if (converged) {
+                cost = new_cost;
+                break;
+            }
+            cost = evaluate(R, t, &JtJ, &Jtr);
+        }
+
+        return std::sqrt(cost / n);
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_POSE_ESTIMATION_H
+#define EASY3D_POSE_ESTIMATION_H
+
+
+#include <vector>
+
+#include "matrix.h"
+#include "vector.h"
+
+
+namespace easy3d {
+
+    /**
+     * Estimate the pose of a calibrated camera from 3D-2D correspondences (i.e., the Perspective-n-Point problem).
+     *
+     * The pose is first computed by EPnP in O(n) time. It expresses the 3D points as a weighted sum of four virtual
+     * control points and solves for the control points in the camera frame, see
+     *      V. Lepetit, F. Moreno-Noguer, and P. Fua. EPnP: An Accurate O(n) Solution to the PnP Problem. IJCV 2009.
+     * Coplanar 3D points (e.g., the corners of a checkerboard) are handled by the planar case of EPnP, i.e., with
+     * three control points in their plane.
+     * Optionally, the pose is then refined by Gauss-Newton iterations that minimize the reprojection error.
+     *
+     * Unlike Calibration::calibration(), the intrinsic parameters are known, so only the 6 DOF of the pose are
+     * estimated. This makes it cheaper and more accurate for tracking a camera that has been calibrated before.
+     *
+     * @param points_3d The 3D points, i.e., at least 5 points that are not coplanar, or at least 4 coplanar points
+     *                  that are not collinear.
+     * @param points_2d The corresponding 2D image points.
+     * @param K The 3 by 3 intrinsic matrix, i.e., [fx, skew, cx; 0, fy, cy; 0, 0, 1].
+     * @param R Returns the 3x3 rotation matrix encoding camera rotation.
+     * @param t Returns the 3D vector encoding camera translation, i.e., p = K * (R * P + t).
+     * @param refine Refine the EPnP result by Gauss-Newton iterations if true.
+     * @return false if failed (e.g., too few or degenerate correspondences). If true, R and t carry the pose.
+     */
+    bool solve_pnp(const std::vector<Vector3D> &points_3d,
+                   const std::vector<Vector2D> &points_2d,
+                   const Matrix33 &K,
+                   Matrix33 &R,
+                   Vector3D &t,
+                   bool refine = true);
+
+
+    /**
+     * Refine the pose of a calibrated camera by Gauss-Newton iterations that minimize the reprojection error (in
+     * pixels) of the 3D-2D correspondences. The rotation is updated by its axis-angle increment, so it stays
+     * orthonormal.
+     *
+     * @param points_3d The 3D points.
+     * @param points_2d The corresponding 2D image points.
+     * @param K The 3 by 3 intrinsic matrix.
+     * @param R The initial rotation, which also returns the refined rotation.
+     * @param t The initial translation, which also returns the refined translation.
+     * @param max_iterations The maximum number of Gauss-Newton iterations.
+     * @return The root mean square reprojection error (in pixels) of the refined pose.
+     */
+    double refine_pose(const std::vector<Vector3D> &points_3d,
+                       const std::vector<Vector2D> &points_2d,
+                       const Matrix33 &K,
+                       Matrix33 &R,
+                       Vector3D &t,
+                       int max_iterations = 10);
+}
+
+#endif // EASY3D_POSE_ESTIMATION_H
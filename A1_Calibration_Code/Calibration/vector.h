@@ -29,11 +29,21 @@
 #include <vector>
 #include <iostream>
 
+#include "./memory_arena.h"
+
 namespace easy3d {
 
-    class Vector2D;
-    class Vector3D;
-    class Vector4D;
+    template <int N>
+    class FixedVector;
+
+    /// A class for 2D vectors and points
+    typedef FixedVector<2> Vector2D;
+
+    /// A class for 3D vectors and points
+    typedef FixedVector<3> Vector3D;
+
+    /// A class for 4D vectors and points
+    typedef FixedVector<4> Vector4D;
 
 
     // -----------------------------------------------------------------------------------------------------------
@@ -51,14 +61,9 @@ namespace easy3d {
         /// Constructs an n-dimensional vector from another vector of the same dimension/size.
         Vector(const Vector &rhs);
 
-        /// Constructs an n-dimensional vector (here n=2) from a 2D vector.
-        Vector(const Vector2D &rhs);
-
-        /// Constructs an n-dimensional vector (here n=3) from a 3D vector.
-        Vector(const Vector3D &rhs);
-
-        /// Constructs an n-dimensional vector (here n=4) from a 4D vector.
-        Vector(const Vector4D &rhs);
+        /// Move constructor. It takes over the storage of rhs (leaving rhs empty) instead of copying it, unless the
+        /// elements of rhs are stored inline (i.e., rhs is a FixedVector), in which case they are copied.
+        Vector(Vector &&rhs);
 
         /// Constructs a vector from an array of values.
         /// \param rhs The array
@@ -70,17 +75,24 @@ namespace easy3d {
         template<typename FT>
         Vector(const std::vector<FT> &rhs);
 
+        ~Vector();
+
         /// Assignment operator. It assigns the value of this vector from another vector.
         Vector &operator=(const Vector &rhs);
 
+        /// Move assignment operator (see the move constructor).
+        Vector &operator=(Vector &&rhs);
+
         /// Returns the dimension/size of this vector.
         size_t dimension() const;
 
         /// Returns the dimension/size of this vector.
         size_t size() const;
 
-        /// Changes the size of the vector
-        /// \attention If the size is made larger, the new values remain uninitialized.
+        /// Changes the size of the vector. The storage is reused (i.e., no reallocation) if it is large enough for
+        /// the new size, so a vector that is repeatedly resized only allocates memory when it grows.
+        /// \attention If the size is made larger, the new values are initialized to zero. Growing a FixedVector beyond
+        ///     N elements moves its elements to the heap.
         void resize(size_t n);
 
         /// Returns the memory address of the vector.
@@ -138,86 +150,51 @@ namespace easy3d {
         Vector operator/(T2 s) const;
 
     protected:
-        std::vector<double> data_;
-    };
+        /// Constructs an n-dimensional vector on an external buffer of at least n elements. The buffer is neither
+        /// initialized nor freed by the vector. This allows FixedVector to store its elements inline.
+        Vector(double *buffer, size_t n);
 
+        /// Allocates (uninitialized) storage for n elements.
+        void allocate(size_t n);
 
-    // -----------------------------------------------------------------------------------------------------------
-
-
-    /// A class for 2D vectors and points
-    class Vector2D : public Vector {
-    public:
-        /// Construct a 2-dimensional vector.
-        Vector2D(double x = 0, double y = 0);
-
-        /// Construct a 2D vector from a general vector.
-        /// \attention the size of v must >= 2
-        Vector2D(const Vector &v);
+        /// Frees the storage if it is owned by this vector.
+        void release();
 
-        /// Get the x coordinate
-        double &x();
-        /// Get the x coordinate
-        const double &x() const;
-
-        /// Get the y coordinate
-        double &y();
-        /// Get the y coordinate
-        const double &y() const;
-
-        /// Get its Homogeneous coordinates
-        Vector3D homogeneous() const;
+    protected:
+        double *data_;
+        size_t size_;
+        size_t capacity_;   // the number of elements the storage can hold, i.e., size_ <= capacity_
+        bool owns_data_;    // false if data_ points to an external buffer
+        bool in_arena_;     // true if the storage comes from a MemoryArena (see ArenaScope)
     };
 
 
     // -----------------------------------------------------------------------------------------------------------
 
 
-    /// A class for 3D vectors and points
-    class Vector3D : public Vector {
+    /// A class for N-dimensional vectors whose dimension is known at compile time, e.g., 2D/3D points and their
+    /// homogeneous coordinates. The elements are stored inline (i.e., constructing, copying, and destroying it never
+    /// allocates memory), and it can be used wherever a general Vector is expected.
+    template <int N>
+    class FixedVector : public Vector {
     public:
-        /// Construct a 3-dimensional vector.
-        Vector3D(double x = 0, double y = 0, double z = 0);
-
-        /// Construct a 3D vector from a general vector.
-        /// \attention the size of v must >= 3
-        Vector3D(const Vector &v);
-
-        /// Get the x coordinate
-        double &x();
-        /// Get the x coordinate
-        const double &x() const;
-
-        /// Get the y coordinate
-        double &y();
-        /// Get the y coordinate
-        const double &y() const;
-
-        /// Get the z coordinate
-        double &z();
-        /// Get the z coordinate
-        const double &z() const;
-
-        /// Get its Homogeneous coordinates
-        Vector4D homogeneous() const;
-
-        /// Get its Cartesian coordinates (treating this vector as Homogeneous coordinates)
-        Vector2D cartesian() const;
-    };
+        /// Construct an N-dimensional vector with all elements initialized to zero.
+        FixedVector();
 
+        /// Construct an N-dimensional vector from its first elements, e.g., Vector3D(x, y, z). The remaining elements
+        /// are initialized to zero.
+        template <typename... FT>
+        FixedVector(double x, FT... others);
 
-    // -----------------------------------------------------------------------------------------------------------
-
+        /// Copy constructor.
+        FixedVector(const FixedVector &rhs);
 
-    /// A class for 4D vectors and points
-    class Vector4D : public Vector {
-    public:
-        /// Construct a 4-dimensional vector.
-        Vector4D(double x = 0, double y = 0, double z = 0, double w = 0);
+        /// Construct an N-dimensional vector from a general vector.
+        /// \attention the size of v must >= N
+        FixedVector(const Vector &v);
 
-        /// Construct a 4D vector from a general vector.
-        /// \attention the size of v must >= 4
-        Vector4D(const Vector &v);
+        /// Assignment operator.
+        FixedVector &operator=(const FixedVector &rhs);
 
         /// Get the x coordinate
         double &x();
@@ -229,18 +206,31 @@ namespace easy3d {
         /// Get the y coordinate
         const double &y() const;
 
-        /// Get the z coordinate
+        /// Get the z coordinate (N >= 3)
         double &z();
-        /// Get the z coordinate
+        /// Get the z coordinate (N >= 3)
         const double &z() const;
 
-        /// Get the w coordinate
+        /// Get the w coordinate (N >= 4)
         double &w();
-        /// Get the w coordinate
+        /// Get the w coordinate (N >= 4)
         const double &w() const;
 
+        /// Get its Homogeneous coordinates
+        FixedVector<N + 1> homogeneous() const;
+
         /// Get its Cartesian coordinates (treating this vector as Homogeneous coordinates)
-        Vector3D cartesian() const;
+        FixedVector<N - 1> cartesian() const;
+
+        /// Vector-scalar multiplication.
+        FixedVector operator*(double s) const;
+
+        /// Vector-scalar division.
+        template<class T2>
+        FixedVector operator/(T2 s) const;
+
+    private:
+        double elements_[N];
     };
 
 
@@ -249,18 +239,51 @@ namespace easy3d {
     /// Computes the dot product of two vectors
     double dot(const Vector &v1, const Vector &v2);
 
+    // The overloads taking an rvalue reference (i.e., a temporary, e.g., the result of another operation) compute the
+    // result in the storage of the temporary.
+
     /// Computes the 'negative' vector
     Vector operator-(const Vector &v1);
 
+    /// Computes the 'negative' vector
+    Vector operator-(Vector &&v1);
+
     /// Computes the scalar-vector product
     Vector operator*(double s, const Vector &v);
 
+    /// Computes the scalar-vector product
+    Vector operator*(double s, Vector &&v);
+
     /// Computes the addition of two vectors
     Vector operator+(const Vector &v1, const Vector &v2);
 
+    /// Computes the addition of two vectors
+    Vector operator+(Vector &&v1, const Vector &v2);
+
+    /// Computes the addition of two vectors
+    Vector operator+(const Vector &v1, Vector &&v2);
+
+    /// Computes the addition of two vectors
+    Vector operator+(Vector &&v1, Vector &&v2);
+
     /// Computes the subtraction of two vectors
     Vector operator-(const Vector &v1, const Vector &v2);
 
+    /// Computes the subtraction of two vectors
+    Vector operator-(Vector &&v1, const Vector &v2);
+
+    // The *_into() functions write the result into an existing vector, which is resized if needed (reusing its
+    // storage). The result can be one of the input vectors.
+
+    /// Computes the addition of two vectors, i.e., result = v1 + v2.
+    void add_into(const Vector &v1, const Vector &v2, Vector &result);
+
+    /// Computes the subtraction of two vectors, i.e., result = v1 - v2.
+    void sub_into(const Vector &v1, const Vector &v2, Vector &result);
+
+    /// Computes the vector-scalar product, i.e., result = v * s.
+    void scale_into(const Vector &v, double s, Vector &result);
+
     /// Computes the length/magnitude of a vector
     double length(const Vector &v);
 
@@ -279,6 +302,32 @@ namespace easy3d {
     /// Computes and returns the normalized vector (Note: the input vector is not modified).
     Vector normalize(const Vector &v);
 
+    // The fixed-size overloads below are preferred over the general ones for vectors of the same fixed dimension, and
+    // they don't allocate any memory.
+
+    /// Computes the 'negative' vector
+    template <int N>
+    FixedVector<N> operator-(const FixedVector<N> &v1);
+
+    /// Computes the scalar-vector product
+    template <int N>
+    FixedVector<N> operator*(double s, const FixedVector<N> &v);
+
+    /// Computes the addition of two vectors
+    template <int N>
+    FixedVector<N> operator+(const FixedVector<N> &v1, const FixedVector<N> &v2);
+
+    /// Computes the subtraction of two vectors
+    template <int N>
+    FixedVector<N> operator-(const FixedVector<N> &v1, const FixedVector<N> &v2);
+
+    /// Computes and returns the normalized vector (Note: the input vector is not modified).
+    template <int N>
+    FixedVector<N> normalize(const FixedVector<N> &v);
+
+    /// Computes the cross product of two 3D vectors
+    Vector3D cross(const Vector3D &v1, const Vector3D &v2);
+
     /// linear interpolation between between two vectors (x and y).
     /// The return value is computed as (1 − w) * v1 + w * v2.
     Vector mix(const Vector &v1, const Vector &v2, double w);
@@ -295,6 +344,7 @@ namespace easy3d {
 #include <cmath>
 #include <cfloat>
 #include <limits>
+#include <utility>   // for std::move
 
 
 namespace easy3d {
@@ -302,59 +352,131 @@ namespace easy3d {
     // ----------------------- Implementation of n-dimensional vectors --------------------
 
     inline Vector::Vector(size_t n) {
-        data_.resize(n, 0);
+        allocate(n);
+        for (size_t i = 0; i < n; ++i)
+            data_[i] = 0;
     }
 
     inline Vector::Vector(size_t n, const double &s) {
-        data_.resize(n, s);
+        allocate(n);
+        for (size_t i = 0; i < n; ++i)
+            data_[i] = s;
     }
 
     inline Vector::Vector(const Vector &rhs) {
-        data_ = rhs.data_;
-    }
-
-    inline Vector::Vector(const Vector2D &rhs) {
-        data_ = rhs.data_;
+        allocate(rhs.size_);
+        for (size_t i = 0; i < size_; ++i)
+            data_[i] = rhs.data_[i];
     }
 
-    inline Vector::Vector(const Vector3D &rhs) {
-        data_ = rhs.data_;
+    inline Vector::Vector(Vector &&rhs) : data_(NULL), size_(0), capacity_(0), owns_data_(false), in_arena_(false) {
+        *this = std::move(rhs);
     }
 
-    inline Vector::Vector(const Vector4D &rhs) {
-        data_ = rhs.data_;
+    inline Vector::Vector(double *buffer, size_t n)
+            : data_(buffer), size_(n), capacity_(n), owns_data_(false), in_arena_(false) {
     }
 
     template<typename FT>
     inline Vector::Vector(size_t n, const FT *rhs) {
-        data_ = std::vector<double>(n);
+        allocate(n);
         for (std::size_t i = 0; i < n; ++i)
             data_[i] = rhs[i];
     }
 
     template<typename FT>
     inline Vector::Vector(const std::vector<FT> &rhs) {
-        data_ = std::vector<double>(rhs.size());
+        allocate(rhs.size());
         for (std::size_t i = 0; i < rhs.size(); ++i)
             data_[i] = rhs[i];
     }
 
+    inline Vector::~Vector() {
+        release();
+    }
+
+    inline void Vector::allocate(size_t n) {
+        data_ = details::allocate_elements(n, in_arena_);
+        size_ = n;
+        capacity_ = n;
+        owns_data_ = true;
+    }
+
+    inline void Vector::release() {
+        if (owns_data_)
+            details::free_elements(data_, capacity_, in_arena_);
+        data_ = NULL;
+        size_ = 0;
+        capacity_ = 0;
+        owns_data_ = false;
+        in_arena_ = false;
+    }
+
     inline Vector &Vector::operator=(const Vector &rhs) {
+        if (data_ == rhs.data_)
+            return *this;
+        if (rhs.size_ > capacity_) {
+            release();
+            allocate(rhs.size_);
+        }
+        size_ = rhs.size_;
+        for (size_t i = 0; i < size_; ++i)
+            data_[i] = rhs.data_[i];
+        return *this;
+    }
+
+    inline Vector &Vector::operator=(Vector &&rhs) {
+        if (this == &rhs)
+            return *this;
+
+        // Only heap (or arena) storage can be taken over, and an external buffer (e.g., the inline storage of a
+        // FixedVector) must stay in use. Storage from the arena is not taken by a vector on the heap (or vice versa),
+        // which would outlive it. All these cases fall back to copying.
+        if (!rhs.owns_data_ || (data_ != NULL && !owns_data_) ||
+            !details::can_take_elements(data_ != NULL, in_arena_, rhs.in_arena_))
+            return *this = static_cast<const Vector &>(rhs);
+
+        release();
         data_ = rhs.data_;
+        size_ = rhs.size_;
+        capacity_ = rhs.capacity_;
+        owns_data_ = true;
+        in_arena_ = rhs.in_arena_;
+
+        rhs.data_ = NULL;
+        rhs.owns_data_ = false;
+        rhs.release();
         return *this;
     }
 
-    inline size_t Vector::dimension() const { return data_.size(); }
+    inline size_t Vector::dimension() const { return size_; }
 
     inline size_t Vector::size() const { return dimension(); }
 
     inline void Vector::resize(size_t n) {
-        data_.resize(n);
+        if (n == size_)
+            return;
+        if (n <= capacity_) {
+            for (size_t i = size_; i < n; ++i)
+                data_[i] = 0;
+            size_ = n;
+            return;
+        }
+        bool in_arena;
+        double *data = details::allocate_elements(n, in_arena);
+        for (size_t i = 0; i < n; ++i)
+            data[i] = (i < size_) ? data_[i] : 0;
+        release();
+        data_ = data;
+        size_ = n;
+        capacity_ = n;
+        owns_data_ = true;
+        in_arena_ = in_arena;
     }
 
-    inline double *Vector::data() { return data_.data(); }
+    inline double *Vector::data() { return data_; }
 
-    inline const double *Vector::data() const { return data_.data(); }
+    inline const double *Vector::data() const { return data_; }
 
     inline double &Vector::operator[](size_t i) { return data_[i]; }
 
@@ -472,6 +594,11 @@ namespace easy3d {
         return result;
     }
 
+    inline Vector operator-(Vector &&v1) {
+        v1 *= -1.0;
+        return std::move(v1);
+    }
+
     inline Vector operator*(double s, const Vector &v) {
         Vector result(v.size());
         for (size_t i = 0; i < v.size(); i++) {
@@ -480,6 +607,11 @@ namespace easy3d {
         return result;
     }
 
+    inline Vector operator*(double s, Vector &&v) {
+        v *= s;
+        return std::move(v);
+    }
+
     inline Vector operator+(const Vector &v1, const Vector &v2) {
         assert(v1.size() == v2.size());
         Vector result(v1.size());
@@ -489,6 +621,24 @@ namespace easy3d {
         return result;
     }
 
+    inline Vector operator+(Vector &&v1, const Vector &v2) {
+        assert(v1.size() == v2.size());
+        v1 += v2;
+        return std::move(v1);
+    }
+
+    inline Vector operator+(const Vector &v1, Vector &&v2) {
+        assert(v1.size() == v2.size());
+        v2 += v1;
+        return std::move(v2);
+    }
+
+    inline Vector operator+(Vector &&v1, Vector &&v2) {
+        assert(v1.size() == v2.size());
+        v1 += v2;
+        return std::move(v1);
+    }
+
     inline Vector operator-(const Vector &v1, const Vector &v2) {
         assert(v1.size() == v2.size());
         Vector result(v1.size());
@@ -498,6 +648,35 @@ namespace easy3d {
         return result;
     }
 
+    inline Vector operator-(Vector &&v1, const Vector &v2) {
+        assert(v1.size() == v2.size());
+        v1 -= v2;
+        return std::move(v1);
+    }
+
+    inline void add_into(const Vector &v1, const Vector &v2, Vector &result) {
+        assert(v1.size() == v2.size());
+        result.resize(v1.size());
+        for (size_t i = 0; i < v1.size(); i++) {
+            result[i] = v1[i] + v2[i];
+        }
+    }
+
+    inline void sub_into(const Vector &v1, const Vector &v2, Vector &result) {
+        assert(v1.size() == v2.size());
+        result.resize(v1.size());
+        for (size_t i = 0; i < v1.size(); i++) {
+            result[i] = v1[i] - v2[i];
+        }
+    }
+
+    inline void scale_into(const Vector &v, double s, Vector &result) {
+        result.resize(v.size());
+        for (size_t i = 0; i < v.size(); i++) {
+            result[i] = v[i] * s;
+        }
+    }
+
     inline double length(const Vector &v) { return v.length(); }
 
     inline double norm(const Vector &v) { return v.length(); }
@@ -534,94 +713,157 @@ namespace easy3d {
     }
 
 
-    // ----------------------- Implementation of 2-dimensional vectors --------------------
+    // ----------------------- Implementation of fixed-size vectors --------------------
 
-    inline Vector2D::Vector2D(double x, double y) : Vector(2) {
-        data_[0] = x;
-        data_[1] = y;
+    template <int N>
+    inline FixedVector<N>::FixedVector() : Vector(elements_, N) {
+        for (int i = 0; i < N; ++i)
+            elements_[i] = 0;
     }
 
-    inline Vector2D::Vector2D(const Vector &v) : Vector(2, v.data()) {}
-
-    inline double &Vector2D::x() { return data_[0]; }
-
-    inline const double &Vector2D::x() const { return data_[0]; }
-
-    inline double &Vector2D::y() { return data_[1]; }
-
-    inline const double &Vector2D::y() const { return data_[1]; }
-
-    inline Vector3D Vector2D::homogeneous() const {
-        return Vector3D(x(), y(), 1.0);
+    template <int N>
+    template <typename... FT>
+    inline FixedVector<N>::FixedVector(double x, FT... others) : Vector(elements_, N) {
+        static_assert(sizeof...(FT) < N, "too many elements for the vector");
+        const double values[] = {x, static_cast<double>(others)...};
+        const int num = static_cast<int>(sizeof(values) / sizeof(double));
+        for (int i = 0; i < num; ++i)
+            elements_[i] = values[i];
+        for (int i = num; i < N; ++i)
+            elements_[i] = 0;
     }
 
-    // ----------------------- Implementation of 3-dimensional vectors --------------------
-
-    inline Vector3D::Vector3D(double x, double y, double z) : Vector(3) {
-        data_[0] = x;
-        data_[1] = y;
-        data_[2] = z;
+    template <int N>
+    inline FixedVector<N>::FixedVector(const FixedVector &rhs) : Vector(elements_, N) {
+        for (int i = 0; i < N; ++i)
+            elements_[i] = rhs[i];
     }
 
-    inline Vector3D::Vector3D(const Vector &v) : Vector(3, v.data()) {}
-
-    inline double &Vector3D::x() { return data_[0]; }
+    template <int N>
+    inline FixedVector<N>::FixedVector(const Vector &v) : Vector(elements_, N) {
+        assert(v.size() >= N);
+        for (int i = 0; i < N; ++i)
+            elements_[i] = v[i];
+    }
 
-    inline const double &Vector3D::x() const { return data_[0]; }
+    template <int N>
+    inline FixedVector<N> &FixedVector<N>::operator=(const FixedVector &rhs) {
+        Vector::operator=(rhs);
+        return *this;
+    }
 
-    inline double &Vector3D::y() { return data_[1]; }
+    template <int N>
+    inline double &FixedVector<N>::x() { return data_[0]; }
 
-    inline const double &Vector3D::y() const { return data_[1]; }
+    template <int N>
+    inline const double &FixedVector<N>::x() const { return data_[0]; }
 
-    inline double &Vector3D::z() { return data_[2]; }
+    template <int N>
+    inline double &FixedVector<N>::y() { return data_[1]; }
 
-    inline const double &Vector3D::z() const { return data_[2]; }
+    template <int N>
+    inline const double &FixedVector<N>::y() const { return data_[1]; }
 
-    inline Vector4D Vector3D::homogeneous() const {
-        return Vector4D(x(), y(), z(), 1.0);
+    template <int N>
+    inline double &FixedVector<N>::z() {
+        static_assert(N >= 3, "a vector with less than 3 elements has no z coordinate");
+        return data_[2];
     }
 
-    inline Vector2D Vector3D::cartesian() const {
-        return Vector2D((*this) / z());
+    template <int N>
+    inline const double &FixedVector<N>::z() const {
+        static_assert(N >= 3, "a vector with less than 3 elements has no z coordinate");
+        return data_[2];
     }
 
-    inline Vector3D cross(const Vector3D &v1, const Vector3D &v2) {
-        return Vector3D(
-                v1.y() * v2.z() - v1.z() * v2.y(),
-                v1.z() * v2.x() - v1.x() * v2.z(),
-                v1.x() * v2.y() - v1.y() * v2.x()
-        );
+    template <int N>
+    inline double &FixedVector<N>::w() {
+        static_assert(N >= 4, "a vector with less than 4 elements has no w coordinate");
+        return data_[3];
     }
 
-    // ----------------------- Implementation of 4-dimensional vectors --------------------
-
-    inline Vector4D::Vector4D(double x, double y, double z, double w) : Vector(4) {
-        data_[0] = x;
-        data_[1] = y;
-        data_[2] = z;
-        data_[3] = w;
+    template <int N>
+    inline const double &FixedVector<N>::w() const {
+        static_assert(N >= 4, "a vector with less than 4 elements has no w coordinate");
+        return data_[3];
     }
 
-    inline Vector4D::Vector4D(const Vector &v) : Vector(4, v.data()) {}
+    template <int N>
+    inline FixedVector<N + 1> FixedVector<N>::homogeneous() const {
+        FixedVector<N + 1> result;
+        for (int i = 0; i < N; ++i)
+            result[i] = data_[i];
+        result[N] = 1.0;
+        return result;
+    }
 
-    inline double &Vector4D::x() { return data_[0]; }
+    template <int N>
+    inline FixedVector<N - 1> FixedVector<N>::cartesian() const {
+        FixedVector<N - 1> result;
+        for (int i = 0; i < N - 1; ++i)
+            result[i] = data_[i] / data_[N - 1];
+        return result;
+    }
 
-    inline const double &Vector4D::x() const { return data_[0]; }
+    template <int N>
+    inline FixedVector<N> FixedVector<N>::operator*(double s) const {
+        FixedVector<N> result;
+        for (int i = 0; i < N; ++i)
+            result[i] = data_[i] * s;
+        return result;
+    }
 
-    inline double &Vector4D::y() { return data_[1]; }
+    template <int N>
+    template <class T2>
+    inline FixedVector<N> FixedVector<N>::operator/(T2 s) const {
+        FixedVector<N> result;
+        for (int i = 0; i < N; ++i)
+            result[i] = data_[i] / double(s);
+        return result;
+    }
 
-    inline const double &Vector4D::y() const { return data_[1]; }
+    template <int N>
+    inline FixedVector<N> operator-(const FixedVector<N> &v1) {
+        FixedVector<N> result;
+        for (int i = 0; i < N; ++i)
+            result[i] = -v1[i];
+        return result;
+    }
 
-    inline double &Vector4D::z() { return data_[2]; }
+    template <int N>
+    inline FixedVector<N> operator*(double s, const FixedVector<N> &v) {
+        return v * s;
+    }
 
-    inline const double &Vector4D::z() const { return data_[2]; }
+    template <int N>
+    inline FixedVector<N> operator+(const FixedVector<N> &v1, const FixedVector<N> &v2) {
+        FixedVector<N> result;
+        for (int i = 0; i < N; ++i)
+            result[i] = v1[i] + v2[i];
+        return result;
+    }
 
-    inline double &Vector4D::w() { return data_[3]; }
+    template <int N>
+    inline FixedVector<N> operator-(const FixedVector<N> &v1, const FixedVector<N> &v2) {
+        FixedVector<N> result;
+        for (int i = 0; i < N; ++i)
+            result[i] = v1[i] - v2[i];
+        return result;
+    }
 
-    inline const double &Vector4D::w() const { return data_[3]; }
+    template <int N>
+    inline FixedVector<N> normalize(const FixedVector<N> &v) {
+        double s = v.length();
+        s = (s > std::numeric_limits<double>::min()) ? double(1.0) / s : double(0.0);
+        return v * s;
+    }
 
-    inline Vector3D Vector4D::cartesian() const {
-        return Vector3D((*this) / w());
+    inline Vector3D cross(const Vector3D &v1, const Vector3D &v2) {
+        return Vector3D(
+                v1.y() * v2.z() - v1.z() * v2.y(),
+                v1.z() * v2.x() - v1.x() * v2.z(),
+                v1.x() * v2.y() - v1.y() * v2.x()
+        );
     }
 }
 
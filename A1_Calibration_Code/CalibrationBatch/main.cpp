@@ -0,0 +1,189 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "calibration.h"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <easy3d/util/threading.h>
+#include <easy3d/util/file_system.h>
+#include <easy3d/util/stop_watch.h>
+#include <easy3d/util/logging.h>
+
+
+using namespace easy3d;
+
+
+/// The calibration result of a single camera of the rig.
+struct CameraResult {
+    std::string name;
+    bool success;
+    int num_points;
+    double fx, fy, cx, cy, skew;
+    Matrix33 R;
+    Vector3D t;
+    double rms;     // reprojection error in pixels
+    double time;    // in seconds
+};
+
+
+/// Loads the 3D-2D correspondences from a file. Each line has the format "X Y Z u v".
+/// The parsing is the same as Calibration::open().
+bool load_correspondences(const std::string &file_name,
+                          std::vector<Vector3D> &points_3d,
+                          std::vector<Vector2D> &points_2d) {
+    FILE *correspondence_file = fopen(file_name.c_str(), "r");
+    if (!correspondence_file) {
+        LOG(ERROR) << "could not open file: " << file_name;
+        return false;
+    }
+
+    char line[256];
+    double x, y, z, xx, yy;
+    while (fgets(line, 256, correspondence_file) != nullptr) {
+        if (5 == sscanf(line, "%lf %lf %lf %lf %lf", &x, &y, &z, &xx, &yy)) {
+            points_3d.emplace_back(Vector3D(x, y, z));
+            points_2d.emplace_back(Vector2D(xx, yy));
+        }
+    }
+    fclose(correspondence_file);
+    return true;
+}
+
+
+/// Calibrates a single camera. This runs in a worker thread of the pool.
+CameraResult calibrate_camera(const std::string &file_name) {
+    StopWatch w;
+
+    CameraResult result;
+    result.name = file_system::simple_name(file_name);
+    result.success = false;
+    result.num_points = 0;
+    result.fx = result.fy = result.cx = result.cy = result.skew = 0.0;
+    result.rms = 0.0;
+
+    std::vector<Vector3D> points_3d;
+    std::vector<Vector2D> points_2d;
+    if (load_correspondences(file_name, points_3d, points_2d)) {
+        result.num_points = static_cast<int>(points_3d.size());
+        // quiet, i.e., the workers don't write to std::cout concurrently, and validated to report the RMS
+        result.success = Calibration::calibration(points_3d, points_2d,
+                                                  result.fx, result.fy, result.cx, result.cy, result.skew,
+                                                  result.R, result.t, false, &result.rms);
+    }
+
+    result.time = w.elapsed_seconds(6);
+    return result;
+}
+
+
+/// Writes the intrinsic and extrinsic parameters of all cameras into a single file (one camera per line).
+bool save_results(const std::string &file_name, const std::vector<CameraResult> &results) {
+    std::ofstream output(file_name.c_str());
+    if (output.fail()) {
+        LOG(ERROR) << "could not open file: " << file_name;
+        return false;
+    }
+
+    output << "# camera success num_points fx fy cx cy skew r00 r01 r02 r10 r11 r12 r20 r21 r22 tx ty tz rms time(s)\n";
+    output << std::setprecision(10);
+    for (const auto &res : results) {
+        output << res.name << " " << res.success << " " << res.num_points << " "
+               << res.fx << " " << res.fy << " " << res.cx << " " << res.cy << " " << res.skew;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j)
+                output << " " << res.R(i, j);
+        }
+        output << " " << res.t[0] << " " << res.t[1] << " " << res.t[2]
+               << " " << res.rms << " " << res.time << "\n";
+    }
+    return true;
+}
+
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << file_system::simple_name(argv[0])
+                  << " <correspondence_dir> <output_file> [num_threads]\n"
+                  << "\t- correspondence_dir: a directory containing one correspondence file (*.txt) per camera\n"
+                  << "\t- output_file: the file to write the intrinsic/extrinsic parameters of all cameras\n"
+                  << "\t- num_threads: the number of worker threads (default: the number of logical cores)"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string input_dir = argv[1];
+    const std::string output_file = argv[2];
+    const int num_threads = (argc > 3) ? std::atoi(argv[3]) : ThreadPool::kMaxNumThreads;
+
+    if (!file_system::is_directory(input_dir)) {
+        LOG(ERROR) << "not a directory: " << input_dir;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> files, all_files;
+    file_system::get_files(input_dir, all_files, false);
+    for (const auto &f : all_files) {
+        if (file_system::extension(f) == "txt")
+            files.push_back(f);
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty()) {
+        LOG(ERROR) << "no correspondence files (*.txt) found in directory: " << input_dir;
+        return EXIT_FAILURE;
+    }
+
+    StopWatch w;
+
+    std::vector<CameraResult> results(files.size());
+    {
+        ThreadPool pool(std::min(GetEffectiveNumThreads(num_threads), static_cast<int>(files.size())));
+        std::vector<std::future<CameraResult> > futures;
+        futures.reserve(files.size());
+        for (const auto &f : files)
+            futures.push_back(pool.AddTask(calibrate_camera, f));
+        for (std::size_t i = 0; i < futures.size(); ++i)
+            results[i] = futures[i].get();
+    }
+
+    int num_success = 0;
+    for (const auto &res : results) {
+        if (res.success) {
+            ++num_success;
+            std::cout << res.name << ": RMS = " << res.rms << " pixels, time = " << res.time << " seconds" << std::endl;
+        }
+        else
+            LOG(WARNING) << res.name << ": calibration failed";
+    }
+    std::cout << num_success << " out of " << results.size() << " cameras calibrated. Total time: "
+              << w.time_string() << std::endl;
+
+    if (!save_results(output_file, results))
+        return EXIT_FAILURE;
+    std::cout << "results saved to " << output_file << std::endl;
+
+    return (num_success == static_cast<int>(results.size())) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Regression tests of the pose estimation: on synthetic views of planar and non-planar scenes, solve_pnp() must recover
+// the pose exactly (up to rounding) from noise-free correspondences and closely from noisy ones, and it must reject the
+// configurations it can't solve.
+
+#include "test_utils.h"
+
+#include "pose_estimation.h"
+#include "matrix_algo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    // the rotation matrix of the axis-angle vector w (i.e., Rodrigues' formula)
+    Matrix33 rotation(const Vector3D &w) {
+        const double theta = norm(w);
+        const Matrix33 W(0, -w[2], w[1],
+                         w[2], 0, -w[0],
+                         -w[1], w[0], 0);
+        Matrix33 R;
+        R.load_identity();
+        return R + std::sin(theta) / theta * W + (1.0 - std::cos(theta)) / (theta * theta) * (W * W);
+    }
+
+
+    // A random camera looking at 'num' points in [-1, 1]^3 (or in the plane z = 0) from a distance of about 5.
+    struct Scene {
+        Scene(int num, bool planar, double noise, std::mt19937 &rng) : K(1000, 0.5, 320, 0, 980, 240, 0, 0, 1) {
+            std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+            std::normal_distribution<double> gaussian(0.0, noise > 0.0 ? noise : 1.0);
+            R = rotation(Vector3D(1.5 * uniform(rng), 1.5 * uniform(rng), 1.5 * uniform(rng)));
+            t = Vector3D(uniform(rng), uniform(rng), 5.0 + 2.0 * uniform(rng));
+            for (int i = 0; i < num; ++i) {
+                const Vector3D P(uniform(rng), uniform(rng), planar ? 0.0 : uniform(rng));
+                Vector2D p = Vector3D(K * (R * P + t)).cartesian();
+                if (noise > 0.0)
+                    p += Vector2D(gaussian(rng), gaussian(rng));
+                points_3d.push_back(P);
+                points_2d.push_back(p);
+            }
+        }
+
+        Matrix33 K;
+        Matrix33 R;
+        Vector3D t;
+        std::vector<Vector3D> points_3d;
+        std::vector<Vector2D> points_2d;
+    };
+
+
+    // the largest deviation of an entry of R, and of t relative to its length
+    bool close_to(const Scene &scene, const Matrix33 &R, const Vector3D &t, double tolerance) {
+        double max_diff = 0.0;
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c)
+                max_diff = std::max(max_diff, std::abs(R(r, c) - scene.R(r, c)));
+        }
+        return max_diff < tolerance && norm(t - scene.t) < tolerance * norm(scene.t);
+    }
+
+
+    void test_noise_free() {
+        std::mt19937 rng(1);
+        const int sizes[] = {4, 5, 6, 10, 100, 1000};
+        for (int planar = 0; planar < 2; ++planar) {
+            for (int num : sizes) {
+                if (num == 4 && !planar)     // 4 non-coplanar points are rejected, see test_rejected()
+                    continue;
+                for (int trial = 0; trial < 100; ++trial) {
+                    const Scene scene(num, planar != 0, 0.0, rng);
+                    for (int refine = 0; refine < 2; ++refine) {
+                        Matrix33 R;
+                        Vector3D t;
+                        EXPECT(solve_pnp(scene.points_3d, scene.points_2d, scene.K, R, t, refine != 0));
+                        EXPECT(close_to(scene, R, t, 1e-6));
+                    }
+                }
+            }
+        }
+    }
+
+
+    void test_noisy() {
+        std::mt19937 rng(2);
+        const double noise = 0.5;   // in pixels
+        const int sizes[] = {10, 100, 1000};
+        for (int planar = 0; planar < 2; ++planar) {
+            for (int num : sizes) {
+                for (int trial = 0; trial < 20; ++trial) {
+                    const Scene scene(num, planar != 0, noise, rng);
+                    Matrix33 R;
+                    Vector3D t;
+                    EXPECT(solve_pnp(scene.points_3d, scene.points_2d, scene.K, R, t));
+                    EXPECT(close_to(scene, R, t, num >= 100 ? 5e-3 : 5e-2));
+                    // the refined pose fits the points at least as well as the true one
+                    Matrix33 R_true = scene.R;
+                    Vector3D t_true = scene.t;
+                    const double rms_true = refine_pose(scene.points_3d, scene.points_2d, scene.K, R_true, t_true, 0);
+                    const double rms = refine_pose(scene.points_3d, scene.points_2d, scene.K, R, t, 0);
+                    EXPECT(rms <= rms_true * (1.0 + 1e-9));
+                }
+            }
+        }
+    }
+
+
+    void test_refine_pose() {
+        std::mt19937 rng(3);
+        for (int trial = 0; trial < 100; ++trial) {
+            const Scene scene(50, trial % 2 == 0, 0.0, rng);
+            Matrix33 R = rotation(Vector3D(0.02, -0.03, 0.01)) * scene.R;
+            Vector3D t = scene.t + Vector3D(0.05, -0.05, 0.1);
+            EXPECT(refine_pose(scene.points_3d, scene.points_2d, scene.K, R, t) < 1e-6);
+            EXPECT(close_to(scene, R, t, 1e-6));
+            EXPECT(std::abs(determinant(R) - 1.0) < 1e-9);
+        }
+    }
+
+
+    void test_rejected() {
+        std::mt19937 rng(4);
+        Matrix33 R;
+        Vector3D t;
+
+        const Scene four(4, false, 0.0, rng);      // 4 non-coplanar points
+        EXPECT(!solve_pnp(four.points_3d, four.points_2d, four.K, R, t));
+
+        Scene three(3, true, 0.0, rng);
+        EXPECT(!solve_pnp(three.points_3d, three.points_2d, three.K, R, t));
+
+        Scene mismatched(10, false, 0.0, rng);
+        mismatched.points_2d.pop_back();
+        EXPECT(!solve_pnp(mismatched.points_3d, mismatched.points_2d, mismatched.K, R, t));
+
+        Scene collinear(10, false, 0.0, rng);
+        for (std::size_t i = 0; i < collinear.points_3d.size(); ++i) {
+            const double s = 0.2 * i - 1.0;
+            collinear.points_3d[i] = Vector3D(s, 0.5 * s, -s);
+            collinear.points_2d[i] = Vector3D(collinear.K * (collinear.R * collinear.points_3d[i] + collinear.t)).cartesian();
+        }
+        EXPECT(!solve_pnp(collinear.points_3d, collinear.points_2d, collinear.K, R, t));
+    }
+
+}
+
+
+int main() {
+    test_noise_free();
+    test_noisy();
+    test_refine_pose();
+    test_rejected();
+    return easy3d::test::failures();
+}
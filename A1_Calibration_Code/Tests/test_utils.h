@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_TESTS_TEST_UTILS_H
+#define EASY3D_TESTS_TEST_UTILS_H
+
+#include <iostream>
+
+// The regression tests are plain executables (run by ctest) that return the number of failed checks.
+
+namespace easy3d {
+    namespace test {
+        inline int &failures() {
+            static int num = 0;
+            return num;
+        }
+    }
+}
+
+// reports (but doesn't stop at) a failed check (it isn't called CHECK, which glog defines as a fatal check)
+#define EXPECT(condition)                                                                              \
+    do {                                                                                               \
+        if (!(condition)) {                                                                            \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl;    \
+            ++easy3d::test::failures();                                                                \
+        }                                                                                              \
+    } while (false)
+
+#endif  // EASY3D_TESTS_TEST_UTILS_H
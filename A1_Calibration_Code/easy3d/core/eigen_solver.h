@@ -60,7 +60,16 @@ namespace easy3d {
 
         /// solve
         /// @param mat: the input matrix (row major 2D array)
-        void solve(FT** mat, SortingMethod sm = NO_SORTING);
+        /// @return false if the QL iterations didn't converge
+        bool solve(FT** mat, SortingMethod sm = NO_SORTING);
+
+        /// solve without allocating memory (e.g., for the covariance matrices of many small sets of points)
+        /// @param n: the size of the input matrix
+        /// @param mat: the input matrix (row major 2D array), which returns the eigenvectors (stored as the columns)
+        /// @param eigval: returns the eigenvalues (n entries)
+        /// @param subd: workspace of n entries
+        /// @return false if the QL iterations didn't converge
+        static bool solve(int n, FT** mat, FT* eigval, FT* subd, SortingMethod sm = NO_SORTING);
 
         /// the i_th eigenvalue
         FT eigen_value(int i) const { return diag_[i]; }
@@ -588,39 +597,46 @@ namespace easy3d {
 
 
     template <typename FT>
-    inline void EigenSolver<FT>::solve(FT** mat, SortingMethod sm /* = NO_SORTING*/)
+    inline bool EigenSolver<FT>::solve(FT** mat, SortingMethod sm /* = NO_SORTING*/)
     {
         matrix_ = mat;
+        return solve(size_, matrix_, diag_, subd_, sm);
+    }
 
-        switch( size_ )
+
+    template <typename FT>
+    inline bool EigenSolver<FT>::solve(int n, FT** mat, FT* eigval, FT* subd, SortingMethod sm /* = NO_SORTING*/)
+    {
+        switch( n )
         {
             case 2:
-                tridiagonal_2(matrix_,diag_,subd_);
+                tridiagonal_2(mat,eigval,subd);
                 break;
             case 3:
-                tridiagonal_3(matrix_,diag_,subd_);
+                tridiagonal_3(mat,eigval,subd);
                 break;
             case 4:
-                tridiagonal_4(matrix_,diag_,subd_);
+                tridiagonal_4(mat,eigval,subd);
                 break;
             default:
-                tridiagonal_n(size_,matrix_,diag_,subd_);
+                tridiagonal_n(n,mat,eigval,subd);
                 break;
         }
 
-        ql_algorithm(size_,diag_,subd_,matrix_);
+        const bool converged = ql_algorithm(n,eigval,subd,mat);
 
         switch( sm )
         {
             case INCREASING:
-                increasing_sort(size_,diag_,matrix_);
+                increasing_sort(n,eigval,mat);
                 break;
             case DECREASING:
-                decreasing_sort(size_,diag_,matrix_);
+                decreasing_sort(n,eigval,mat);
                 break;
             default:
                 break;
         }
+        return converged;
     }
 
 }
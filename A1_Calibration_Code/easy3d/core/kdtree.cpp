@@ -21,148 +21,1226 @@
 
 #include <easy3d/core/kdtree.h>
 #include <easy3d/core/point_cloud.h>
+#include <easy3d/util/threading.h>
+#include <easy3d/util/logging.h>
 
 #include <nanoflann/nanoflann.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 
 using namespace nanoflann;
 
 namespace easy3d {
 
-    struct PointSet {
-        PointSet(const std::vector<vec3>* points) : pts(points) {}
-        const std::vector<vec3>*  pts;
+    // The points stored as three separate arrays of x, y, and z coordinates, which is the order the tree accesses them
+    // (i.e., one coordinate of many points when splitting a node). The indices are not checked.
+    template <typename FT>
+    struct PointSetSoA {
+        std::vector<FT> coords[3];
+        FT bbox_min[3];
+        FT bbox_max[3];
+
+        // copies the points and computes their bounding box
+        void assign(const Vec<3, FT>* points, std::size_t num) {
+            for (int d = 0; d < 3; ++d) {
+                coords[d].resize(num);
+                bbox_min[d] = num > 0 ? points[0][d] : FT(0);
+                bbox_max[d] = bbox_min[d];
+            }
+            for (std::size_t i = 0; i < num; ++i) {
+                for (int d = 0; d < 3; ++d) {
+                    const FT v = points[i][d];
+                    coords[d][i] = v;
+                    if (v < bbox_min[d]) bbox_min[d] = v;
+                    if (v > bbox_max[d]) bbox_max[d] = v;
+                }
+            }
+        }
 
         // Must return the number of data points
-        inline size_t kdtree_get_point_count() const { return pts->size(); }
+        inline size_t kdtree_get_point_count() const { return coords[0].size(); }
 
-        // Returns the dim'th component of the idx'th point in the class:
-        // Since this is inlined and the "dim" argument is typically an immediate value, the
-        //  "if/else's" are actually solved at compile time.
-        inline float kdtree_get_pt(const size_t idx, const size_t dim) const {
-            if (dim == 0) return pts->at(idx).x;
-            else if (dim == 1) return pts->at(idx).y;
-            else return pts->at(idx).z;
-        }
+        // Returns the dim'th component of the idx'th point in the class
+        inline FT kdtree_get_pt(const size_t idx, const size_t dim) const { return coords[dim][idx]; }
 
-        // Optional bounding-box computation: return false to default to a standard bbox computation loop.
-        // Return true if the BBOX was already computed by the class and returned in "bb" so it can be avoided to redo it again.
-        // Look at bb.size() to find out the expected dimensionality (e.g. 2 or 3 for point clouds)
+        // The bounding box was computed when the points were copied, so the tree doesn't have to do it again.
         template <class BBOX>
-        bool kdtree_get_bbox(BBOX& /* bb */) const { return false; }
+        bool kdtree_get_bbox(BBOX& bb) const {
+            for (int d = 0; d < 3; ++d) {
+                bb[d].low = bbox_min[d];
+                bb[d].high = bbox_max[d];
+            }
+            return true;
+        }
+    };
+
+
+    // Holds the points, so they are constructed before (and destroyed after) the index that refers to them.
+    template <typename FT>
+    struct PointStorage {
+        PointSetSoA<FT> pset_;
     };
 
 
-    struct KD_Tree : public KDTreeSingleIndexAdaptor< L2_Simple_Adaptor<float, PointSet>, PointSet, 3 > {
-        KD_Tree(PointSet* pset) : KDTreeSingleIndexAdaptor< L2_Simple_Adaptor<float, PointSet>, PointSet, 3 >(3, *pset, KDTreeSingleIndexAdaptorParams(10)){
-            pset_ = pset;
+    // The layout of an index file (each array is padded to a multiple of 8 bytes, so the next one is aligned):
+    //      - IndexFileHeader
+    //      - the permutation of the points (uint32_t), i.e., the index of the point at each position of the leaves
+    //      - the nodes (IndexFileNode) in pre-order, i.e., the first child of a node is the next one
+    //      - the x, y, and z coordinates (FT) of the points in the order of the permutation, so the points of a leaf
+    //        are next to each other
+    struct IndexFileHeader {
+        char     magic[8];
+        uint32_t version;
+        uint32_t scalar_size;   // sizeof(FT), i.e., 4 for float and 8 for double
+        uint64_t num_points;
+        uint64_t num_nodes;
+        uint64_t checksum;      // of the points the index was built from
+        uint32_t leaf_size;
+        uint32_t reserved;
+        double   bbox[6];       // the bounding box of the points (min_x, max_x, min_y, max_y, min_z, max_z)
+    };
+
+    const char kIndexFileMagic[8] = {'E', 'A', 'S', 'Y', '3', 'D', 'K', 'D'};
+    const uint32_t kIndexFileVersion = 2;
+
+    template <typename FT>
+    struct IndexFileNode {
+        int32_t  divfeat;   // the dimension of the split, or -1 for a leaf
+        uint32_t first;     // a leaf: the first point; a node: the index of its second child
+        uint32_t last;      // a leaf: one past the last point
+        FT       divlow, divhigh;
+    };
+
+
+    namespace {
+
+        // A read-only file mapped into memory, so only the pages that are used are read from the disk.
+        class MappedFile {
+        public:
+            explicit MappedFile(const std::string& file_name) : data_(nullptr), size_(0) {
+        #ifdef _WIN32
+                file_ = ::CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL, nullptr);
+                mapping_ = nullptr;
+                if (file_ == INVALID_HANDLE_VALUE)
+                    return;
+                LARGE_INTEGER size;
+                if (!::GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+                    return;
+                mapping_ = ::CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (!mapping_)
+                    return;
+                data_ = static_cast<const char*>(::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+                if (data_)
+                    size_ = static_cast<std::size_t>(size.QuadPart);
+        #else
+                const int fd = ::open(file_name.c_str(), O_RDONLY);
+                if (fd < 0)
+                    return;
+                struct stat statbuf;
+                if (::fstat(fd, &statbuf) == 0 && statbuf.st_size > 0) {
+                    void* data = ::mmap(nullptr, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (data != MAP_FAILED) {
+                        data_ = static_cast<const char*>(data);
+                        size_ = static_cast<std::size_t>(statbuf.st_size);
+                    }
+                }
+                ::close(fd);    // the mapping stays valid
+        #endif
+            }
+
+            ~MappedFile() {
+        #ifdef _WIN32
+                if (data_)
+                    ::UnmapViewOfFile(data_);
+                if (mapping_)
+                    ::CloseHandle(mapping_);
+                if (file_ != INVALID_HANDLE_VALUE)
+                    ::CloseHandle(file_);
+        #else
+                if (data_)
+                    ::munmap(const_cast<char*>(data_), size_);
+        #endif
+            }
+
+            const char* data() const { return data_; }
+            std::size_t size() const { return size_; }
+
+        private:
+            const char* data_;
+            std::size_t size_;
+        #ifdef _WIN32
+            HANDLE file_;
+            HANDLE mapping_;
+        #endif
+        };
+
+
+        // the size of an array of 'num' elements of type T in an index file
+        template <typename T>
+        inline std::size_t array_bytes(std::size_t num) {
+            return (num * sizeof(T) + 7) / 8 * 8;
         }
-        ~KD_Tree() { delete pset_; }
 
-        PointSet* pset_;
+    }
+
+
+    template <typename FT>
+    struct KD_Tree : public PointStorage<FT>,
+                     public KDTreeSingleIndexAdaptor< L2_Simple_Adaptor<FT, PointSetSoA<FT> >, PointSetSoA<FT>, 3 >
+    {
+        typedef KDTreeSingleIndexAdaptor< L2_Simple_Adaptor<FT, PointSetSoA<FT> >, PointSetSoA<FT>, 3 > Index;
+        typedef typename Index::NodePtr NodePtr;
+        typedef typename Index::BoundingBox BoundingBox;
+
+        KD_Tree(const Vec<3, FT>* points, std::size_t num, int leaf_size)
+            : Index(3, PointStorage<FT>::pset_, KDTreeSingleIndexAdaptorParams(leaf_size))
+        {
+            this->pset_.assign(points, num);
+        }
+
+        ~KD_Tree() {
+            for (auto pool : pools_)
+                delete pool;
+        }
+
+        // The same as buildIndex(), but the subtrees are built concurrently by up to 'num_threads' threads.
+        void build(int num_threads) {
+            this->m_size = this->pset_.kdtree_get_point_count();
+            this->m_size_at_index_build = this->m_size;
+            this->init_vind();
+            this->freeIndex(*this);
+            this->m_size_at_index_build = this->m_size;
+            if (this->m_size == 0)
+                return;
+            this->computeBoundingBox(this->root_bbox);
+            this->root_node = divide(this->pool, 0, this->m_size, this->root_bbox, num_threads);
+        }
+
+        // appends the subtree of 'node' to 'nodes' in pre-order
+        void flatten(const typename Index::Node* node, std::vector< IndexFileNode<FT> >& nodes) const {
+            const std::size_t i = nodes.size();
+            nodes.push_back(IndexFileNode<FT>());
+            if (!node->child1) {
+                nodes[i].divfeat = -1;
+                nodes[i].first = static_cast<uint32_t>(node->node_type.lr.left);
+                nodes[i].last = static_cast<uint32_t>(node->node_type.lr.right);
+                nodes[i].divlow = nodes[i].divhigh = FT(0);
+            }
+            else {
+                nodes[i].divfeat = node->node_type.sub.divfeat;
+                nodes[i].last = 0;
+                nodes[i].divlow = node->node_type.sub.divlow;
+                nodes[i].divhigh = node->node_type.sub.divhigh;
+                flatten(node->child1, nodes);
+                nodes[i].first = static_cast<uint32_t>(nodes.size());
+                flatten(node->child2, nodes);
+            }
+        }
+
+        // a subtree is built on another thread only if it has at least this number of points
+        static const std::size_t kParallelBuild = 50000;
+
+        // A copy of divideTree() that allocates the nodes from 'pool'. While there are threads left, the left subtree
+        // is built on a new thread, with its own pool (the pools are not thread safe). The splits only depend on the
+        // points, so the tree is the same for any number of threads.
+        NodePtr divide(PooledAllocator& pool, std::size_t left, std::size_t right, BoundingBox& bbox, int num_threads) {
+            NodePtr node = pool.template allocate<typename Index::Node>();
+
+            if ((right - left) <= this->m_leaf_max_size) {
+                node->child1 = node->child2 = NULL; /* Mark as leaf node. */
+                node->node_type.lr.left = left;
+                node->node_type.lr.right = right;
+
+                // compute bounding-box of leaf points
+                for (int i = 0; i < 3; ++i) {
+                    bbox[i].low = this->pset_.kdtree_get_pt(this->vind[left], i);
+                    bbox[i].high = bbox[i].low;
+                }
+                for (std::size_t k = left + 1; k < right; ++k) {
+                    for (int i = 0; i < 3; ++i) {
+                        const FT v = this->pset_.kdtree_get_pt(this->vind[k], i);
+                        if (bbox[i].low > v) bbox[i].low = v;
+                        if (bbox[i].high < v) bbox[i].high = v;
+                    }
+                }
+            }
+            else {
+                std::size_t idx;
+                int cutfeat;
+                FT cutval;
+                this->middleSplit_(*this, &this->vind[0] + left, right - left, idx, cutfeat, cutval, bbox);
+
+                node->node_type.sub.divfeat = cutfeat;
+
+                BoundingBox left_bbox(bbox);
+                left_bbox[cutfeat].high = cutval;
+                BoundingBox right_bbox(bbox);
+                right_bbox[cutfeat].low = cutval;
+
+                if (num_threads > 1 && right - left >= kParallelBuild) {
+                    PooledAllocator* left_pool = new_pool();
+                    const int left_threads = num_threads / 2;
+                    std::thread worker([&]() {
+                        node->child1 = divide(*left_pool, left, left + idx, left_bbox, left_threads);
+                    });
+                    node->child2 = divide(pool, left + idx, right, right_bbox, num_threads - left_threads);
+                    worker.join();
+                }
+                else {
+                    node->child1 = divide(pool, left, left + idx, left_bbox, 1);
+                    node->child2 = divide(pool, left + idx, right, right_bbox, 1);
+                }
+
+                node->node_type.sub.divlow = left_bbox[cutfeat].high;
+                node->node_type.sub.divhigh = right_bbox[cutfeat].low;
+
+                for (int i = 0; i < 3; ++i) {
+                    bbox[i].low = std::min(left_bbox[i].low, right_bbox[i].low);
+                    bbox[i].high = std::max(left_bbox[i].high, right_bbox[i].high);
+                }
+            }
+
+            return node;
+        }
+
+        PooledAllocator* new_pool() {
+            std::lock_guard<std::mutex> lock(pools_mutex_);
+            pools_.push_back(new PooledAllocator);
+            return pools_.back();
+        }
+
+    private:
+        std::vector<PooledAllocator*> pools_;   // the nodes of the subtrees built on other threads
+        std::mutex pools_mutex_;
     };
 
-    #define get_tree(x) (reinterpret_cast<KD_Tree*>(x))
+    #define get_tree(x) (reinterpret_cast<KD_Tree<FT>*>(x))
 
 
+    // A tree loaded from an index file, which is queried directly in the mapped file: the nodes refer to their second
+    // child by its position, and the points of a leaf are stored next to each other. So nothing is copied, and only
+    // the pages visited by the queries are read from the disk. The search is the same as the one of nanoflann (and
+    // gives the same results). A node that is out of range is skipped, so a corrupted file doesn't make the queries
+    // read outside of it (see valid() for a complete check).
+    template <typename FT>
+    struct Mapped_KD_Tree {
+        explicit Mapped_KD_Tree(const std::string& file_name)
+            : file(file_name), size(0), num_nodes(0), vind(nullptr), nodes(nullptr)
+        {
+            coords[0] = coords[1] = coords[2] = nullptr;
+        }
 
-    KdTree::KdTree() {
-        points_ = nullptr;
-        tree_ = nullptr;
+        // sets up the arrays of the file (whose header has been checked)
+        void assign(const IndexFileHeader& header) {
+            size = header.num_points;
+            num_nodes = header.num_nodes;
+            const char* data = file.data() + sizeof(IndexFileHeader);
+            vind = reinterpret_cast<const uint32_t*>(data);
+            data += array_bytes<uint32_t>(size);
+            nodes = reinterpret_cast<const IndexFileNode<FT>*>(data);
+            data += array_bytes< IndexFileNode<FT> >(num_nodes);
+            for (int d = 0; d < 3; ++d) {
+                coords[d] = reinterpret_cast<const FT*>(data);
+                data += array_bytes<FT>(size);
+                bbox_low[d] = static_cast<FT>(header.bbox[2 * d]);
+                bbox_high[d] = static_cast<FT>(header.bbox[2 * d + 1]);
+            }
+        }
+
+        // checks the permutation and all the nodes, which takes linear time
+        bool valid() const {
+            for (std::size_t i = 0; i < size; ++i) {
+                if (vind[i] >= size)
+                    return false;
+            }
+            if (size == 0)
+                return num_nodes == 0;
+            std::size_t next = 0;
+            return valid_subtree(next) && next == num_nodes;
+        }
+
+        template <typename RESULTSET>
+        void findNeighbors(RESULTSET& result_set, const FT* vec) const {
+            if (size == 0 || num_nodes == 0)
+                return;
+            FT dists[3] = {0, 0, 0};
+            FT distsq = 0;
+            for (int d = 0; d < 3; ++d) {
+                if (vec[d] < bbox_low[d]) {
+                    dists[d] = (vec[d] - bbox_low[d]) * (vec[d] - bbox_low[d]);
+                    distsq += dists[d];
+                }
+                if (vec[d] > bbox_high[d]) {
+                    dists[d] = (vec[d] - bbox_high[d]) * (vec[d] - bbox_high[d]);
+                    distsq += dists[d];
+                }
+            }
+            search_level(result_set, vec, 0, distsq, dists);
+        }
+
+        MappedFile file;
+        std::size_t size;
+        std::size_t num_nodes;
+        const uint32_t* vind;
+        const IndexFileNode<FT>* nodes;
+        const FT* coords[3];
+        FT bbox_low[3];
+        FT bbox_high[3];
+
+    private:
+        // checks the subtree stored at nodes[next], and moves 'next' past it
+        bool valid_subtree(std::size_t& next) const {
+            if (next >= num_nodes)
+                return false;
+            const IndexFileNode<FT>& n = nodes[next++];
+            if (n.divfeat < 0)
+                return n.first <= n.last && n.last <= size;
+            if (n.divfeat > 2)
+                return false;
+            return valid_subtree(next) && next == n.first && valid_subtree(next);
+        }
+
+        // the same as searchLevel() of nanoflann. Returns false if the result set doesn't need more points.
+        template <typename RESULTSET>
+        bool search_level(RESULTSET& result_set, const FT* vec, std::size_t i, FT mindistsq, FT* dists) const {
+            const IndexFileNode<FT>& node = nodes[i];
+            if (node.divfeat < 0) {
+                const FT worst_dist = result_set.worstDist();
+                const std::size_t last = std::min<std::size_t>(node.last, size);
+                for (std::size_t k = node.first; k < last; ++k) {
+                    const FT dx = vec[0] - coords[0][k];
+                    const FT dy = vec[1] - coords[1][k];
+                    const FT dz = vec[2] - coords[2][k];
+                    const FT dist = dx * dx + dy * dy + dz * dz;
+                    if (dist < worst_dist && vind[k] < size) {
+                        if (!result_set.addPoint(dist, vind[k]))
+                            return false;
+                    }
+                }
+                return true;
+            }
+
+            // the second child comes after the first one, so the search always moves forward
+            if (node.divfeat > 2 || node.first <= i + 1 || node.first >= num_nodes)
+                return true;
+
+            const int idx = node.divfeat;
+            const FT val = vec[idx];
+            const FT diff1 = val - node.divlow;
+            const FT diff2 = val - node.divhigh;
+
+            std::size_t best_child, other_child;
+            FT cut_dist;
+            if ((diff1 + diff2) < 0) {
+                best_child = i + 1;
+                other_child = node.first;
+                cut_dist = (val - node.divhigh) * (val - node.divhigh);
+            }
+            else {
+                best_child = node.first;
+                other_child = i + 1;
+                cut_dist = (val - node.divlow) * (val - node.divlow);
+            }
+
+            if (!search_level(result_set, vec, best_child, mindistsq, dists))
+                return false;
+
+            const FT dst = dists[idx];
+            mindistsq = mindistsq + cut_dist - dst;
+            dists[idx] = cut_dist;
+            if (mindistsq <= result_set.worstDist()) {
+                if (!search_level(result_set, vec, other_child, mindistsq, dists))
+                    return false;
+            }
+            dists[idx] = dst;
+            return true;
+        }
+    };
+
+    #define get_mapped_tree(x) (reinterpret_cast<Mapped_KD_Tree<FT>*>(x))
+
+
+    // answers a query with the tree that has been built, or the one that has been loaded
+    template <typename FT, typename RESULTSET>
+    inline void find_neighbors(const void* tree, const void* mapped_tree, RESULTSET& result_set, const FT* p) {
+        if (mapped_tree)
+            reinterpret_cast<const Mapped_KD_Tree<FT>*>(mapped_tree)->findNeighbors(result_set, p);
+        else
+            reinterpret_cast<const KD_Tree<FT>*>(tree)->findNeighbors(result_set, p, nanoflann::SearchParams(10));
     }
 
 
-    KdTree::~KdTree() {
-        delete get_tree(tree_);
+    namespace {
+
+        // the number of queries processed by a task of the thread pool
+        const std::size_t kQueryChunk = 4096;
+
+
+        // Calls task(chunk, begin, end, thread) for the chunks [begin, end) of the queries [0, num_queries), on a pool
+        // of threads. 'thread' is the index of the worker in [0, num_threads) (e.g., to use its own scratch memory).
+        // Returns the number of threads that were used.
+        template <typename Task>
+        int for_each_chunk(std::size_t num_queries, int num_threads, const Task& task) {
+            const std::size_t num_chunks = (num_queries + kQueryChunk - 1) / kQueryChunk;
+            num_threads = static_cast<int>(std::min<std::size_t>(GetEffectiveNumThreads(num_threads), num_chunks));
+            if (num_threads <= 1) {
+                for (std::size_t c = 0; c < num_chunks; ++c)
+                    task(c, c * kQueryChunk, std::min(num_queries, (c + 1) * kQueryChunk), 0);
+                return 1;
+            }
+
+            ThreadPool pool(num_threads);
+            for (std::size_t c = 0; c < num_chunks; ++c) {
+                pool.AddTask([&pool, &task, c, num_queries]() {
+                    task(c, c * kQueryChunk, std::min(num_queries, (c + 1) * kQueryChunk), pool.GetThreadIndex());
+                });
+            }
+            pool.Wait();
+            return num_threads;
+        }
+
+
+        // Answers the K-nearest-neighbor queries [0, num_queries), each by search(result_set, i), where 'num' is the
+        // number of neighbors of each query (i.e., min(K, number of points)). The results go directly into their
+        // rows, so no scratch memory is needed.
+        template <typename FT, typename Search>
+        void batched_knn_queries(std::size_t num_queries, std::size_t num, NeighborsT<FT>& results, int num_threads,
+                                 const Search& search)
+        {
+            results.offsets.resize(num_queries + 1);
+            results.indices.resize(num_queries * num);
+            results.squared_distances.resize(num_queries * num);
+            for (std::size_t i = 0; i <= num_queries; ++i)
+                results.offsets[i] = i * num;
+            if (num == 0)
+                return;
+
+            int* indices = results.indices.data();
+            FT* squared_distances = results.squared_distances.data();
+            for_each_chunk(num_queries, num_threads, [&](std::size_t, std::size_t begin, std::size_t end, int) {
+                nanoflann::KNNResultSet<FT, int> result_set(num);
+                for (std::size_t i = begin; i < end; ++i) {
+                    result_set.init(indices + i * num, squared_distances + i * num);
+                    search(result_set, i);
+                }
+            });
+        }
+
+
+        // Answers the radius queries [0, num_queries), each by search(matches, i), which returns the matches of the
+        // i_th query as (index, squared distance) pairs.
+        template <typename FT, typename Match, typename Search>
+        void batched_radius_queries(std::size_t num_queries, NeighborsT<FT>& results, int num_threads,
+                                    const Search& search)
+        {
+            results.offsets.assign(num_queries + 1, 0);
+            if (num_queries == 0) {
+                results.indices.clear();
+                results.squared_distances.clear();
+                return;
+            }
+
+            // The number of neighbors is not known in advance, so each chunk collects its results, which are then
+            // copied to their final positions. Each thread reuses its own buffer for the matches of a query.
+            const std::size_t num_chunks = (num_queries + kQueryChunk - 1) / kQueryChunk;
+            std::vector< std::vector<int> > chunk_indices(num_chunks);
+            std::vector< std::vector<FT> > chunk_distances(num_chunks);
+            std::vector< std::vector<Match> > scratch(GetEffectiveNumThreads(num_threads));
+
+            for_each_chunk(num_queries, num_threads, [&](std::size_t c, std::size_t begin, std::size_t end, int thread) {
+                std::vector<Match>& matches = scratch[thread];
+                for (std::size_t i = begin; i < end; ++i) {
+                    search(matches, i);
+                    for (const auto& e : matches) {
+                        chunk_indices[c].push_back(static_cast<int>(e.first));
+                        chunk_distances[c].push_back(e.second);
+                    }
+                    results.offsets[i + 1] = matches.size();
+                }
+            });
+
+            // the counts become offsets
+            std::vector<std::size_t> chunk_offsets(num_chunks + 1, 0);
+            for (std::size_t i = 0; i < num_queries; ++i)
+                results.offsets[i + 1] += results.offsets[i];
+            for (std::size_t c = 0; c < num_chunks; ++c)
+                chunk_offsets[c + 1] = chunk_offsets[c] + chunk_indices[c].size();
+
+            results.indices.resize(chunk_offsets[num_chunks]);
+            results.squared_distances.resize(chunk_offsets[num_chunks]);
+            for_each_chunk(num_queries, num_threads, [&](std::size_t c, std::size_t, std::size_t, int) {
+                std::copy(chunk_indices[c].begin(), chunk_indices[c].end(), results.indices.begin() + chunk_offsets[c]);
+                std::copy(chunk_distances[c].begin(), chunk_distances[c].end(),
+                          results.squared_distances.begin() + chunk_offsets[c]);
+            });
+        }
+
     }
 
 
-    void KdTree::begin() {
+
+    template <typename FT>
+    BasicKdTree<FT>::BasicKdTree()
+        : tree_(nullptr)
+        , mapped_tree_(nullptr)
+        , leaf_size_(10)
+        , num_threads_(-1)
+    {
+    }
+
+
+    template <typename FT>
+    BasicKdTree<FT>::~BasicKdTree() {
         delete get_tree(tree_);
-        tree_ = nullptr;
+        delete get_mapped_tree(mapped_tree_);
     }
 
 
-    void KdTree::end() {
-        PointSet* pset = new PointSet(points_);
-        KD_Tree* tree = new KD_Tree(pset);
-        tree->buildIndex();
+    template <typename FT>
+    void BasicKdTree<FT>::set_leaf_size(int size) {
+        leaf_size_ = std::max(size, 1);
+    }
+
+
+    template <typename FT>
+    void BasicKdTree<FT>::set_num_threads(int num) {
+        num_threads_ = num;
+    }
+
+
+    template <typename FT>
+    void BasicKdTree<FT>::build(const Point* points, std::size_t num) {
+        delete get_tree(tree_);
+        delete get_mapped_tree(mapped_tree_);
+        mapped_tree_ = nullptr;
+        KD_Tree<FT>* tree = new KD_Tree<FT>(points, num, leaf_size_);
+        tree->build(GetEffectiveNumThreads(num_threads_));
         tree_ = tree;
     }
 
 
-    void KdTree::add_point_cloud(PointCloud* cloud) {
-        points_ = &cloud->points();
+    template <typename FT>
+    std::size_t BasicKdTree<FT>::num_points() const {
+        if (mapped_tree_)
+            return get_mapped_tree(mapped_tree_)->size;
+        return tree_ ? get_tree(tree_)->m_size : 0;
     }
 
 
-    int KdTree::find_closest_point(const vec3& p, float& squared_distance) const {
+    template <typename FT>
+    void BasicKdTree<FT>::leaf_order(std::vector<int>& indices) const {
+        if (mapped_tree_) {
+            const Mapped_KD_Tree<FT>* tree = get_mapped_tree(mapped_tree_);
+            indices.assign(tree->vind, tree->vind + tree->size);
+            return;
+        }
+        if (!tree_) {
+            indices.clear();
+            return;
+        }
+        const std::vector<std::size_t>& vind = get_tree(tree_)->vind;
+        indices.assign(vind.begin(), vind.end());
+    }
+
+
+    template <typename FT>
+    int BasicKdTree<FT>::find_closest_point(const Point& p, FT& squared_distance) const {
         std::size_t index;
 
-        nanoflann::KNNResultSet<float> result_set(1);
+        nanoflann::KNNResultSet<FT> result_set(1);
         result_set.init(&index, &squared_distance);
 
-        get_tree(tree_)->findNeighbors(result_set, p, nanoflann::SearchParams(10));
+        find_neighbors(tree_, mapped_tree_, result_set, p.data());
         return index;
     }
 
 
-    int KdTree::find_closest_point(const vec3& p) const {
-        float dist = 0;
+    template <typename FT>
+    int BasicKdTree<FT>::find_closest_point(const Point& p) const {
+        FT dist = 0;
         return find_closest_point(p, dist);
     }
 
 
-    void KdTree::find_closest_K_points(
-        const vec3& p, int k, std::vector<int>& neighbors, std::vector<float>& squared_distances
+    template <typename FT>
+    void BasicKdTree<FT>::find_closest_K_points(
+        const Point& p, int k, std::vector<int>& neighbors, std::vector<FT>& squared_distances
     )  const
     {
         std::vector<size_t> indices(k);
-        std::vector<float>	sqr_distances(k);
+        std::vector<FT>	sqr_distances(k);
 
-        nanoflann::KNNResultSet<float> result_set(k);
+        nanoflann::KNNResultSet<FT> result_set(k);
         result_set.init(&indices[0], &sqr_distances[0]);
-        get_tree(tree_)->findNeighbors(result_set, p, nanoflann::SearchParams(10));
+        find_neighbors(tree_, mapped_tree_, result_set, p.data());
 
         neighbors = std::vector<int>(indices.begin(), indices.end());
         squared_distances = sqr_distances;
     }
 
 
-    void KdTree::find_closest_K_points(
-        const vec3& p, int k, std::vector<int>& neighbors
+    template <typename FT>
+    void BasicKdTree<FT>::find_closest_K_points(
+        const Point& p, int k, std::vector<int>& neighbors
     )  const
     {
-        std::vector<float> squared_distances;
+        std::vector<FT> squared_distances;
         return find_closest_K_points(p, k, neighbors, squared_distances);
     }
 
 
-    void KdTree::find_points_in_radius(
-        const vec3& p, float radius, std::vector<int>& neighbors, std::vector<float>& squared_distances
+    template <typename FT>
+    void BasicKdTree<FT>::find_points_in_radius(
+        const Point& p, FT radius, std::vector<int>& neighbors, std::vector<FT>& squared_distances
     )  const {
-        std::vector<std::pair<std::size_t, float> >   matches;
-        nanoflann::SearchParams params;
-        params.sorted = false;
-        const std::size_t num = get_tree(tree_)->radiusSearch(p, radius, matches, params);
+        std::vector<std::pair<std::size_t, FT> >   matches;
+        nanoflann::RadiusResultSet<FT> result_set(radius, matches);   // the matches are not sorted
+        find_neighbors(tree_, mapped_tree_, result_set, p.data());
+        const std::size_t num = matches.size();
 
         neighbors.resize(num);
         squared_distances.resize(num);
         for (std::size_t i = 0; i < num; ++i) {
-            const std::pair<std::size_t, float>& e = matches[i];
+            const std::pair<std::size_t, FT>& e = matches[i];
             neighbors[i] = e.first;
             squared_distances[i] = e.second;
         }
     }
 
 
-    void KdTree::find_points_in_radius(
-        const vec3& p, float radius, std::vector<int>& neighbors
+    template <typename FT>
+    void BasicKdTree<FT>::find_points_in_radius(
+        const Point& p, FT radius, std::vector<int>& neighbors
     )  const
     {
-        std::vector<float> sqr_distances;
+        std::vector<FT> sqr_distances;
         return find_points_in_radius(p, radius, neighbors, sqr_distances);
     }
 
 
+    template <typename FT>
+    void BasicKdTree<FT>::find_closest_K_points(
+            const Point* queries, std::size_t num_queries, int k, NeighborsT<FT>& results, int num_threads
+    ) const
+    {
+        const std::size_t num = std::min<std::size_t>(k > 0 ? k : 0, num_points());
+        batched_knn_queries(num_queries, num, results, num_threads,
+                            [&](nanoflann::KNNResultSet<FT, int>& result_set, std::size_t i) {
+            find_neighbors(tree_, mapped_tree_, result_set, queries[i].data());
+        });
+    }
+
+
+    template <typename FT>
+    void BasicKdTree<FT>::find_points_in_radius(
+            const Point* queries, std::size_t num_queries, FT squared_radius, NeighborsT<FT>& results, int num_threads
+    ) const
+    {
+        typedef std::pair<std::size_t, FT> Match;
+        batched_radius_queries<FT, Match>(num_queries, results, num_threads,
+                                          [&](std::vector<Match>& matches, std::size_t i) {
+            nanoflann::RadiusResultSet<FT> result_set(squared_radius, matches);   // the matches are not sorted
+            if (num_points() > 0)
+                find_neighbors(tree_, mapped_tree_, result_set, queries[i].data());
+        });
+    }
+
+
+
+    namespace {
+
+        // A 64-bit FNV-1a hash of the coordinates of the points, computed on whole coordinates (instead of bytes).
+        // 'coord(i, d)' returns the d_th coordinate of the i_th point.
+        template <typename FT, typename Coord>
+        uint64_t points_checksum(std::size_t num, const Coord& coord) {
+            uint64_t hash = 14695981039346656037ULL;
+            for (std::size_t i = 0; i < num; ++i) {
+                for (int d = 0; d < 3; ++d) {
+                    const FT v = coord(i, d);
+                    uint64_t bits = 0;
+                    std::memcpy(&bits, &v, sizeof(FT));
+                    hash = (hash ^ bits) * 1099511628211ULL;
+                }
+            }
+            return hash;
+        }
+
+    }
+
+
+    template <typename FT>
+    uint64_t BasicKdTree<FT>::checksum(const Point* points, std::size_t num) {
+        return points_checksum<FT>(num, [points](std::size_t i, int d) { return points[i][d]; });
+    }
+
+
+    template <typename FT>
+    bool BasicKdTree<FT>::save(const std::string& file_name) const {
+        if (mapped_tree_) {     // the file of a loaded tree is copied as it is
+            const MappedFile& file = get_mapped_tree(mapped_tree_)->file;
+            std::ofstream output(file_name.c_str(), std::ios::binary);
+            if (output.fail()) {
+                LOG(ERROR) << "could not open file: " << file_name;
+                return false;
+            }
+            output.write(file.data(), file.size());
+            if (output.fail()) {
+                LOG(ERROR) << "failed writing file: " << file_name;
+                return false;
+            }
+            return true;
+        }
+
+        const KD_Tree<FT>* tree = get_tree(tree_);
+        if (!tree) {
+            LOG(ERROR) << "the kd-tree has not been built";
+            return false;
+        }
+        if (tree->m_size > std::numeric_limits<uint32_t>::max()) {
+            LOG(ERROR) << "too many points to save the kd-tree: " << tree->m_size;
+            return false;
+        }
+
+        const std::size_t num = tree->m_size;
+        std::vector< IndexFileNode<FT> > nodes;
+        if (tree->root_node)
+            tree->flatten(tree->root_node, nodes);
+        const std::vector<uint32_t> vind(tree->vind.begin(), tree->vind.end());
+
+        IndexFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, kIndexFileMagic, sizeof(header.magic));
+        header.version = kIndexFileVersion;
+        header.scalar_size = sizeof(FT);
+        header.num_points = num;
+        header.num_nodes = nodes.size();
+        const PointSetSoA<FT>& pset = tree->pset_;
+        header.checksum = points_checksum<FT>(num, [&pset](std::size_t i, int d) {
+            return pset.kdtree_get_pt(i, d);
+        });
+        header.leaf_size = static_cast<uint32_t>(tree->m_leaf_max_size);
+        for (int d = 0; d < 3; ++d) {
+            header.bbox[2 * d] = num > 0 ? tree->root_bbox[d].low : 0.0;
+            header.bbox[2 * d + 1] = num > 0 ? tree->root_bbox[d].high : 0.0;
+        }
+
+        std::ofstream output(file_name.c_str(), std::ios::binary);
+        if (output.fail()) {
+            LOG(ERROR) << "could not open file: " << file_name;
+            return false;
+        }
+        // writes an array, padded with zeros to array_bytes()
+        auto write_array = [&output](const void* data, std::size_t bytes) {
+            const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+            output.write(static_cast<const char*>(data), bytes);
+            output.write(padding, (8 - bytes % 8) % 8);
+        };
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        write_array(vind.data(), vind.size() * sizeof(uint32_t));
+        write_array(nodes.data(), nodes.size() * sizeof(IndexFileNode<FT>));
+        std::vector<FT> coords(num);
+        for (int d = 0; d < 3; ++d) {
+            for (std::size_t k = 0; k < num; ++k)
+                coords[k] = pset.kdtree_get_pt(tree->vind[k], d);
+            write_array(coords.data(), coords.size() * sizeof(FT));
+        }
+        if (output.fail()) {
+            LOG(ERROR) << "failed writing file: " << file_name;
+            return false;
+        }
+        return true;
+    }
+
+
+    template <typename FT>
+    bool BasicKdTree<FT>::load(const std::string& file_name, const Point* points, std::size_t num, bool verify) {
+        Mapped_KD_Tree<FT>* tree = new Mapped_KD_Tree<FT>(file_name);
+        const MappedFile& file = tree->file;
+        if (!file.data()) {
+            LOG(ERROR) << "could not open file: " << file_name;
+            delete tree;
+            return false;
+        }
+
+        IndexFileHeader header;
+        if (file.size() < sizeof(header)) {
+            LOG(ERROR) << "not a kd-tree index file: " << file_name;
+            delete tree;
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, kIndexFileMagic, sizeof(header.magic)) != 0 ||
+            header.version != kIndexFileVersion || header.scalar_size != sizeof(FT)) {
+            LOG(ERROR) << "not a kd-tree index file (or of another version or precision): " << file_name;
+            delete tree;
+            return false;
+        }
+
+        // a tree has at most 2n - 1 nodes, which also keeps the expected size from overflowing
+        if (header.num_points > std::numeric_limits<uint32_t>::max() || header.num_nodes > 2 * header.num_points ||
+            file.size() != sizeof(header) + array_bytes<uint32_t>(header.num_points) +
+                           array_bytes< IndexFileNode<FT> >(header.num_nodes) + 3 * array_bytes<FT>(header.num_points)) {
+            LOG(ERROR) << "the kd-tree index file is truncated or corrupted: " << file_name;
+            delete tree;
+            return false;
+        }
+
+        // the index is stale if the points have changed since it was saved
+        if (header.num_points != num || header.checksum != checksum(points, num)) {
+            LOG(WARNING) << "the kd-tree index doesn't match the points (it has to be rebuilt): " << file_name;
+            delete tree;
+            return false;
+        }
+
+        tree->assign(header);
+        if (verify && !tree->valid()) {
+            LOG(ERROR) << "the kd-tree index file is corrupted: " << file_name;
+            delete tree;
+            return false;
+        }
+
+        delete get_tree(tree_);
+        tree_ = nullptr;
+        delete get_mapped_tree(mapped_tree_);
+        mapped_tree_ = tree;
+        leaf_size_ = static_cast<int>(header.leaf_size);
+        return true;
+    }
+
+
+    template class BasicKdTree<float>;
+    template class BasicKdTree<double>;
+
+
+    KdTree::KdTree() {
+        points_ = nullptr;
+    }
+
+
+    void KdTree::begin() {
+        delete reinterpret_cast<KD_Tree<float>*>(tree_);
+        tree_ = nullptr;
+        delete reinterpret_cast<Mapped_KD_Tree<float>*>(mapped_tree_);
+        mapped_tree_ = nullptr;
+    }
+
+
+    void KdTree::add_point_cloud(PointCloud* cloud) {
+        points_ = &cloud->points();
+    }
+
+
+    void KdTree::end() {
+        build(points_->data(), points_->size());
+    }
+
+
+
+    // A level of the dynamic kd-tree, i.e., a static kd-tree of some of the points
+    template <typename FT>
+    struct KD_Level {
+        KD_Level(const Vec<3, FT>* points, std::vector<int>& point_ids, int leaf_size)
+            : tree(points, point_ids.size(), leaf_size)
+            , num_removed(0)
+        {
+            ids.swap(point_ids);
+            tree.build(GetEffectiveNumThreads(-1));
+        }
+
+        KD_Tree<FT> tree;
+        std::vector<int> ids;       // the index of each point of the tree in the dynamic kd-tree
+        std::size_t num_removed;    // the number of the removed points
+    };
+
+    #define get_level(x) (reinterpret_cast<KD_Level<FT>*>(x))
+
+
+    namespace {
+
+        // Passes the points of a level to the results, with their indices in the dynamic kd-tree, and skips the
+        // removed points.
+        template <typename ResultSet>
+        struct LiveResultSet {
+            typedef typename ResultSet::DistanceType DistanceType;
+
+            LiveResultSet(ResultSet& set, const std::vector<int>& ids, const std::vector<int>& level_of)
+                : results(set), ids(ids), level_of(level_of) {}
+
+            inline DistanceType worstDist() const { return results.worstDist(); }
+            inline bool full() const { return results.full(); }
+
+            inline bool addPoint(DistanceType dist, std::size_t index) {
+                const int id = ids[index];
+                if (level_of[id] < 0)
+                    return true;
+                return results.addPoint(dist, id);
+            }
+
+            ResultSet& results;
+            const std::vector<int>& ids;
+            const std::vector<int>& level_of;
+        };
+
+
+        // Searches all levels, starting with the largest one (so its results prune most of the smaller ones)
+        template <typename FT, typename ResultSet>
+        void search_levels(const std::vector<void*>& levels, const std::vector<int>& level_of, const Vec<3, FT>& p,
+                           ResultSet& results)
+        {
+            for (std::size_t i = levels.size(); i > 0; --i) {
+                const KD_Level<FT>* level = get_level(levels[i - 1]);
+                if (!level || level->num_removed == level->ids.size())
+                    continue;
+                LiveResultSet<ResultSet> live(results, level->ids, level_of);
+                level->tree.findNeighbors(live, p, nanoflann::SearchParams(10));
+            }
+        }
+
+    }
+
+
+    template <typename FT>
+    BasicDynamicKdTree<FT>::BasicDynamicKdTree()
+        : num_points_(0)
+        , leaf_size_(10)
+    {
+    }
+
+
+    template <typename FT>
+    BasicDynamicKdTree<FT>::~BasicDynamicKdTree() {
+        clear();
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::set_leaf_size(int size) {
+        leaf_size_ = std::max(size, 1);
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::clear() {
+        for (auto level : levels_)
+            delete get_level(level);
+        levels_.clear();
+        points_.clear();
+        level_of_.clear();
+        num_points_ = 0;
+    }
+
+
+    template <typename FT>
+    bool BasicDynamicKdTree<FT>::contains(int index) const {
+        return index >= 0 && index < static_cast<int>(level_of_.size()) && level_of_[index] >= 0;
+    }
+
+
+    template <typename FT>
+    std::size_t BasicDynamicKdTree<FT>::num_levels() const {
+        return levels_.size() - std::count(levels_.begin(), levels_.end(), nullptr);
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::build_level(std::size_t level, std::vector<int>& ids) {
+        std::vector<Point> points(ids.size());
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            points[i] = points_[ids[i]];
+            level_of_[ids[i]] = static_cast<int>(level);
+        }
+        levels_[level] = new KD_Level<FT>(points.data(), ids, leaf_size_);
+    }
+
+
+    template <typename FT>
+    int BasicDynamicKdTree<FT>::insert(const Point& p) {
+        return insert(&p, 1);
+    }
+
+
+    template <typename FT>
+    int BasicDynamicKdTree<FT>::insert(const Point* points, std::size_t num) {
+        const int first = static_cast<int>(points_.size());
+        if (num == 0)
+            return first;
+
+        points_.insert(points_.end(), points, points + num);
+        level_of_.resize(points_.size(), -1);
+        num_points_ += num;
+
+        std::vector<int> ids(num);
+        for (std::size_t i = 0; i < num; ++i)
+            ids[i] = first + static_cast<int>(i);
+
+        // the new points and those of the lower levels go to the first level that is empty and large enough
+        for (std::size_t i = 0; ; ++i) {
+            if (i == levels_.size())
+                levels_.push_back(nullptr);
+
+            KD_Level<FT>* level = get_level(levels_[i]);
+            if (!level && ids.size() <= (kBaseSize << i)) {
+                build_level(i, ids);
+                break;
+            }
+            if (level) {
+                for (auto id : level->ids) {
+                    if (level_of_[id] >= 0)
+                        ids.push_back(id);
+                }
+                delete level;
+                levels_[i] = nullptr;
+            }
+        }
+        return first;
+    }
+
+
+    template <typename FT>
+    bool BasicDynamicKdTree<FT>::remove(int index) {
+        if (!contains(index))
+            return false;
+
+        const int i = level_of_[index];
+        level_of_[index] = -1;
+        --num_points_;
+
+        // a level is rebuilt when half of its points are removed, so the removed points don't slow down the queries
+        KD_Level<FT>* level = get_level(levels_[i]);
+        if (++level->num_removed * 2 >= level->ids.size()) {
+            std::vector<int> ids;
+            for (auto id : level->ids) {
+                if (level_of_[id] >= 0)
+                    ids.push_back(id);
+            }
+            delete level;
+            levels_[i] = nullptr;
+            if (!ids.empty())
+                build_level(i, ids);
+        }
+        return true;
+    }
+
+
+    template <typename FT>
+    int BasicDynamicKdTree<FT>::find_closest_point(const Point& p, FT& squared_distance) const {
+        std::vector<int> neighbors;
+        std::vector<FT> squared_distances;
+        find_closest_K_points(p, 1, neighbors, squared_distances);
+        if (neighbors.empty()) {
+            squared_distance = std::numeric_limits<FT>::max();
+            return -1;
+        }
+        squared_distance = squared_distances[0];
+        return neighbors[0];
+    }
+
+
+    template <typename FT>
+    int BasicDynamicKdTree<FT>::find_closest_point(const Point& p) const {
+        FT dist = 0;
+        return find_closest_point(p, dist);
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::find_closest_K_points(
+            const Point& p, int k, std::vector<int>& neighbors, std::vector<FT>& squared_distances
+    ) const
+    {
+        const std::size_t num = std::min<std::size_t>(k > 0 ? k : 0, num_points_);
+        neighbors.resize(num);
+        squared_distances.resize(num);
+        if (num == 0)
+            return;
+
+        nanoflann::KNNResultSet<FT, int> result_set(num);
+        result_set.init(neighbors.data(), squared_distances.data());
+        search_levels(levels_, level_of_, p, result_set);
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::find_closest_K_points(const Point& p, int k, std::vector<int>& neighbors) const {
+        std::vector<FT> squared_distances;
+        find_closest_K_points(p, k, neighbors, squared_distances);
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::find_points_in_radius(
+            const Point& p, FT radius, std::vector<int>& neighbors, std::vector<FT>& squared_distances
+    ) const
+    {
+        std::vector< std::pair<int, FT> > matches;
+        nanoflann::RadiusResultSet<FT, int> result_set(radius, matches);
+        search_levels(levels_, level_of_, p, result_set);
+
+        neighbors.resize(matches.size());
+        squared_distances.resize(matches.size());
+        for (std::size_t i = 0; i < matches.size(); ++i) {
+            neighbors[i] = matches[i].first;
+            squared_distances[i] = matches[i].second;
+        }
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::find_points_in_radius(const Point& p, FT radius, std::vector<int>& neighbors) const {
+        std::vector<FT> squared_distances;
+        find_points_in_radius(p, radius, neighbors, squared_distances);
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::find_closest_K_points(
+            const Point* queries, std::size_t num_queries, int k, NeighborsT<FT>& results, int num_threads
+    ) const
+    {
+        const std::size_t num = std::min<std::size_t>(k > 0 ? k : 0, num_points_);
+        batched_knn_queries(num_queries, num, results, num_threads,
+                            [&](nanoflann::KNNResultSet<FT, int>& result_set, std::size_t i) {
+            search_levels(levels_, level_of_, queries[i], result_set);
+        });
+    }
+
+
+    template <typename FT>
+    void BasicDynamicKdTree<FT>::find_points_in_radius(
+            const Point* queries, std::size_t num_queries, FT squared_radius, NeighborsT<FT>& results, int num_threads
+    ) const
+    {
+        typedef std::pair<int, FT> Match;
+        batched_radius_queries<FT, Match>(num_queries, results, num_threads,
+                                          [&](std::vector<Match>& matches, std::size_t i) {
+            nanoflann::RadiusResultSet<FT, int> result_set(squared_radius, matches);
+            search_levels(levels_, level_of_, queries[i], result_set);
+        });
+    }
+
+
+    template class BasicDynamicKdTree<float>;
+    template class BasicDynamicKdTree<double>;
+
+
 } // namespace easy3d
@@ -23,32 +23,98 @@
 #define EASY3D_KD_TREE_H
 
 #include <easy3d/core/types.h>
+#include <string>
 #include <vector>
+#include <cstdint>
 
 namespace easy3d {
 
     class PointCloud;
 
-    class KdTree  {
+    /// The results of a batch of queries, stored in compressed rows (CSR): the neighbors of the i_th query are
+    /// indices[offsets[i]], ..., indices[offsets[i + 1] - 1], and their squared distances to the query point are at
+    /// the same positions of squared_distances. The arrays are only resized, so a Neighbors reused for the next batch
+    /// doesn't allocate memory (unless that batch has more results).
+    template <typename FT>
+    struct NeighborsT {
+        std::vector<std::size_t> offsets;   // num_queries + 1 entries
+        std::vector<int> indices;
+        std::vector<FT> squared_distances;
+
+        std::size_t num_queries() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+        std::size_t num_neighbors(std::size_t query) const { return offsets[query + 1] - offsets[query]; }
+    };
+
+    typedef NeighborsT<float>   Neighbors;
+    typedef NeighborsT<double>  dNeighbors;
+
+
+    /// A kd-tree of 3D points in FT precision. It is instantiated for float (see KdTree) and double (see dKdTree,
+    /// e.g., for georeferenced coordinates, whose large offsets leave too few significant digits in float).
+    template <typename FT>
+    class BasicKdTree {
     public:
-        KdTree();
-        virtual ~KdTree();
+        typedef Vec<3, FT> Point;
+
+    public:
+        BasicKdTree();
+        virtual ~BasicKdTree();
 
         //______________ tree construction __________________________
 
-        // call the following functions to build a kd-tree of a point cloud.
-        virtual void begin() ;
-        virtual void add_point_cloud(PointCloud* cloud) ;
-        virtual void end() ;    // now your kd-tree is ready.
+        // the maximum number of points in a leaf (10 by default). Smaller leaves make the queries faster and the tree
+        // larger. Takes effect on the next build().
+        void set_leaf_size(int size);
+        int leaf_size() const { return leaf_size_; }
+
+        // the number of threads building the tree, i.e., the subtrees are constructed concurrently (all the logical
+        // cores by default, or if it is not positive). Takes effect on the next build().
+        void set_num_threads(int num);
+        int num_threads() const { return num_threads_; }
+
+        // builds the kd-tree of the points. The points are copied into the tree (as three separate arrays of x, y,
+        // and z coordinates), so they don't have to be kept alive.
+        virtual void build(const Point* points, std::size_t num);
+
+        // the number of points in the tree.
+        std::size_t num_points() const;
+
+        // the indices of the points sorted by the leaves of the tree, i.e., nearby points are close to each other in
+        // this order. Processing many queries (e.g., the points themselves) in this order makes better use of caches.
+        void leaf_order(std::vector<int>& indices) const;
+
+        //______________ index files __________________________
+
+        // Saves the built (or loaded) tree into a binary file, so it doesn't have to be rebuilt next time (see
+        // load()). The file contains the structure of the tree, the points in the order of its leaves, and a checksum
+        // of the points.
+        bool save(const std::string& file_name) const;
+
+        // Loads the tree of the points from a file written by save(). The file is mapped into memory and queried
+        // directly (it stays mapped until the tree is rebuilt or destroyed), so only the parts of the file visited by
+        // the queries are read from the disk. It fails (and the current tree is kept) if it is not an index file of
+        // this precision, if its size is wrong, or if it is stale, i.e., it was saved for other points (the checksum
+        // of 'points' is compared with the one in the file, which is a single pass over the points and much cheaper
+        // than rebuilding the tree). With 'verify', the whole structure of the tree is also checked, which takes
+        // linear time but detects a corrupted file. The points are not used otherwise. E.g.,
+        //      if (!tree.load(file_name, points, num)) {
+        //          tree.build(points, num);
+        //          tree.save(file_name);
+        //      }
+        bool load(const std::string& file_name, const Point* points, std::size_t num, bool verify = false);
+
+        // the checksum of the points, which identifies the points an index file was built from.
+        static uint64_t checksum(const Point* points, std::size_t num);
 
         //________________ closest point ____________________________
 
         // find the closest point of p in the point cloud.
         // return the index of the found point.
-        virtual int find_closest_point(const vec3& p) const;
+        virtual int find_closest_point(const Point& p) const;
 
         // the same as the previous one, but it also returns its squared_distance to the query point.
-        virtual int find_closest_point(const vec3& p, float& squared_distance) const;
+        virtual int find_closest_point(const Point& p, FT& squared_distance) const;
 
 
         //_________________ K-nearest neighbors ____________________
@@ -56,14 +122,14 @@ namespace easy3d {
         // find closest K points of p in the point cloud.
         // return the indices of the found points in 'neighbors'.
         virtual void find_closest_K_points(
-            const vec3& p, int k,
+            const Point& p, int k,
             std::vector<int>& neighbors
             ) const ;
 
         // the same as the previous one, but it also returns their squared_distances to the query point.
         virtual void find_closest_K_points(
-            const vec3& p, int k,
-            std::vector<int>& neighbors, std::vector<float>& squared_distances
+            const Point& p, int k,
+            std::vector<int>& neighbors, std::vector<FT>& squared_distances
             ) const ;
 
 
@@ -71,23 +137,193 @@ namespace easy3d {
 
         // search for all points within the 'radius' range.
         // return the indices of the found points in 'neighbors'.
+        // NOTE: 'radius' is compared with the squared distances, i.e., pass the squared value of the radius.
         virtual void find_points_in_radius(
-                const vec3& p, float radius,
+                const Point& p, FT radius,
                 std::vector<int>& neighbors
                 ) const;
 
         // the same as the previous one, but it also returns their squared_distances to the query point.
         virtual void find_points_in_radius(
-                const vec3& p, float radius,
+                const Point& p, FT radius,
                 std::vector<int>& neighbors,
-                std::vector<float>& squared_distances
+                std::vector<FT>& squared_distances
+                ) const;
+
+
+        //___________________ batched queries ___________________________
+
+        // The following functions answer a batch of queries at once, distributed over 'num_threads' threads (all the
+        // logical cores if it is not positive). The results are written into 'results' (see Neighbors), and each
+        // thread reuses its own scratch memory, so there is no allocation per query.
+
+        // find the closest K points of each of the 'num_queries' points starting at 'queries'.
+        // Each query gets min(K, number of points) neighbors, sorted by their distances.
+        virtual void find_closest_K_points(
+                const Point* queries, std::size_t num_queries, int k,
+                NeighborsT<FT>& results, int num_threads = -1
+                ) const;
+
+        // find all points within the range of each query point. Note that the range is given by its squared value
+        // (the same as the single query above), i.e., the points whose squared distances to the query point are
+        // smaller than 'squared_radius'. The neighbors are not sorted.
+        virtual void find_points_in_radius(
+                const Point* queries, std::size_t num_queries, FT squared_radius,
+                NeighborsT<FT>& results, int num_threads = -1
                 ) const;
 
     protected:
-        std::vector<vec3>*	points_; // reference of the original point cloud data
         void*				tree_;
+        void*               mapped_tree_;   // the tree loaded by load(), which is queried in the mapped file
+        int                 leaf_size_;
+        int                 num_threads_;
+
+    private:
+        //copying disabled
+        BasicKdTree(const BasicKdTree&);
+        BasicKdTree& operator=(const BasicKdTree&);
+    } ;
+
+
+    /// The kd-tree of a point cloud.
+    class KdTree : public BasicKdTree<float> {
+    public:
+        KdTree();
+
+        //______________ tree construction __________________________
+
+        // call the following functions to build a kd-tree of a point cloud.
+        virtual void begin() ;
+        virtual void add_point_cloud(PointCloud* cloud) ;
+        virtual void end() ;    // now your kd-tree is ready.
+
+    protected:
+        std::vector<vec3>*	points_; // reference of the original point cloud data
     } ;
 
+
+    /// The kd-tree of points in double precision.
+    typedef BasicKdTree<double> dKdTree;
+
+
+    /// A kd-tree that allows inserting and removing points at any time, e.g., for points that arrive continuously.
+    ///
+    /// The points are kept in a logarithmic forest: level i is either empty or a static kd-tree of at most
+    /// kBaseSize * 2^i points. New points are merged with the lower levels into the first level that is empty and
+    /// large enough, so each point is rebuilt at most log(n) times, i.e., an insertion costs amortized O(log n) tree
+    /// building per point. A removed point is only marked, and a level is rebuilt when half of its points are removed.
+    /// The queries search all levels (starting with the largest one), skipping the removed points.
+    ///
+    /// Each point is identified by the index returned by insert(), which doesn't change when other points are inserted
+    /// or removed (the indices are not reused). The queries return these indices.
+    ///
+    /// The queries can run concurrently, but not with insert() or remove().
+    template <typename FT>
+    class BasicDynamicKdTree {
+    public:
+        typedef Vec<3, FT> Point;
+
+        // the capacity of the lowest level
+        static const std::size_t kBaseSize = 64;
+
+    public:
+        BasicDynamicKdTree();
+        virtual ~BasicDynamicKdTree();
+
+        // the maximum number of points in a leaf of the trees of the levels (10 by default).
+        void set_leaf_size(int size);
+        int leaf_size() const { return leaf_size_; }
+
+        //______________ insertion and removal __________________________
+
+        // inserts a point, and returns its index.
+        int insert(const Point& p);
+
+        // inserts 'num' points, and returns the index of the first one (the others have the subsequent indices).
+        int insert(const Point* points, std::size_t num);
+
+        // removes the point of the given index. Returns false if it doesn't exist (or has been removed).
+        bool remove(int index);
+
+        // removes all the points (the indices of new points start from 0 again).
+        void clear();
+
+        // whether the point of the given index exists (i.e., has been inserted and not removed).
+        bool contains(int index) const;
+
+        // the point of the given index (also if it has been removed).
+        const Point& point(int index) const { return points_[index]; }
+
+        // the number of points (not counting the removed ones).
+        std::size_t num_points() const { return num_points_; }
+
+        // the number of non-empty levels.
+        std::size_t num_levels() const;
+
+        //________________ closest point ____________________________
+
+        // find the closest point of p. Returns its index, or -1 if there are no points.
+        int find_closest_point(const Point& p) const;
+
+        // the same as the previous one, but it also returns its squared_distance to the query point.
+        int find_closest_point(const Point& p, FT& squared_distance) const;
+
+        //_________________ K-nearest neighbors ____________________
+
+        // find closest K points of p (or all points if there are fewer), sorted by their distances.
+        void find_closest_K_points(const Point& p, int k, std::vector<int>& neighbors) const;
+
+        // the same as the previous one, but it also returns their squared_distances to the query point.
+        void find_closest_K_points(
+                const Point& p, int k,
+                std::vector<int>& neighbors, std::vector<FT>& squared_distances
+                ) const;
+
+        //___________________ fixed-radius search ___________________________
+
+        // search for all points within the 'radius' range.
+        // NOTE: 'radius' is compared with the squared distances (the same as KdTree).
+        void find_points_in_radius(const Point& p, FT radius, std::vector<int>& neighbors) const;
+
+        // the same as the previous one, but it also returns their squared_distances to the query point.
+        void find_points_in_radius(
+                const Point& p, FT radius,
+                std::vector<int>& neighbors, std::vector<FT>& squared_distances
+                ) const;
+
+        //___________________ batched queries ___________________________
+
+        // the same as the batched queries of KdTree.
+        void find_closest_K_points(
+                const Point* queries, std::size_t num_queries, int k,
+                NeighborsT<FT>& results, int num_threads = -1
+                ) const;
+
+        void find_points_in_radius(
+                const Point* queries, std::size_t num_queries, FT squared_radius,
+                NeighborsT<FT>& results, int num_threads = -1
+                ) const;
+
+    private:
+        // builds the tree of 'level' from the points of 'ids'
+        void build_level(std::size_t level, std::vector<int>& ids);
+
+    private:
+        std::vector<void*>      levels_;    // the trees of the levels (null for the empty levels)
+        std::vector<Point>      points_;    // all the points ever inserted
+        std::vector<int>        level_of_;  // the level of each point (-1 for the removed points)
+        std::size_t             num_points_;
+        int                     leaf_size_;
+
+    private:
+        //copying disabled
+        BasicDynamicKdTree(const BasicDynamicKdTree&);
+        BasicDynamicKdTree& operator=(const BasicDynamicKdTree&);
+    };
+
+    typedef BasicDynamicKdTree<float>   DynamicKdTree;
+    typedef BasicDynamicKdTree<double>  dDynamicKdTree;
+
 } // namespace easy3d
 
 #endif  // EASY3D_KD_TREE_H
@@ -40,6 +40,7 @@
 
 #include <easy3d/viewer/manipulated_camera_frame.h>
 #include <easy3d/viewer/key_frame_interpolator.h>
+#include <easy3d/core/rq_decomposition.h>
 
 
 namespace easy3d {
@@ -1095,10 +1096,9 @@ namespace easy3d {
      This code was written by Sylvain Paris. */
     void Camera::set_from_projection_matrix(const mat34 &proj) {
         // The 3 lines of the matrix are the normals to the planes x=0, y=0, z=0
-        // in the camera CS. As we normalize them, we do not need the 4th coordinate.
-        vec3 line_0 = proj.row(0);	line_0.normalize();
+        // in the camera CS. The 2nd one is used for the field of view. As we
+        // normalize it, we do not need the 4th coordinate.
         vec3 line_1 = proj.row(1);	line_1.normalize();
-        vec3 line_2 = proj.row(2);	line_2.normalize();
 
         // The camera position is at (0,0,0) in the camera CS so it is the
         // intersection of the 3 planes. It can be seen as the kernel
@@ -1136,19 +1136,24 @@ namespace easy3d {
         const vec3 cam_pos(X / T, Y / T, Z / T);
 #endif
 
-        // We compute the rotation matrix column by column.
+        // We compute the rotation matrix by the RQ decomposition of the left 3x3 block of the matrix. Its rows are
+        // the axes of the camera in the vision convention, i.e., exactly orthogonal even if the image is skewed.
+        float M[3][4], K[3][3], R[3][3], t[3];
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 4; ++j)
+                M[i][j] = proj(i, j);
+        }
+        if (!decompose_projection(M, K, R, t)) {
+            LOG(ERROR) << "degenerate projection matrix";
+            return;
+        }
 
+        // X-axis is the same in both conventions.
+        const vec3 column_0(R[0][0], R[0][1], R[0][2]);
+        // Y-axis: R[1] is downward oriented as the screen CS.
+        const vec3 column_1(-R[1][0], -R[1][1], -R[1][2]);
         // GL Z axis is front facing.
-        const vec3 column_2 = -line_2;
-
-        // X-axis is almost like line_0 but should be orthogonal to the Z axis.
-        vec3 column_0 = cross(cross(column_2, line_0), column_2);
-        column_0.normalize();
-
-        // Y-axis is almost like line_1 but should be orthogonal to the Z axis.
-        // Moreover line_1 is downward oriented as the screen CS.
-        vec3 column_1 = -cross(cross(column_2, line_1), column_2);
-        column_1.normalize();
+        const vec3 column_2(-R[2][0], -R[2][1], -R[2][2]);
 
         const mat3 rot(column_0, column_1, column_2);
 
@@ -250,7 +250,7 @@ int CMINPACK_EXPORT __cminpack_func__(lmdif)( __cminpack_decl_fcn_mn__
 	      __cminpack_real__ *diag, int mode, __cminpack_real__ factor, int nprint,
 	      int *nfev, __cminpack_real__ *fjac, int ldfjac, int *ipvt,
 	      __cminpack_real__ *qtf, __cminpack_real__ *wa1, __cminpack_real__ *wa2, __cminpack_real__ *wa3,
-	      __cminpack_real__ *wa4 );
+	      __cminpack_real__ *wa4, __cminpack_real__ *parout );
 
 /* minimize the sum of the squares of nonlinear functions in N
    variables by a modification of the Levenberg-Marquardt algorithm
@@ -62,7 +62,7 @@ int main()
 
   info = __cminpack_func__(lmdif)(fcn, &data, m, n, x, fvec, ftol, xtol, gtol, maxfev, epsfcn, 
 	 diag, mode, factor, nprint, &nfev, fjac, ldfjac, 
-	 ipvt, qtf, wa1, wa2, wa3, wa4);
+	 ipvt, qtf, wa1, wa2, wa3, wa4, NULL);
 
   fnorm = __cminpack_func__(enorm)(m, fvec);
 
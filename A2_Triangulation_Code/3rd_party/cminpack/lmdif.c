@@ -9,7 +9,7 @@ int __cminpack_func__(lmdif)(__cminpack_decl_fcn_mn__ void *p, int m, int n, rea
 	mode, real factor, int nprint, int *
 	nfev, real *fjac, int ldfjac, int *ipvt, real *
 	qtf, real *wa1, real *wa2, real *wa3, real *
-	wa4)
+	wa4, real *parout)
 {
     /* Initialized data */
 
@@ -136,7 +136,10 @@ int __cminpack_func__(lmdif)(__cminpack_decl_fcn_mn__ void *p, int m, int n, rea
 /*         iteration and every nprint iterations thereafter and */
 /*         immediately prior to return, with x and fvec available */
 /*         for printing. if nprint is not positive, no special calls */
-/*         of fcn with iflag = 0 are made. */
+/*         of fcn with iflag = 0 are made. the calls are made before */
+/*         the jacobian of the iteration is computed, so x is always */
+/*         the last accepted iterate (unlike the calls with iflag = 2, */
+/*         which perturb x in place). */
 
 /*       info is an integer output variable. if the user has */
 /*         terminated execution, info is set to the (negative) */
@@ -202,6 +205,10 @@ int __cminpack_func__(lmdif)(__cminpack_decl_fcn_mn__ void *p, int m, int n, rea
 
 /*       wa4 is a work array of length m. */
 
+/*       parout is an output variable. if it is not null, it is set to */
+/*         the levenberg-marquardt parameter of the last step (0 before */
+/*         the first one) before each call of fcn with iflag = 0. */
+
 /*     subprograms called */
 
 /*       user-supplied ...... fcn */
@@ -221,6 +228,7 @@ int __cminpack_func__(lmdif)(__cminpack_decl_fcn_mn__ void *p, int m, int n, rea
 
     info = 0;
     iflag = 0;
+    par = 0.;
     *nfev = 0;
 
 /*     check the input parameters for errors. */
@@ -256,20 +264,14 @@ int __cminpack_func__(lmdif)(__cminpack_decl_fcn_mn__ void *p, int m, int n, rea
 
     for (;;) {
 
-/*        calculate the jacobian matrix. */
-
-        iflag = __cminpack_func__(fdjac2)(__cminpack_param_fcn_mn__ p, m, n, x, fvec, fjac, ldfjac,
-                       epsfcn, wa4);
-        *nfev += n;
-        if (iflag < 0) {
-            goto TERMINATE;
-        }
-
 /*        if requested, call fcn to enable printing of iterates. */
 
         if (nprint > 0) {
             iflag = 0;
             if ((iter - 1) % nprint == 0) {
+                if (parout) {
+                    *parout = par;
+                }
                 iflag = fcn_mn(p, m, n, x, fvec, 0);
             }
             if (iflag < 0) {
@@ -277,6 +279,15 @@ int __cminpack_func__(lmdif)(__cminpack_decl_fcn_mn__ void *p, int m, int n, rea
             }
         }
 
+/*        calculate the jacobian matrix. */
+
+        iflag = __cminpack_func__(fdjac2)(__cminpack_param_fcn_mn__ p, m, n, x, fvec, fjac, ldfjac,
+                       epsfcn, wa4);
+        *nfev += n;
+        if (iflag < 0) {
+            goto TERMINATE;
+        }
+
 /*        compute the qr factorization of the jacobian. */
 
         __cminpack_func__(qrfac)(m, n, fjac, ldfjac, TRUE_, ipvt, n,
@@ -520,6 +531,9 @@ TERMINATE:
 	info = iflag;
     }
     if (nprint > 0) {
+        if (parout) {
+            *parout = par;
+        }
 	fcn_mn(p, m, n, x, fvec, 0);
     }
     return info;
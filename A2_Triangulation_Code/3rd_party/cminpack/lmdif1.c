@@ -1,4 +1,5 @@
 #include "cminpack.h"
+#include <stddef.h>
 #include "cminpackP.h"
 
 __cminpack_attr__
@@ -135,7 +136,7 @@ int __cminpack_func__(lmdif1)(__cminpack_decl_fcn_mn__ void *p, int m, int n, re
     info = __cminpack_func__(lmdif)(__cminpack_param_fcn_mn__ p, m, n, x, fvec, ftol, xtol, gtol, maxfev,
 	    epsfcn, wa, mode, factor, nprint, &nfev, &wa[mp5n],
             m, iwa, &wa[n], &wa[(n << 1)], &wa[n * 3], 
-	    &wa[(n << 2)], &wa[n * 5]);
+	    &wa[(n << 2)], &wa[n * 5], NULL);
     if (info == 8) {
 	info = 4;
     }
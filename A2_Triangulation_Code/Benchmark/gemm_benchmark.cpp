@@ -0,0 +1,139 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares the kernels computing the product of two matrices: the plain triple loop (which was the only one before),
+// the cache-blocked kernel on a single thread, and the automatic dispatch of mult_into() (which also uses all threads
+// for large products). The shapes include square matrices and the tall/wide products of the calibration and the
+// triangulation, e.g., P^T * P of the 2n by 12 calibration matrix and projecting n points by a 3 by 4 matrix.
+
+#include "matrix.h"
+
+#include <cmath>
+#include <random>
+#include <iomanip>
+#include <iostream>
+#include <functional>
+
+#include <easy3d/util/stop_watch.h>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    Matrix random_matrix(int rows, int cols, std::mt19937 &rng) {
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        Matrix m(rows, cols, 0.0);
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j)
+                m(i, j) = unit(rng);
+        }
+        return m;
+    }
+
+
+    // Runs the kernel repeatedly for at least 0.2 seconds and returns the average time of a run (in seconds).
+    double time_kernel(const std::function<void()> &kernel) {
+        kernel();   // warm up the caches (and create the threads once)
+        StopWatch w;
+        int runs = 0;
+        do {
+            kernel();
+            ++runs;
+        } while (w.elapsed_seconds(6) < 0.2);
+        return w.elapsed_seconds(9) / runs;
+    }
+
+
+    double max_difference(const Matrix &A, const Matrix &B) {
+        double diff = 0.0;
+        for (int i = 0; i < A.rows(); ++i) {
+            for (int j = 0; j < A.cols(); ++j)
+                diff = std::max(diff, std::fabs(A(i, j) - B(i, j)));
+        }
+        return diff;
+    }
+
+}
+
+
+int main() {
+    struct Shape {
+        int M, K, N;
+    };
+    const Shape shapes[] = {
+            {4,    4,     4},
+            {16,   16,    16},
+            {32,   32,    32},
+            {64,   64,    64},
+            {128,  128,   128},
+            {256,  256,   256},
+            {512,  512,   512},
+            {1024, 1024,  1024},
+            {12,   2000,  12},      // P^T * P of the calibration with 1000 points
+            {12,   20000, 12},      // ... with 10000 points
+            {2000, 12,    12},      // P * V
+            {3,    4,     100000},  // projecting 100000 points by a 3 by 4 matrix
+            {9,    10000, 9}        // W^T * W of the 8-point algorithm with 10000 points
+    };
+
+    std::cout << "threads used for large products: " << details::gemm_num_threads()
+              << (details::gemm_has_avx2() ? " (AVX2/FMA)" : "") << std::endl;
+    std::cout << std::setw(20) << "M x K x N"
+              << std::setw(14) << "naive(ms)"
+              << std::setw(14) << "blocked(ms)"
+              << std::setw(14) << "dispatch(ms)"
+              << std::setw(12) << "GFLOPS"
+              << std::setw(10) << "speedup"
+              << std::setw(12) << "max diff" << std::endl;
+
+    std::mt19937 rng(0);
+    for (const auto &s : shapes) {
+        const Matrix A = random_matrix(s.M, s.K, rng);
+        const Matrix B = random_matrix(s.K, s.N, rng);
+        Matrix C_naive(s.M, s.N), C_blocked(s.M, s.N), C;
+
+        const double t_naive = time_kernel([&]() {
+            details::gemm_naive(A.data(), B.data(), C_naive.data(), s.M, s.N, s.K);
+        });
+        const double t_blocked = time_kernel([&]() {
+            details::gemm_blocked(A.data(), B.data(), C_blocked.data(), s.M, s.N, s.K, 1);
+        });
+        const double t_dispatch = time_kernel([&]() { mult_into(A, B, C); });
+
+        const double flops = 2.0 * s.M * s.N * s.K;
+        const std::string name = std::to_string(s.M) + " x " + std::to_string(s.K) + " x " + std::to_string(s.N);
+        std::cout << std::setw(20) << name
+                  << std::setw(14) << t_naive * 1e3
+                  << std::setw(14) << t_blocked * 1e3
+                  << std::setw(14) << t_dispatch * 1e3
+                  << std::setw(12) << flops / t_dispatch * 1e-9
+                  << std::setw(10) << t_naive / t_dispatch
+                  << std::setw(12) << std::max(max_difference(C_naive, C_blocked), max_difference(C_naive, C))
+                  << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
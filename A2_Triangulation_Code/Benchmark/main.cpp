@@ -0,0 +1,249 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synthetic_scene.h"
+#include "triangulation.h"
+#ifdef BENCHMARK_CALIBRATION
+#include "calibration.h"
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+
+#include <easy3d/util/stop_watch.h>
+#include <easy3d/util/file_system.h>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    struct BenchmarkOptions {
+        BenchmarkOptions()
+                : min_points(10), max_points(1000000), max_calibration_points(1000),
+                  max_triangulation_points(100000) {}
+
+        SceneOptions scene;
+        std::size_t min_points;
+        std::size_t max_points;
+        // The calibration and the triangulation solve dense systems whose size grows with the number of points
+        // (e.g., the n by 9 system of the fundamental matrix). Larger problems are skipped instead of running out of
+        // memory or time, but the limits can be raised to find out where they break down.
+        std::size_t max_calibration_points;
+        std::size_t max_triangulation_points;
+        std::string save_dir;
+    };
+
+
+    void print_usage(const char *program) {
+        std::cerr << "Usage: " << file_system::simple_name(program) << " [options]\n"
+                  << "\t--min-points N       the smallest problem size (default: 10)\n"
+                  << "\t--max-points N       the largest problem size, up to 10000000 (default: 1000000)\n"
+                  << "\t--noise S            Gaussian noise on the image points in pixels (default: 0.5)\n"
+                  << "\t--outliers R         fraction of outliers in the image points (default: 0)\n"
+                  << "\t--layout L           camera layout: stereo, orbit, or forward (default: stereo)\n"
+                  << "\t--cameras N          number of cameras in the scene (default: 2)\n"
+                  << "\t--seed N             seed of the random generator (default: 0)\n"
+                  << "\t--max-calibration N  skip calibration above N points (default: 1000)\n"
+                  << "\t--max-triangulation N skip triangulation above N points (default: 100000)\n"
+                  << "\t--save DIR           also save the generated scenes into DIR" << std::endl;
+    }
+
+
+    bool parse_options(int argc, char **argv, BenchmarkOptions &options) {
+        options.scene.noise = 0.5;
+        for (int i = 1; i < argc; ++i) {
+            const std::string key = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            const std::string value = argv[++i];
+            if (key == "--min-points")
+                options.min_points = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "--max-points")
+                options.max_points = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "--noise")
+                options.scene.noise = std::atof(value.c_str());
+            else if (key == "--outliers")
+                options.scene.outlier_ratio = std::atof(value.c_str());
+            else if (key == "--layout") {
+                if (!layout_from_string(value, options.scene.layout))
+                    return false;
+            }
+            else if (key == "--cameras")
+                options.scene.num_cameras = std::atoi(value.c_str());
+            else if (key == "--seed")
+                options.scene.seed = static_cast<unsigned int>(std::strtoul(value.c_str(), nullptr, 10));
+            else if (key == "--max-calibration")
+                options.max_calibration_points = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "--max-triangulation")
+                options.max_triangulation_points = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "--save")
+                options.save_dir = value;
+            else
+                return false;
+        }
+        return options.min_points > 0 && options.min_points <= options.max_points;
+    }
+
+
+    // The angle (in degrees) of the rotation that aligns R1 with R2.
+    double rotation_error(const Matrix33 &R1, const Matrix33 &R2) {
+        const double c = (trace(R1 * transpose(R2)) - 1.0) * 0.5;
+        return std::acos(std::max(-1.0, std::min(1.0, c))) * 180.0 / M_PI;
+    }
+
+
+    // The angle (in degrees) between two directions.
+    double angle_error(const Vector3D &v1, const Vector3D &v2) {
+        const double c = dot(v1, v2) / (length(v1) * length(v2));
+        return std::acos(std::max(-1.0, std::min(1.0, c))) * 180.0 / M_PI;
+    }
+
+
+    // The triangulation reports its intermediate steps (for every point) to std::cout, which would dominate the
+    // timings. So we mute it while it is running (the calibration is called quiet instead).
+    class MuteCout {
+    public:
+        MuteCout() : buf_(std::cout.rdbuf(muted_.rdbuf())) {}
+        ~MuteCout() { std::cout.rdbuf(buf_); }
+    private:
+        std::stringstream muted_;
+        std::streambuf *buf_;
+    };
+
+}
+
+
+int main(int argc, char **argv) {
+    BenchmarkOptions options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (!options.save_dir.empty() && !file_system::is_directory(options.save_dir)) {
+        if (!file_system::create_directory(options.save_dir)) {
+            std::cerr << "could not create directory: " << options.save_dir << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::setw(10) << "points"
+              << std::setw(12) << "generate(s)"
+#ifdef BENCHMARK_CALIBRATION
+              << std::setw(12) << "calib(s)"
+              << std::setw(12) << "fx err(%)"
+              << std::setw(12) << "R err(deg)"
+#endif
+              << std::setw(12) << "triang(s)"
+              << std::setw(12) << "R err(deg)"
+              << std::setw(12) << "t err(deg)"
+              << std::setw(10) << "#3D" << std::endl;
+
+    bool all_succeeded = true;
+    for (std::size_t n = options.min_points; n <= options.max_points; n *= 10) {
+        SceneOptions scene_options = options.scene;
+        scene_options.num_points = n;
+
+        StopWatch w;
+        SyntheticScene scene;
+        if (!generate_scene(scene_options, scene))
+            return EXIT_FAILURE;
+        std::cout << std::setw(10) << n << std::setw(12) << w.elapsed_seconds(3) << std::flush;
+
+        if (!options.save_dir.empty()) {
+            const std::string prefix = options.save_dir + "/scene_" + std::to_string(n);
+            for (std::size_t c = 0; c < scene.cameras.size(); ++c) {
+                const SyntheticCamera &camera = scene.cameras[c];
+                save_correspondences(prefix + "_correspondences_" + std::to_string(c) + ".txt", scene.points_3d, camera.image_points);
+                save_image_points(prefix + "_image_points_" + std::to_string(c) + ".xyz", camera.image_points);
+            }
+        }
+
+        const SyntheticCamera &camera_0 = scene.cameras[0];
+        const SyntheticCamera &camera_1 = scene.cameras[1];
+
+#ifdef BENCHMARK_CALIBRATION
+        // calibrate the second camera (the first one is at the origin of the world)
+        if (n >= 6 && n <= options.max_calibration_points) {
+            double fx, fy, cx, cy, skew;
+            Matrix33 R;
+            Vector3D t;
+            bool success;
+            w.restart();
+            success = Calibration::calibration(scene.points_3d, camera_1.image_points, fx, fy, cx, cy, skew, R, t,
+                                               false);
+            const double time = w.elapsed_seconds(3);
+            if (success) {
+                std::cout << std::setw(12) << time
+                          << std::setw(12) << std::fabs(fx - scene_options.fx) / scene_options.fx * 100.0
+                          << std::setw(12) << rotation_error(R, camera_1.R);
+            }
+            else {
+                std::cout << std::setw(36) << "failed";
+                all_succeeded = false;
+            }
+        }
+        else
+            std::cout << std::setw(36) << "skipped";
+        std::cout << std::flush;
+#endif
+
+        if (n >= 8 && n <= options.max_triangulation_points) {
+            std::vector<Vector3D> points_3d;
+            Matrix33 R;
+            Vector3D t;
+            bool success;
+            w.restart();
+            {
+                MuteCout mute;
+                success = Triangulation::triangulation(scene_options.fx, scene_options.fy,
+                                                       scene_options.cx, scene_options.cy, scene_options.skew,
+                                                       camera_0.image_points, camera_1.image_points, points_3d, R, t);
+            }
+            const double time = w.elapsed_seconds(3);
+            if (success) {
+                std::cout << std::setw(12) << time
+                          << std::setw(12) << rotation_error(R, camera_1.R)
+                          << std::setw(12) << angle_error(t, camera_1.t)
+                          << std::setw(10) << points_3d.size();
+            }
+            else {
+                std::cout << std::setw(46) << "failed";
+                all_succeeded = false;
+            }
+        }
+        else
+            std::cout << std::setw(46) << "skipped";
+        std::cout << std::endl;
+
+        if (n > options.max_points / 10)    // avoid overflow
+            break;
+    }
+
+    return all_succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
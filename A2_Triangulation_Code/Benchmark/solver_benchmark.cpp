@@ -0,0 +1,310 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares the nonlinear least squares solvers (lmdif() behind Optimizer_LM, and the Levenberg-Marquardt, dogleg, and
+// Gauss-Newton strategies of Optimizer_NLS with either linear solver) on the two refinements of the assignments:
+//  - triangulation: each point is refined by its reprojection error in a pair of cameras (3 variables, 4 functions),
+//    starting from the true point moved by a few percent of its depth;
+//  - calibration: the intrinsic and extrinsic parameters of a camera are refined by the reprojection error of all
+//    the points (11 variables, 2 functions per point), starting from a perturbed camera.
+// The image points have Gaussian noise, so the problems have small but nonzero residuals.
+
+#include "synthetic_scene.h"
+
+#include <cmath>
+#include <random>
+#include <iomanip>
+#include <iostream>
+
+#include <easy3d/optimizer/optimizer_lm.h>
+#include <easy3d/optimizer/optimizer_nls.h>
+#include <easy3d/util/stop_watch.h>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    // the reprojection error of a point in two cameras, i.e., the objective of the refinement of the triangulation
+    class PointObjective : public Objective_LM {
+    public:
+        PointObjective(const double *M0, const double *M1, const Vector2D &p0, const Vector2D &p1)
+                : Objective_LM(4, 3), M0_(M0), M1_(M1), p0_(p0), p1_(p1) {}
+
+        int evaluate(const double *x, double *fvec) {
+            project(M0_, x, p0_, fvec);
+            project(M1_, x, p1_, fvec + 2);
+            return 0;
+        }
+
+    private:
+        static void project(const double *M, const double *x, const Vector2D &p, double *f) {
+            const double u = M[0] * x[0] + M[1] * x[1] + M[2] * x[2] + M[3];
+            const double v = M[4] * x[0] + M[5] * x[1] + M[6] * x[2] + M[7];
+            const double w = M[8] * x[0] + M[9] * x[1] + M[10] * x[2] + M[11];
+            f[0] = u / w - p[0];
+            f[1] = v / w - p[1];
+        }
+
+    private:
+        const double *M0_;
+        const double *M1_;
+        Vector2D p0_, p1_;
+    };
+
+
+    // the rotation R = exp([w]_x) * R0 (i.e., the update w is a rotation vector)
+    void rotation(const double *w, const Matrix33 &R0, double R[9]) {
+        const double theta = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+        double E[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+        if (theta > 0.0) {
+            const double k[3] = {w[0] / theta, w[1] / theta, w[2] / theta};
+            const double s = std::sin(theta), c = 1.0 - std::cos(theta);
+            const double K[9] = {0, -k[2], k[1], k[2], 0, -k[0], -k[1], k[0], 0};
+            for (int i = 0; i < 3; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    double KK = 0.0;
+                    for (int l = 0; l < 3; ++l)
+                        KK += K[i * 3 + l] * K[l * 3 + j];
+                    E[i * 3 + j] += s * K[i * 3 + j] + c * KK;
+                }
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j)
+                R[i * 3 + j] = E[i * 3] * R0(0, j) + E[i * 3 + 1] * R0(1, j) + E[i * 3 + 2] * R0(2, j);
+        }
+    }
+
+
+    // The reprojection error of all points in a camera, with the variables (fx, fy, cx, cy, skew, w, t), i.e., the
+    // objective of the refinement of the calibration. The rotation is an update w of a reference rotation R0.
+    class CameraObjective : public Objective_LM {
+    public:
+        CameraObjective(const std::vector<Vector3D> &points_3d, const std::vector<Vector2D> &image_points,
+                        const Matrix33 &R0)
+                : Objective_LM(static_cast<int>(image_points.size() * 2), 11), points_3d_(points_3d),
+                  image_points_(image_points), R0_(R0) {}
+
+        int evaluate(const double *x, double *fvec) {
+            double R[9];
+            rotation(x + 5, R0_, R);
+            for (std::size_t i = 0; i < points_3d_.size(); ++i) {
+                const Vector3D &P = points_3d_[i];
+                const double X = R[0] * P[0] + R[1] * P[1] + R[2] * P[2] + x[8];
+                const double Y = R[3] * P[0] + R[4] * P[1] + R[5] * P[2] + x[9];
+                const double Z = R[6] * P[0] + R[7] * P[1] + R[8] * P[2] + x[10];
+                fvec[2 * i] = (x[0] * X + x[4] * Y) / Z + x[2] - image_points_[i][0];
+                fvec[2 * i + 1] = x[1] * Y / Z + x[3] - image_points_[i][1];
+            }
+            return 0;
+        }
+
+    private:
+        const std::vector<Vector3D> &points_3d_;
+        const std::vector<Vector2D> &image_points_;
+        Matrix33 R0_;
+    };
+
+
+    struct Solver {
+        const char *name;
+        bool use_lmdif;
+        Optimizer_NLS::Options options;
+    };
+
+
+    std::vector<Solver> solvers() {
+        std::vector<Solver> list;
+        Solver lmdif;
+        lmdif.name = "lmdif";
+        lmdif.use_lmdif = true;
+        list.push_back(lmdif);
+
+        const Optimizer_NLS::Strategy strategies[] = {
+                Optimizer_NLS::STRATEGY_LEVENBERG_MARQUARDT, Optimizer_NLS::STRATEGY_DOGLEG,
+                Optimizer_NLS::STRATEGY_GAUSS_NEWTON
+        };
+        const Optimizer_NLS::LinearSolver linear_solvers[] = {
+                Optimizer_NLS::LINEAR_DENSE_CHOLESKY, Optimizer_NLS::LINEAR_DENSE_QR
+        };
+        for (auto strategy : strategies) {
+            for (auto linear_solver : linear_solvers) {
+                Solver s;
+                s.name = nullptr;
+                s.use_lmdif = false;
+                s.options.strategy = strategy;
+                s.options.linear_solver = linear_solver;
+                list.push_back(s);
+            }
+        }
+        return list;
+    }
+
+
+    // the totals of a solver over all problems of an objective
+    struct Statistics {
+        Statistics() : iterations(0), linear_solves(0), evaluations(0), converged(0), cost(0.0), seconds(0.0) {}
+
+        long iterations;
+        long linear_solves;
+        long evaluations;
+        long converged;
+        double cost;
+        double seconds;
+    };
+
+
+    Statistics run(const Solver &solver, std::vector<Objective_LM *> &problems, const std::vector<double> &initial) {
+        const int n = problems[0]->num_variables();
+        std::vector<double> x(initial);
+        Statistics stats;
+        StopWatch w;
+        for (std::size_t k = 0; k < problems.size(); ++k) {
+            double *xk = x.data() + k * n;
+            if (solver.use_lmdif) {
+                Optimizer_LM lm;
+                Optimizer_LM::Parameters param;
+                stats.converged += lm.optimize(problems[k], xk, &param);
+                stats.evaluations += param.nfev;
+                stats.cost += param.fnorm * param.fnorm;
+            } else {
+                Optimizer_NLS nls;
+                Optimizer_NLS::Summary summary;
+                stats.converged += nls.optimize(problems[k], xk, solver.options, &summary);
+                stats.iterations += summary.iterations;
+                stats.linear_solves += summary.linear_solves;
+                stats.evaluations += summary.evaluations;
+                stats.cost += summary.final_cost;
+            }
+        }
+        stats.seconds = w.elapsed_seconds(6);
+        return stats;
+    }
+
+
+    void report(const std::string &objective, std::vector<Objective_LM *> &problems,
+                const std::vector<double> &initial) {
+        std::cout << objective << ": " << problems.size() << " problem(s) with " << problems[0]->num_variables()
+                  << " variables and " << problems[0]->num_function() << " functions" << std::endl;
+        std::cout << std::setw(28) << "solver"
+                  << std::setw(12) << "converged"
+                  << std::setw(12) << "iterations"
+                  << std::setw(14) << "linear solves"
+                  << std::setw(14) << "evaluations"
+                  << std::setw(12) << "time(ms)"
+                  << std::setw(16) << "final cost" << std::endl;
+        for (const auto &solver : solvers()) {
+            const Statistics stats = run(solver, problems, initial);
+            std::string name = solver.use_lmdif ? solver.name :
+                               std::string(Optimizer_NLS::name(solver.options.strategy)) + "/" +
+                               Optimizer_NLS::name(solver.options.linear_solver);
+            // lmdif() doesn't report its iterations and linear solves
+            std::cout << std::setw(28) << name
+                      << std::setw(12) << stats.converged
+                      << std::setw(12) << (solver.use_lmdif ? std::string("-") : std::to_string(stats.iterations))
+                      << std::setw(14) << (solver.use_lmdif ? std::string("-") : std::to_string(stats.linear_solves))
+                      << std::setw(14) << stats.evaluations
+                      << std::setw(12) << stats.seconds * 1e3
+                      << std::setw(16) << stats.cost << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+}
+
+
+int main() {
+    SceneOptions options;
+    options.num_points = 2000;
+    options.noise = 0.5;
+    SyntheticScene scene;
+    if (!generate_scene(options, scene)) {
+        std::cerr << "failed to generate the scene" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::vector<Vector3D> &points = scene.points_3d;
+    std::mt19937 rng(1);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+
+    // the triangulation: the projection matrices M = K [R t] of the two cameras, stored row by row
+    double M[2][12];
+    for (int c = 0; c < 2; ++c) {
+        const SyntheticCamera &camera = scene.cameras[c];
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                double sum = 0.0;
+                for (int k = 0; k < 3; ++k)
+                    sum += scene.K(i, k) * (j < 3 ? camera.R(k, j) : camera.t[k]);
+                M[c][i * 4 + j] = sum;
+            }
+        }
+    }
+    std::vector<PointObjective> point_objectives;
+    point_objectives.reserve(points.size());
+    std::vector<Objective_LM *> point_problems;
+    std::vector<double> point_initial;
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        point_objectives.emplace_back(M[0], M[1], scene.cameras[0].image_points[i], scene.cameras[1].image_points[i]);
+        point_problems.push_back(&point_objectives.back());
+        const double offset = 0.02 * points[i].z();
+        for (int k = 0; k < 3; ++k)
+            point_initial.push_back(points[i][k] + offset * gaussian(rng));
+    }
+    report("triangulation", point_problems, point_initial);
+
+    // the calibration: several cameras, each from 100 of the points
+    const int num_cameras = 20;
+    const std::size_t points_per_camera = 100;
+    std::vector<std::vector<Vector3D> > camera_points(num_cameras);
+    std::vector<std::vector<Vector2D> > camera_image_points(num_cameras);
+    std::vector<CameraObjective> camera_objectives;
+    camera_objectives.reserve(num_cameras);
+    std::vector<Objective_LM *> camera_problems;
+    std::vector<double> camera_initial;
+    for (int c = 0; c < num_cameras; ++c) {
+        const std::size_t begin = (c * points_per_camera) % (points.size() - points_per_camera);
+        camera_points[c].assign(points.begin() + begin, points.begin() + begin + points_per_camera);
+        camera_image_points[c].assign(scene.cameras[1].image_points.begin() + begin,
+                                      scene.cameras[1].image_points.begin() + begin + points_per_camera);
+        camera_objectives.emplace_back(camera_points[c], camera_image_points[c], scene.cameras[1].R);
+        camera_problems.push_back(&camera_objectives.back());
+
+        // about 5% off in the intrinsic parameters, 1 degree in the rotation, and 5% in the translation
+        const Vector3D &t = scene.cameras[1].t;
+        const double tnorm = t.norm();
+        const double guess[11] = {
+                scene.K(0, 0) * (1.0 + 0.05 * gaussian(rng)), scene.K(1, 1) * (1.0 + 0.05 * gaussian(rng)),
+                scene.K(0, 2) + 20.0 * gaussian(rng), scene.K(1, 2) + 20.0 * gaussian(rng), scene.K(0, 1),
+                0.017 * gaussian(rng), 0.017 * gaussian(rng), 0.017 * gaussian(rng),
+                t[0] + 0.05 * tnorm * gaussian(rng), t[1] + 0.05 * tnorm * gaussian(rng),
+                t[2] + 0.05 * tnorm * gaussian(rng)
+        };
+        camera_initial.insert(camera_initial.end(), guess, guess + 11);
+    }
+    report("calibration", camera_problems, camera_initial);
+
+    return EXIT_SUCCESS;
+}
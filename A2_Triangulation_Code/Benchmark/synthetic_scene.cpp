@@ -0,0 +1,206 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "synthetic_scene.h"
+
+#include <cmath>
+#include <random>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    // the points are sampled in a box centered at (0, 0, 5) in front of the first camera
+    const double kSceneCenter[3] = {0.0, 0.0, 5.0};
+    const double kSceneHalfSize[3] = {1.5, 1.0, 1.0};
+
+
+    // A camera at 'center' looking at 'target', with the y axis pointing downwards (as the image rows).
+    void look_at(const Vector3D &center, const Vector3D &target, Matrix33 &R, Vector3D &t) {
+        const Vector3D z = normalize(target - center);
+        const Vector3D x = normalize(cross(Vector3D(0, 1, 0), z));
+        const Vector3D y = cross(z, x);
+        R.set_row(0, x);
+        R.set_row(1, y);
+        R.set_row(2, z);
+        t = -(R * center);
+    }
+
+
+    void place_camera(const SceneOptions &options, int index, Matrix33 &R, Vector3D &t) {
+        const Vector3D target(kSceneCenter[0], kSceneCenter[1], kSceneCenter[2]);
+        if (index == 0) {   // the reference camera
+            R.load_identity();
+            t = Vector3D(0, 0, 0);
+            return;
+        }
+
+        switch (options.layout) {
+            case LAYOUT_STEREO: {
+                const double baseline = 1.0;
+                look_at(Vector3D(baseline * index, 0, 0), target, R, t);
+                break;
+            }
+            case LAYOUT_ORBIT: {
+                // the first camera is also on the circle, at angle 0
+                const double radius = kSceneCenter[2];
+                const double angle = 2.0 * M_PI * index / options.num_cameras;
+                const Vector3D center(radius * std::sin(angle), 0, kSceneCenter[2] - radius * std::cos(angle));
+                look_at(center, target, R, t);
+                break;
+            }
+            case LAYOUT_FORWARD: {
+                // all cameras must stay in front of the nearest points of the scene
+                const double step = std::min(0.5, 2.0 / options.num_cameras);
+                R.load_identity();
+                t = Vector3D(0, 0, -step * index);
+                break;
+            }
+        }
+    }
+
+}
+
+
+bool generate_scene(const SceneOptions &options, SyntheticScene &scene) {
+    if (options.num_cameras < 2) {
+        std::cerr << "a synthetic scene needs at least 2 cameras" << std::endl;
+        return false;
+    }
+    if (options.outlier_ratio < 0.0 || options.outlier_ratio > 1.0) {
+        std::cerr << "the outlier ratio must be in [0, 1]" << std::endl;
+        return false;
+    }
+    if (options.noise < 0.0) {
+        std::cerr << "the noise level must not be negative" << std::endl;
+        return false;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::normal_distribution<double> gaussian(0.0, options.noise > 0.0 ? options.noise : 1.0);
+    std::uniform_real_distribution<double> image_u(0.0, 2.0 * options.cx);
+    std::uniform_real_distribution<double> image_v(0.0, 2.0 * options.cy);
+
+    scene.K = Matrix33(options.fx, options.skew, options.cx,
+                       0, options.fy, options.cy,
+                       0, 0, 1);
+
+    const std::size_t n = options.num_points;
+    scene.points_3d.clear();
+    scene.points_3d.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const double x = kSceneCenter[0] + kSceneHalfSize[0] * unit(rng);
+        const double y = kSceneCenter[1] + kSceneHalfSize[1] * unit(rng);
+        const double z = kSceneCenter[2] + kSceneHalfSize[2] * unit(rng);
+        scene.points_3d.emplace_back(Vector3D(x, y, z));
+    }
+
+    scene.cameras.resize(options.num_cameras);
+    for (int c = 0; c < options.num_cameras; ++c) {
+        SyntheticCamera &camera = scene.cameras[c];
+        place_camera(options, c, camera.R, camera.t);
+
+        // K * (R * P + t), expanded so that projecting millions of points doesn't create temporary vectors
+        const Matrix KR = scene.K * camera.R;
+        const Vector3D Kt = scene.K * camera.t;
+        double M[3][4];
+        for (int r = 0; r < 3; ++r) {
+            for (int j = 0; j < 3; ++j)
+                M[r][j] = KR(r, j);
+            M[r][3] = Kt[r];
+        }
+
+        camera.image_points.clear();
+        camera.image_points.reserve(n);
+        camera.is_outlier.assign(n, false);
+        for (std::size_t i = 0; i < n; ++i) {
+            const Vector3D &P = scene.points_3d[i];
+            const double X = P[0], Y = P[1], Z = P[2];
+            const double w = M[2][0] * X + M[2][1] * Y + M[2][2] * Z + M[2][3];
+            double u = (M[0][0] * X + M[0][1] * Y + M[0][2] * Z + M[0][3]) / w;
+            double v = (M[1][0] * X + M[1][1] * Y + M[1][2] * Z + M[1][3]) / w;
+
+            if (options.outlier_ratio > 0.0 && coin(rng) < options.outlier_ratio) {
+                u = image_u(rng);
+                v = image_v(rng);
+                camera.is_outlier[i] = true;
+            } else if (options.noise > 0.0) {
+                u += gaussian(rng);
+                v += gaussian(rng);
+            }
+            camera.image_points.emplace_back(Vector2D(u, v));
+        }
+    }
+
+    return true;
+}
+
+
+bool save_correspondences(const std::string &file_name, const std::vector<Vector3D> &points_3d,
+                          const std::vector<Vector2D> &image_points) {
+    std::ofstream output(file_name.c_str());
+    if (output.fail()) {
+        std::cerr << "could not open file: " << file_name << std::endl;
+        return false;
+    }
+    output << std::setprecision(10);
+    for (std::size_t i = 0; i < points_3d.size(); ++i) {
+        output << points_3d[i][0] << " " << points_3d[i][1] << " " << points_3d[i][2] << " "
+               << image_points[i][0] << " " << image_points[i][1] << "\n";
+    }
+    return true;
+}
+
+
+bool save_image_points(const std::string &file_name, const std::vector<Vector2D> &image_points) {
+    std::ofstream output(file_name.c_str());
+    if (output.fail()) {
+        std::cerr << "could not open file: " << file_name << std::endl;
+        return false;
+    }
+    output << std::setprecision(10);
+    for (const auto &p : image_points)
+        output << p[0] << " " << p[1] << " 1\n";
+    return true;
+}
+
+
+bool layout_from_string(const std::string &name, CameraLayout &layout) {
+    if (name == "stereo")
+        layout = LAYOUT_STEREO;
+    else if (name == "orbit")
+        layout = LAYOUT_ORBIT;
+    else if (name == "forward")
+        layout = LAYOUT_FORWARD;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTHETIC_SCENE_H
+#define SYNTHETIC_SCENE_H
+
+#include <string>
+#include <vector>
+
+#include "matrix.h"
+#include "vector.h"
+
+
+/// How the cameras are placed around the scene. The first camera is always at the world origin (i.e., R = I and
+/// t = 0), which is the convention of the triangulation.
+enum CameraLayout {
+    LAYOUT_STEREO,  ///< a convergent pair with a sideways baseline, extra cameras continue along the baseline
+    LAYOUT_ORBIT,   ///< cameras on a circle around the scene, all looking at its center
+    LAYOUT_FORWARD  ///< cameras moving forward towards the scene, i.e., a short baseline along the viewing direction
+};
+
+
+/// The parameters of a synthetic scene. All randomness is drawn from a generator seeded with 'seed', so the same
+/// options always produce the same scene.
+struct SceneOptions {
+    SceneOptions()
+            : num_points(100), num_cameras(2), layout(LAYOUT_STEREO), noise(0.0), outlier_ratio(0.0), seed(0),
+              fx(1000.0), fy(1000.0), cx(960.0), cy(540.0), skew(0.0) {}
+
+    std::size_t num_points;
+    int num_cameras;        ///< at least 2
+    CameraLayout layout;
+    double noise;           ///< standard deviation of the Gaussian noise added to the image points (in pixels)
+    double outlier_ratio;   ///< fraction of the image points replaced by random points in the image, in [0, 1]
+    unsigned int seed;
+
+    // the intrinsic parameters shared by all cameras
+    double fx, fy, cx, cy, skew;
+};
+
+
+/// A camera of a synthetic scene and the projections of all the scene points, i.e., p = K * (R * P + t).
+struct SyntheticCamera {
+    easy3d::Matrix33 R;
+    easy3d::Vector3D t;
+    std::vector<easy3d::Vector2D> image_points;
+    std::vector<bool> is_outlier;
+};
+
+
+struct SyntheticScene {
+    easy3d::Matrix33 K;
+    std::vector<easy3d::Vector3D> points_3d;
+    std::vector<SyntheticCamera> cameras;
+};
+
+
+/// Generates a synthetic scene. The points are uniformly distributed in a box in front of the first camera, so they
+/// are not coplanar and can be used for calibration as well.
+/// @return false if the options are invalid.
+bool generate_scene(const SceneOptions &options, SyntheticScene &scene);
+
+
+/// Saves the 3D-2D correspondences of a camera in the format of the calibration, i.e., "X Y Z u v" per line.
+bool save_correspondences(const std::string &file_name, const std::vector<easy3d::Vector3D> &points_3d,
+                          const std::vector<easy3d::Vector2D> &image_points);
+
+
+/// Saves the image points of a camera in the format of the triangulation, i.e., "u v 1" per line.
+bool save_image_points(const std::string &file_name, const std::vector<easy3d::Vector2D> &image_points);
+
+
+/// Parses the name of a layout ("stereo", "orbit", or "forward").
+bool layout_from_string(const std::string &name, CameraLayout &layout);
+
+#endif // SYNTHETIC_SCENE_H
@@ -0,0 +1,163 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Regression tests of saving and loading kd-trees: a loaded tree (queried directly in the mapped file) must answer
+// every query exactly like the tree it was saved from, and invalid or stale index files must be rejected.
+
+#include "test_utils.h"
+
+#include <easy3d/core/kdtree.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    const char *kIndexFile = "test_kdtree_index.bin";
+    const char *kOtherFile = "test_kdtree_other.bin";
+
+
+    template <typename FT>
+    std::vector< Vec<3, FT> > random_points(std::size_t num, unsigned int seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        std::vector< Vec<3, FT> > points(num);
+        for (auto &p : points)
+            p = Vec<3, FT>(FT(uniform(rng)), FT(uniform(rng)), FT(uniform(rng)));
+        return points;
+    }
+
+
+    std::string read_file(const char *file_name) {
+        std::ifstream input(file_name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+
+    template <typename FT>
+    bool same_answers(const BasicKdTree<FT> &a, const BasicKdTree<FT> &b, const std::vector< Vec<3, FT> > &queries) {
+        NeighborsT<FT> knn_a, knn_b, radius_a, radius_b;
+        a.find_closest_K_points(queries.data(), queries.size(), 8, knn_a, 1);
+        b.find_closest_K_points(queries.data(), queries.size(), 8, knn_b, 1);
+        a.find_points_in_radius(queries.data(), queries.size(), FT(0.01), radius_a, 1);
+        b.find_points_in_radius(queries.data(), queries.size(), FT(0.01), radius_b, 1);
+        if (knn_a.indices != knn_b.indices || knn_a.squared_distances != knn_b.squared_distances ||
+            radius_a.offsets != radius_b.offsets || radius_a.indices != radius_b.indices)
+            return false;
+
+        for (std::size_t i = 0; i < queries.size(); i += 97) {
+            FT dist_a = 0, dist_b = 0;
+            if (a.find_closest_point(queries[i], dist_a) != b.find_closest_point(queries[i], dist_b) || dist_a != dist_b)
+                return false;
+            std::vector<int> neighbors_a, neighbors_b;
+            a.find_points_in_radius(queries[i], FT(0.02), neighbors_a);
+            b.find_points_in_radius(queries[i], FT(0.02), neighbors_b);
+            if (neighbors_a != neighbors_b)
+                return false;
+        }
+        return true;
+    }
+
+
+    template <typename FT>
+    void test_round_trip(std::size_t num, int leaf_size) {
+        const std::vector< Vec<3, FT> > points = random_points<FT>(num, 1);
+        const std::vector< Vec<3, FT> > queries = random_points<FT>(2000, 2);
+
+        BasicKdTree<FT> built;
+        built.set_leaf_size(leaf_size);
+        built.build(points.data(), points.size());
+        EXPECT(built.save(kIndexFile));
+
+        for (int verify = 0; verify < 2; ++verify) {
+            BasicKdTree<FT> loaded;
+            EXPECT(loaded.load(kIndexFile, points.data(), points.size(), verify != 0));
+            EXPECT(loaded.num_points() == num);
+            EXPECT(loaded.leaf_size() == leaf_size);
+            std::vector<int> order_built, order_loaded;
+            built.leaf_order(order_built);
+            loaded.leaf_order(order_loaded);
+            EXPECT(order_built == order_loaded);
+            if (num > 0)
+                EXPECT(same_answers(built, loaded, queries));
+
+            // a loaded tree saves the same file
+            EXPECT(loaded.save(kOtherFile));
+            EXPECT(read_file(kIndexFile) == read_file(kOtherFile));
+        }
+    }
+
+
+    void test_invalid_files() {
+        const std::vector<vec3> points = random_points<float>(1000, 3);
+        KdTree tree;
+        tree.build(points.data(), points.size());
+        EXPECT(tree.save(kIndexFile));
+        const std::string data = read_file(kIndexFile);
+
+        KdTree loaded;
+        EXPECT(!loaded.load("no_such_kdtree_index.bin", points.data(), points.size()));
+        EXPECT(!dKdTree().load(kIndexFile, nullptr, points.size()));                    // another precision
+        EXPECT(!loaded.load(kIndexFile, points.data(), points.size() - 1));             // another number of points
+
+        std::ofstream(kOtherFile, std::ios::binary).write(data.data(), data.size() - 8);
+        EXPECT(!loaded.load(kOtherFile, points.data(), points.size()));                 // truncated
+
+        // an index of other points (of the same number) is stale, with or without the verification
+        EXPECT(loaded.load(kIndexFile, points.data(), points.size()));
+        std::vector<vec3> moved = points;
+        moved[500].y += 0.001f;
+        EXPECT(!loaded.load(kIndexFile, moved.data(), moved.size()));
+        EXPECT(!loaded.load(kIndexFile, moved.data(), moved.size(), true));
+        EXPECT(loaded.num_points() == points.size());                                  // the tree is kept
+
+        // an invalid permutation (right after the header) is detected by the verification
+        std::string corrupted = data;
+        corrupted[96 + 3] = char(0x7f);
+        std::ofstream(kOtherFile, std::ios::binary).write(corrupted.data(), corrupted.size());
+        EXPECT(!loaded.load(kOtherFile, points.data(), points.size(), true));
+    }
+
+}
+
+
+int main() {
+    test_round_trip<float>(0, 10);
+    test_round_trip<float>(1, 10);
+    test_round_trip<float>(12345, 3);
+    test_round_trip<float>(100000, 10);
+    test_round_trip<double>(30001, 10);
+    test_invalid_files();
+
+    std::remove(kIndexFile);
+    std::remove(kOtherFile);
+    return easy3d::test::failures();
+}
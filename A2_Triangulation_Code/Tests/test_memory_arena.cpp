@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Regression tests of the memory arena and of moving matrices and vectors between the arena and the heap.
+
+#include "test_utils.h"
+#include "matrix.h"
+#include "vector.h"
+
+#include <utility>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    bool all_equal(const Matrix &A, double value) {
+        for (int i = 0; i < A.rows(); ++i) {
+            for (int j = 0; j < A.cols(); ++j) {
+                if (A(i, j) != value)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool all_equal(const Vector &v, double value) {
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            if (v[i] != value)
+                return false;
+        }
+        return true;
+    }
+
+    // reuses the arena storage released by the previous scopes
+    void overwrite_arena() {
+        ArenaScope scope;
+        Matrix garbage(64, 64, -1.0);
+        Vector more(4096, -1.0);
+    }
+
+
+    // moving a temporary of the arena into a matrix on the heap copies it, so the matrix outlives the scope
+    void test_move_into_heap() {
+        Matrix A(8, 8, 0.0);
+        Vector v(8, 0.0);
+        {
+            ArenaScope scope;
+            Matrix B(8, 8, 2.0);
+            A = std::move(B);
+            Vector w(8, 3.0);
+            v = std::move(w);
+        }
+        overwrite_arena();
+        EXPECT(all_equal(A, 2.0));
+        EXPECT(all_equal(v, 3.0));
+    }
+
+
+    // moving within the arena takes the storage over, so a loop doesn't grow the arena
+    void test_move_within_arena() {
+        std::size_t capacity = 0;
+        for (int iter = 0; iter < 100; ++iter) {
+            ArenaScope scope;
+            Matrix A(32, 32, 1.0);
+            Matrix B = A * A;
+            A = std::move(B);
+            EXPECT(all_equal(A, 32.0));
+            if (iter == 0)
+                capacity = MemoryArena::current()->capacity();
+            EXPECT(MemoryArena::current()->capacity() == capacity);
+        }
+    }
+
+
+    // a matrix that isn't the latest allocation is released by the end of the scope, not by its destructor
+    void test_out_of_order_release() {
+        ArenaScope scope;
+        Matrix *first = new Matrix(16, 16, 1.0);
+        Matrix second(16, 16, 2.0);
+        delete first;
+        Matrix third(16, 16, 3.0);     // must not get the storage of 'second'
+        EXPECT(all_equal(second, 2.0));
+        EXPECT(all_equal(third, 3.0));
+
+        MemoryArena &arena = *MemoryArena::current();
+        const MemoryArena::Mark mark = arena.mark();
+        double *p = arena.allocate(10);
+        EXPECT(arena.is_latest(p, 10));
+        arena.deallocate(p, 10);
+        EXPECT(arena.mark().block == mark.block && arena.mark().offset == mark.offset);
+    }
+
+
+    // nested scopes only release what was allocated in them
+    void test_nested_scopes() {
+        ArenaScope outer;
+        Matrix A(16, 16, 1.0);
+        {
+            ArenaScope inner;
+            Matrix B(16, 16, 2.0);
+            EXPECT(all_equal(B, 2.0));
+        }
+        Matrix C(16, 16, 3.0);
+        EXPECT(all_equal(A, 1.0));
+        EXPECT(all_equal(C, 3.0));
+    }
+
+}
+
+
+int main() {
+    test_move_into_heap();
+    test_move_within_arena();
+    test_out_of_order_release();
+    test_nested_scopes();
+    return easy3d::test::failures();
+}
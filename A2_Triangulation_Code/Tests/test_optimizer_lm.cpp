@@ -0,0 +1,166 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Regression tests of the early termination of Optimizer_LM: whatever stops it, x must be the last accepted iterate
+// (i.e., the last one reported to the listener), never a point perturbed for the finite differences.
+
+#include "test_utils.h"
+
+#include <easy3d/optimizer/optimizer_lm.h>
+
+#include <cmath>
+#include <vector>
+
+
+using namespace easy3d;
+
+
+namespace {
+
+    // the Rosenbrock function, which takes a few dozen iterations from the usual starting point
+    class Rosenbrock : public Objective_LM {
+    public:
+        // the evaluation 'fail_at' (counting from 1) fails, none if it is not positive
+        explicit Rosenbrock(int fail_at = 0) : Objective_LM(2, 2), fail_at_(fail_at), evaluations_(0) {}
+
+        int evaluate(const double *x, double *fvec) {
+            if (++evaluations_ == fail_at_)
+                return -1;
+            fvec[0] = 10.0 * (x[1] - x[0] * x[0]);
+            fvec[1] = 1.0 - x[0];
+            return 0;
+        }
+
+    private:
+        int fail_at_;
+        int evaluations_;
+    };
+
+
+    // remembers the last reported iterate
+    class LastIterate : public IterationListener {
+    public:
+        LastIterate() : x(2), reports(0), damping_ok(true) {
+            x[0] = -1.2;
+            x[1] = 1.0;
+        }
+
+        bool iteration(const IterationInfo &info) {
+            x.assign(info.x, info.x + 2);
+            ++reports;
+            damping_ok = damping_ok && info.damping >= 0.0;
+            return true;
+        }
+
+        std::vector<double> x;
+        int reports;
+        bool damping_ok;
+    };
+
+
+    std::vector<double> start() {
+        std::vector<double> x(2);
+        x[0] = -1.2;
+        x[1] = 1.0;
+        return x;
+    }
+
+
+    void test_evaluation_budget() {
+        for (int budget = 1; budget <= 40; ++budget) {
+            Rosenbrock func;
+            LastIterate last;
+            Optimizer_LM::Parameters param;
+            param.listener = &last;
+            param.max_evaluations = budget;
+            std::vector<double> x = start();
+            Optimizer_LM lm;
+            EXPECT(!lm.optimize(&func, x, &param));
+            EXPECT(param.termination == Optimizer_LM::EVALUATION_BUDGET_EXCEEDED);
+            EXPECT(x == last.x);
+            EXPECT(last.damping_ok);
+        }
+    }
+
+
+    // the same stops without a monitor, i.e., the objective itself stops the optimization
+    void test_stopped_by_objective() {
+        for (int budget = 1; budget <= 40; ++budget) {
+            Rosenbrock monitored_func;
+            LastIterate last;
+            Optimizer_LM::Parameters monitored_param;
+            monitored_param.listener = &last;
+            monitored_param.max_evaluations = budget;
+            std::vector<double> expected = start();
+            Optimizer_LM lm;
+            lm.optimize(&monitored_func, expected, &monitored_param);
+
+            Rosenbrock func(budget + 1);
+            Optimizer_LM::Parameters param;
+            std::vector<double> x = start();
+            EXPECT(!lm.optimize(&func, x, &param));
+            EXPECT(param.termination == Optimizer_LM::STOPPED_BY_OBJECTIVE);
+            EXPECT(x == expected);
+        }
+    }
+
+
+    void test_cancellation() {
+        CancellationToken token;
+        token.cancel();
+        Rosenbrock func;
+        Optimizer_LM::Parameters param;
+        param.cancel = &token;
+        std::vector<double> x = start();
+        Optimizer_LM lm;
+        EXPECT(!lm.optimize(&func, x, &param));
+        EXPECT(param.termination == Optimizer_LM::CANCELLED);
+        EXPECT(x == start());
+    }
+
+
+    void test_convergence() {
+        Rosenbrock func;
+        LastIterate last;
+        Optimizer_LM::Parameters param;
+        param.listener = &last;
+        std::vector<double> x = start();
+        Optimizer_LM lm;
+        EXPECT(lm.optimize(&func, x, &param));
+        EXPECT(std::abs(x[0] - 1.0) < 1e-8 && std::abs(x[1] - 1.0) < 1e-8);
+        EXPECT(x == last.x);
+        EXPECT(last.reports > 1);
+        EXPECT(last.damping_ok);
+    }
+
+}
+
+
+int main() {
+    test_evaluation_budget();
+    test_stopped_by_objective();
+    test_cancellation();
+    test_convergence();
+    return easy3d::test::failures();
+}
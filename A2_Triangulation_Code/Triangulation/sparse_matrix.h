@@ -0,0 +1,341 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_CORE_SPARSE_MATRIX_H
+#define EASY3D_CORE_SPARSE_MATRIX_H
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "./matrix.h"
+
+
+namespace easy3d {
+
+
+    /// A sparse m by n matrix in the compressed sparse row (CSR) format, i.e., the nonzero elements are stored row by
+    /// row, together with their column indices. Its memory and the cost of the products with vectors grow with the
+    /// number of nonzero elements rather than m * n. It is assembled from triplets (row, col, value), e.g.,
+    ///     \code
+    ///         std::vector<SparseMatrix::Triplet> triplets;
+    ///         triplets.push_back(SparseMatrix::Triplet(0, 2, 1.5));
+    ///         ...
+    ///         SparseMatrix A(rows, cols, triplets);
+    ///     \endcode
+    class SparseMatrix {
+    public:
+        /// An element of a sparse matrix, used for assembling it.
+        struct Triplet {
+            Triplet(int r, int c, double v) : row(r), col(c), value(v) {}
+            int row;
+            int col;
+            double value;
+        };
+
+    public:
+        /// Default constructor (that constructs an empty matrix).
+        SparseMatrix();
+
+        /// Constructs a rows by cols matrix with all elements being zero.
+        SparseMatrix(int rows, int cols);
+
+        /// Constructs a rows by cols matrix from triplets, see set_from_triplets().
+        SparseMatrix(int rows, int cols, const std::vector<Triplet> &triplets);
+
+        /// Sets the size and the elements of the matrix from triplets, which can be in any order. The values of
+        /// triplets at the same position are summed up.
+        /// @return false if a triplet is out of range (and the matrix is left empty).
+        bool set_from_triplets(int rows, int cols, const std::vector<Triplet> &triplets);
+
+        /// Return the number of rows.
+        int rows() const { return nRow_; }
+
+        /// Return the number of columns.
+        int cols() const { return nColumn_; }
+
+        /// Return the number of (explicitly stored) nonzero elements.
+        long nonzeros() const { return static_cast<long>(values_.size()); }
+
+        /// Return the element at (row, col), which is found by a binary search in the row.
+        double get(int row, int col) const;
+
+        /// The start of each row in col_indices() and values(), i.e., the elements of the row_th row are in
+        /// [row_offsets()[row], row_offsets()[row + 1]). It has rows() + 1 entries.
+        const std::vector<long> &row_offsets() const { return offsets_; }
+
+        /// The column indices of the nonzero elements (increasing within each row).
+        const std::vector<int> &col_indices() const { return columns_; }
+
+        /// The values of the nonzero elements.
+        const std::vector<double> &values() const { return values_; }
+
+        /// Computes y = A * x, where x has cols() elements and y has rows() elements. The rows are distributed over
+        /// all threads if the matrix has many nonzero elements.
+        void mult(const double *x, double *y) const;
+
+        /// Computes y = A^T * x, where x has rows() elements and y has cols() elements. The rows are distributed over
+        /// all threads if the matrix has many nonzero elements (each thread then accumulates into its own copy of y).
+        void mult_transpose(const double *x, double *y) const;
+
+        /// Returns the dense copy of this matrix.
+        Matrix to_dense() const;
+
+    private:
+        // the number of threads used by a product with a vector
+        int num_threads() const;
+
+    private:
+        int nRow_;
+        int nColumn_;
+        std::vector<long> offsets_;
+        std::vector<int> columns_;
+        std::vector<double> values_;
+    };
+
+
+    /// sparse matrix-vector multiplication
+    Vector operator*(const SparseMatrix &A, const Vector &x);
+
+    /// sparse matrix-vector multiplication
+    std::vector<double> operator*(const SparseMatrix &A, const std::vector<double> &x);
+
+    /// output a sparse matrix (as a list of its nonzero elements) by overloading <<
+    std::ostream &operator<<(std::ostream &os, const SparseMatrix &A);
+
+
+    namespace details {
+        // the number of nonzero elements, above which a product with a vector uses all threads. Starting the threads
+        // costs some tens of microseconds, so smaller products are faster on a single thread.
+        const long kSparseParallelThreshold = 200000L;
+    }
+
+}
+
+
+// ----------------------- Implementation -----------------------------
+
+
+namespace easy3d {
+
+
+    inline SparseMatrix::SparseMatrix() : nRow_(0), nColumn_(0), offsets_(1, 0) {
+    }
+
+
+    inline SparseMatrix::SparseMatrix(int rows, int cols) : nRow_(rows), nColumn_(cols), offsets_(rows + 1, 0) {
+    }
+
+
+    inline SparseMatrix::SparseMatrix(int rows, int cols, const std::vector<Triplet> &triplets)
+            : nRow_(0), nColumn_(0), offsets_(1, 0) {
+        set_from_triplets(rows, cols, triplets);
+    }
+
+
+    inline bool SparseMatrix::set_from_triplets(int rows, int cols, const std::vector<Triplet> &triplets) {
+        nRow_ = nColumn_ = 0;
+        offsets_.assign(1, 0);
+        columns_.clear();
+        values_.clear();
+        for (std::size_t i = 0; i < triplets.size(); ++i) {
+            const Triplet &t = triplets[i];
+            if (t.row < 0 || t.row >= rows || t.col < 0 || t.col >= cols) {
+                std::cerr << "could not assemble sparse matrix: triplet (" << t.row << ", " << t.col
+                          << ") is out of range" << std::endl;
+                return false;
+            }
+        }
+
+        // bucket the triplets by rows (counting sort), so the assembly is linear in the number of triplets
+        std::vector<long> start(rows + 1, 0);
+        for (std::size_t i = 0; i < triplets.size(); ++i)
+            ++start[triplets[i].row + 1];
+        for (int r = 0; r < rows; ++r)
+            start[r + 1] += start[r];
+        std::vector<int> cols_by_row(triplets.size());
+        std::vector<double> values_by_row(triplets.size());
+        std::vector<long> next(start.begin(), start.end() - 1);
+        for (std::size_t i = 0; i < triplets.size(); ++i) {
+            const long k = next[triplets[i].row]++;
+            cols_by_row[k] = triplets[i].col;
+            values_by_row[k] = triplets[i].value;
+        }
+
+        // sort each row by columns and sum up the duplicates
+        nRow_ = rows;
+        nColumn_ = cols;
+        offsets_.assign(rows + 1, 0);
+        columns_.reserve(triplets.size());
+        values_.reserve(triplets.size());
+        std::vector<std::pair<int, double> > row;
+        for (int r = 0; r < rows; ++r) {
+            row.clear();
+            for (long k = start[r]; k < start[r + 1]; ++k)
+                row.push_back(std::make_pair(cols_by_row[k], values_by_row[k]));
+            std::sort(row.begin(), row.end(),
+                      [](const std::pair<int, double> &a, const std::pair<int, double> &b) { return a.first < b.first; });
+            for (std::size_t k = 0; k < row.size(); ++k) {
+                if (k > 0 && row[k].first == row[k - 1].first)
+                    values_.back() += row[k].second;
+                else {
+                    columns_.push_back(row[k].first);
+                    values_.push_back(row[k].second);
+                }
+            }
+            offsets_[r + 1] = static_cast<long>(values_.size());
+        }
+        return true;
+    }
+
+
+    inline double SparseMatrix::get(int row, int col) const {
+        assert(row >= 0 && row < nRow_);
+        assert(col >= 0 && col < nColumn_);
+        const int *begin = columns_.data() + offsets_[row];
+        const int *end = columns_.data() + offsets_[row + 1];
+        const int *pos = std::lower_bound(begin, end, col);
+        return (pos != end && *pos == col) ? values_[pos - columns_.data()] : 0.0;
+    }
+
+
+    inline int SparseMatrix::num_threads() const {
+        if (nonzeros() < details::kSparseParallelThreshold)
+            return 1;
+        return std::min(details::gemm_num_threads(), std::max(1, nRow_ / 64));
+    }
+
+
+    inline void SparseMatrix::mult(const double *x, double *y) const {
+        const long *offsets = offsets_.data();
+        const int *columns = columns_.data();
+        const double *values = values_.data();
+        auto rows = [=](int begin, int end) {
+            for (int r = begin; r < end; ++r) {
+                double sum = 0.0;
+                for (long k = offsets[r]; k < offsets[r + 1]; ++k)
+                    sum += values[k] * x[columns[k]];
+                y[r] = sum;
+            }
+        };
+
+        const int num = num_threads();
+        if (num == 1) {
+            rows(0, nRow_);
+            return;
+        }
+        // each thread takes a range of rows with about the same number of nonzero elements
+        std::vector<std::thread> threads;
+        int begin = 0;
+        for (int t = 0; t < num; ++t) {
+            const long target = nonzeros() * (t + 1) / num;
+            const int end = (t == num - 1) ? nRow_ :
+                            static_cast<int>(std::lower_bound(offsets_.begin() + begin, offsets_.end() - 1, target) -
+                                             offsets_.begin());
+            threads.push_back(std::thread(rows, begin, end));
+            begin = end;
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+
+    inline void SparseMatrix::mult_transpose(const double *x, double *y) const {
+        const long *offsets = offsets_.data();
+        const int *columns = columns_.data();
+        const double *values = values_.data();
+        auto rows = [=](int begin, int end, double *result) {
+            for (int r = begin; r < end; ++r) {
+                const double xr = x[r];
+                for (long k = offsets[r]; k < offsets[r + 1]; ++k)
+                    result[columns[k]] += values[k] * xr;
+            }
+        };
+
+        std::fill(y, y + nColumn_, 0.0);
+        const int num = num_threads();
+        if (num == 1) {
+            rows(0, nRow_, y);
+            return;
+        }
+        // the threads would write to the same elements of y, so each accumulates into its own copy first
+        std::vector<std::vector<double> > partial(num - 1, std::vector<double>(nColumn_, 0.0));
+        std::vector<std::thread> threads;
+        int begin = 0;
+        for (int t = 0; t < num; ++t) {
+            const long target = nonzeros() * (t + 1) / num;
+            const int end = (t == num - 1) ? nRow_ :
+                            static_cast<int>(std::lower_bound(offsets_.begin() + begin, offsets_.end() - 1, target) -
+                                             offsets_.begin());
+            threads.push_back(std::thread(rows, begin, end, t == 0 ? y : partial[t - 1].data()));
+            begin = end;
+        }
+        for (auto &thread : threads)
+            thread.join();
+        for (std::size_t t = 0; t < partial.size(); ++t) {
+            for (int c = 0; c < nColumn_; ++c)
+                y[c] += partial[t][c];
+        }
+    }
+
+
+    inline Matrix SparseMatrix::to_dense() const {
+        Matrix A(nRow_, nColumn_, 0.0);
+        for (int r = 0; r < nRow_; ++r) {
+            for (long k = offsets_[r]; k < offsets_[r + 1]; ++k)
+                A(r, columns_[k]) = values_[k];
+        }
+        return A;
+    }
+
+
+    inline Vector operator*(const SparseMatrix &A, const Vector &x) {
+        assert(A.cols() == static_cast<int>(x.size()));
+        Vector y(A.rows());
+        A.mult(x.data(), y.data());
+        return y;
+    }
+
+
+    inline std::vector<double> operator*(const SparseMatrix &A, const std::vector<double> &x) {
+        assert(A.cols() == static_cast<int>(x.size()));
+        std::vector<double> y(A.rows());
+        A.mult(x.data(), y.data());
+        return y;
+    }
+
+
+    inline std::ostream &operator<<(std::ostream &os, const SparseMatrix &A) {
+        os << A.rows() << " x " << A.cols() << ", " << A.nonzeros() << " nonzeros" << std::endl;
+        for (int r = 0; r < A.rows(); ++r) {
+            for (long k = A.row_offsets()[r]; k < A.row_offsets()[r + 1]; ++k)
+                os << "(" << r << ", " << A.col_indices()[k] << ") " << A.values()[k] << std::endl;
+        }
+        return os;
+    }
+
+}
+
+
+#endif // EASY3D_CORE_SPARSE_MATRIX_H
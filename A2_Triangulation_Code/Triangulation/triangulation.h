@@ -44,12 +44,9 @@ public:
             const std::string &image_point_file_1
     );
 
-protected:
-    std::string usage() const override;
-
-    bool key_press_event(int key, int modifiers) override;
-
-    bool triangulation(
+    /// Reconstructs 3D points from two views. It doesn't touch the viewer state, so it can also be called without
+    /// creating a window (e.g., from the benchmark).
+    static bool triangulation(
             double fx, double fy,     /// input: the focal lengths (same for both cameras)
             double cx, double cy,     /// input: the principal point (same for both cameras)
             double s,                 /// input: the skew factor (same for both cameras)
@@ -58,7 +55,12 @@ protected:
             std::vector<easy3d::Vector3D> &points_3d,               /// output: reconstructed 3D points
             easy3d::Matrix33 &R,   /// output: recovered rotation of 2nd camera
             easy3d::Vector3D &t    /// output: recovered translation of 2nd camera
-    ) const;
+    );
+
+protected:
+    std::string usage() const override;
+
+    bool key_press_event(int key, int modifiers) override;
 
     void post_draw() override;
     void cleanup() override;
@@ -24,7 +24,7 @@
 
 #include "triangulation.h"
 #include "matrix_algo.h"
-#include <easy3d/optimizer/optimizer_lm.h>
+#include <easy3d/optimizer/optimizer_lm_batch.h>
 
 
 using namespace easy3d;
@@ -123,13 +123,8 @@ Matrix F (const std::vector<Vector2D>& normal_points_0, const std::vector<Vector
         W(i, 8) = 1;
     }
 
-    // svd decomposition
-    Matrix U(n, n);
-    Matrix D(n, 9);
-    Matrix V(9, 9);
-    svd_decompose(W, U, D, V);
-    int numCols = V.cols();
-    Vector F = V.get_column(numCols - 1);
+    // the right singular vector of W (its n by n U is not needed)
+    Vector F = null_vector(W);
     Matrix F_matrix(3, 3, F.data());
 
     // enforce rank 2
@@ -200,6 +195,8 @@ int triangulate_func(Matrix33 K, const std::vector<Vector2D> &points_0,
                       const std::vector<Vector2D> &points_1,
                       const Matrix33 &R_prime, const Vector3D &t_prime,
                       std::vector<Vector3D> &points_3d){
+    // all the matrices below are temporaries, which are released at once when the function returns
+    ArenaScope scope;
 
     Matrix R = Matrix::identity(3,3);
     Vector3D t;
@@ -219,28 +216,30 @@ int triangulate_func(Matrix33 K, const std::vector<Vector2D> &points_0,
     Matrix m2_prime(1,4,{M_prime(1,0), M_prime(1,1), M_prime(1,2), M_prime(1,3)});
     Matrix m3_prime(1,4,{M_prime(2,0), M_prime(2,1), M_prime(2,2), M_prime(2,3)});
 
-    // Triangulate the 3D points
+    // Triangulate the 3D points. The 4 by 4 systems of all points are solved at once, with the matrices stored
+    // element by element, i.e., element e of the matrix of a point at A[e * amount_of_points + pt_index].
     int amount_of_points = points_0.size();
-    int points_in_front_of_both_cameras = 0;
+    std::vector<double> A(16 * amount_of_points), X(4 * amount_of_points);
     for (int pt_index = 0; pt_index < amount_of_points; pt_index++) {
         double x = points_0[pt_index][0];
         double y = points_0[pt_index][1];
         double x_prime = points_1[pt_index][0];
         double y_prime = points_1[pt_index][1];
-        Matrix44 A;
         // Construct the matrix A
         for (int i = 0; i < 4; i++) {
-            A(0, i) = x * m3(0, i) - m1(0, i);
-            A(1, i) = y * m3(0, i) - m2(0, i);
-            A(2, i) = x_prime * m3_prime(0, i) - m1_prime(0, i);
-            A(3, i) = y_prime * m3_prime(0, i) - m2_prime(0, i);
+            A[(0 * 4 + i) * amount_of_points + pt_index] = x * m3(0, i) - m1(0, i);
+            A[(1 * 4 + i) * amount_of_points + pt_index] = y * m3(0, i) - m2(0, i);
+            A[(2 * 4 + i) * amount_of_points + pt_index] = x_prime * m3_prime(0, i) - m1_prime(0, i);
+            A[(3 * 4 + i) * amount_of_points + pt_index] = y_prime * m3_prime(0, i) - m2_prime(0, i);
         }
+    }
+    null_vector_batch(4, amount_of_points, A.data(), X.data());
 
-        Matrix44 U, S, V_transpose;
-        svd_decompose(A, U, S, V_transpose);
-        int numCols = V_transpose.cols();
+    int points_in_front_of_both_cameras = 0;
+    for (int pt_index = 0; pt_index < amount_of_points; pt_index++) {
         // Get the 3D point
-        Vector4D P = V_transpose.get_column(numCols - 1);
+        Vector4D P(X[0 * amount_of_points + pt_index], X[1 * amount_of_points + pt_index],
+                   X[2 * amount_of_points + pt_index], X[3 * amount_of_points + pt_index]);
         Vector3D P_homo = {P[0]/P[3], P[1]/P[3], P[2]/P[3]};
         // Transform the 3D point to the camera coordinate system of the first camera (camera 0)
         Vector3D P_cam0 = R * P_homo + t;
@@ -295,32 +294,33 @@ void get_correct_R_and_t(
 
 
 //// non-linear optimization
-class TriangulationObjective : public Objective_LM {
+// The refinement of the points for fixed cameras: problem i has the coordinates of the i_th point as its variables, and
+// its reprojection errors in both images as its functions. All the problems share the image points and the cameras.
+class PointRefinementObjective : public Objective_LM_Batch {
 public:
-    std::vector<Vector2D> p, p_prime;  // 2D points
-    Matrix M, Mp; // camera parameter matrices
+    const std::vector<Vector2D> &p, &p_prime;  // 2D points
+    const Matrix34 &M, &Mp; // camera parameter matrices
 
     // constructor
-    TriangulationObjective(const std::vector<Vector2D> &points0, const std::vector<Vector2D> &points1,
-                           const Matrix &M0, const Matrix &M1)
-            : Objective_LM(points0.size() * 4, points0.size() * 3),
-              p(points0), p_prime(points1), M(M0), Mp(M1) {}
-
-    int evaluate(const double *x, double *fvec) {
-        for (int i = 0; i < p.size(); ++i) {
-            double P_data[4] = {x[3 * i], x[3 * i + 1], x[3 * i + 2], 1.0};
-            Matrix P(4, 1, P_data);
-            Matrix projected_p = M * P;
-            Matrix projected_p_prime = Mp * P;
-            projected_p /= projected_p(2, 0);
-            projected_p_prime /= projected_p_prime(2, 0);
-            fvec[4 * i] = projected_p(0, 0) - p[i][0];
-            fvec[4 * i + 1] = projected_p(1, 0) - p[i][1];
-            fvec[4 * i + 2] = projected_p_prime(0, 0) - p_prime[i][0];
-            fvec[4 * i + 3] = projected_p_prime(1, 0) - p_prime[i][1];
-        }
+    PointRefinementObjective(const std::vector<Vector2D> &points0, const std::vector<Vector2D> &points1,
+                             const Matrix34 &M0, const Matrix34 &M1)
+            : Objective_LM_Batch(4, 3), p(points0), p_prime(points1), M(M0), Mp(M1) {}
+
+    int evaluate(std::size_t i, const double *x, double *fvec) const {
+        project(M, x, p[i], fvec);
+        project(Mp, x, p_prime[i], fvec + 2);
         return 0;
     }
+
+private:
+    // the difference between the projection of the 3D point x by the camera and the image point
+    static void project(const Matrix34 &camera, const double *x, const Vector2D &point, double *fvec) {
+        double q[3];
+        for (int r = 0; r < 3; ++r)
+            q[r] = camera(r, 0) * x[0] + camera(r, 1) * x[1] + camera(r, 2) * x[2] + camera(r, 3);
+        fvec[0] = q[0] / q[2] - point[0];
+        fvec[1] = q[1] / q[2] - point[1];
+    }
 };
 
 ////Calculating reprojection errors
@@ -381,7 +381,7 @@ bool Triangulation::triangulation(
         std::vector<Vector3D> &points_3d,       /// output: reconstructed 3D points
         Matrix33 &R,   /// output: 3 by 3 matrix, which is the recovered rotation of the 2nd camera
         Vector3D &t    /// output: 3D vector, which is the recovered translation of the 2nd camera
-) const
+)
 {
     // TODO: check if the input is valid (always good because you never known how others will call your function).
     bool valid = check_input(points_0, points_1);
@@ -427,16 +427,19 @@ bool Triangulation::triangulation(
 
     std::vector<Vector3D> points_3d_before(points_3d.begin(), points_3d.end());
 
-    TriangulationObjective obj(points_0, points_1, M0, M);
-
+    // For fixed cameras, each point only affects its own reprojection errors. So instead of refining all points
+    // jointly (which has 3n variables), every point is refined by its own small problem, all solved in parallel.
+    PointRefinementObjective objective(points_0, points_1, M0, M);
     std::vector<double> x;
-    for (const auto &point : points_3d) {
-        x.push_back(point.x());
-        x.push_back(point.y());
-        x.push_back(point.z());
+    x.reserve(points_3d.size() * 3);
+    for (std::size_t i = 0; i < points_3d.size(); ++i) {
+        x.push_back(points_3d[i].x());
+        x.push_back(points_3d[i].y());
+        x.push_back(points_3d[i].z());
     }
-    Optimizer_LM lm;
-    bool status = lm.optimize(&obj, x);
+    std::vector<Optimizer_LM_Batch::Result> results;
+    Optimizer_LM_Batch lm;
+    bool status = lm.optimize(&objective, points_3d.size(), x, results);
     if (status) {
         points_3d.clear();
         for (int i = 0; i < x.size(); i += 3) {
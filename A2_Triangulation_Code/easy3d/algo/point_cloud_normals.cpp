@@ -0,0 +1,298 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <easy3d/algo/point_cloud_normals.h>
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/core/graph.h>
+#include <easy3d/core/kdtree.h>
+#include <easy3d/core/principal_axes.h>
+#include <easy3d/util/logging.h>
+#include <easy3d/util/threading.h>
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+
+namespace easy3d {
+
+
+    namespace {
+
+        // the number of points processed by a task of the thread pool
+        const std::size_t kChunkSize = 4096;
+
+
+        // Calls task(begin, end, thread) for the chunks [begin, end) of [0, num), on a pool of 'num_threads' threads.
+        // 'thread' is the index of the worker in [0, num_threads) (e.g., to use its own memory).
+        template <typename Task>
+        void for_each_chunk(std::size_t num, int num_threads, const Task& task) {
+            const std::size_t num_chunks = (num + kChunkSize - 1) / kChunkSize;
+            if (num_threads <= 1 || num_chunks <= 1) {
+                for (std::size_t begin = 0; begin < num; begin += kChunkSize)
+                    task(begin, std::min(num, begin + kChunkSize), 0);
+                return;
+            }
+
+            ThreadPool pool(num_threads);
+            for (std::size_t c = 0; c < num_chunks; ++c) {
+                pool.AddTask([&pool, &task, c, num]() {
+                    task(c * kChunkSize, std::min(num, (c + 1) * kChunkSize), pool.GetThreadIndex());
+                });
+            }
+            pool.Wait();
+        }
+
+
+        // an edge of the K-nearest-neighbor graph
+        struct WeightedEdge {
+            int source, target;
+            float weight;   // 1 - |cos| of the angle between the normals of the two points
+
+            bool operator<(const WeightedEdge& rhs) const {    // ties are broken by the points for a unique order
+                if (weight != rhs.weight) return weight < rhs.weight;
+                if (source != rhs.source) return source < rhs.source;
+                return target < rhs.target;
+            }
+        };
+
+
+        // Sorts the edges by their weights: 'num_threads' ranges are sorted concurrently, and then merged pairwise.
+        void sort_edges(std::vector<WeightedEdge>& edges, int num_threads) {
+            const std::size_t num = edges.size();
+            const std::size_t num_ranges = std::max<std::size_t>(1, std::min<std::size_t>(num_threads, num / kChunkSize));
+            if (num_ranges <= 1) {
+                std::sort(edges.begin(), edges.end());
+                return;
+            }
+
+            std::vector<std::size_t> bounds(num_ranges + 1);
+            for (std::size_t r = 0; r <= num_ranges; ++r)
+                bounds[r] = num * r / num_ranges;
+
+            ThreadPool pool(static_cast<int>(num_ranges));
+            for (std::size_t r = 0; r < num_ranges; ++r) {
+                pool.AddTask([&edges, &bounds, r]() {
+                    std::sort(edges.begin() + bounds[r], edges.begin() + bounds[r + 1]);
+                });
+            }
+            pool.Wait();
+
+            for (std::size_t width = 1; width < num_ranges; width *= 2) {
+                for (std::size_t r = 0; r + width < num_ranges; r += 2 * width) {
+                    const std::size_t first = bounds[r];
+                    const std::size_t middle = bounds[r + width];
+                    const std::size_t last = bounds[std::min(num_ranges, r + 2 * width)];
+                    pool.AddTask([&edges, first, middle, last]() {
+                        std::inplace_merge(edges.begin() + first, edges.begin() + middle, edges.begin() + last);
+                    });
+                }
+                pool.Wait();
+            }
+        }
+
+
+        // the points in the order of the leaves of the kd-tree ('order' has their indices)
+        void sort_spatially(const KdTree& kdtree, const std::vector<vec3>& points,
+                            std::vector<int>& order, std::vector<vec3>& sorted)
+        {
+            kdtree.leaf_order(order);
+            sorted.resize(order.size());
+            for (std::size_t i = 0; i < order.size(); ++i)
+                sorted[i] = points[order[i]];
+        }
+
+
+        // the representative of the set of x (with path halving)
+        inline int find_set(std::vector<int>& parent, int x) {
+            while (parent[x] != x) {
+                parent[x] = parent[parent[x]];
+                x = parent[x];
+            }
+            return x;
+        }
+
+    }
+
+
+    bool PointCloudNormals::estimate(PointCloud *cloud, unsigned int k, int num_threads) {
+        if (!cloud) {
+            LOG(WARNING) << "empty input point cloud";
+            return false;
+        }
+
+        const std::vector<vec3>& points = cloud->points();
+        const std::size_t num = points.size();
+        if (num < 3) {
+            LOG(WARNING) << "too few points to estimate normals: " << num;
+            return false;
+        }
+
+        num_threads = GetEffectiveNumThreads(num_threads);
+        KdTree kdtree;
+        kdtree.set_num_threads(num_threads);
+        kdtree.begin();
+        kdtree.add_point_cloud(cloud);
+        kdtree.end();
+
+        auto normals = cloud->vertex_property<vec3>("v:normal");
+        std::vector<vec3>& normal_values = normals.vector();
+        const int num_neighbors = static_cast<int>(std::min<std::size_t>(std::max(k, 3u), num));
+
+        // the points are processed in the order of the leaves of the tree, so consecutive queries visit the same nodes
+        std::vector<int> order;
+        std::vector<vec3> queries;
+        sort_spatially(kdtree, points, order, queries);
+
+        std::vector<Neighbors> neighbors(num_threads);
+        for_each_chunk(num, num_threads, [&](std::size_t begin, std::size_t end, int thread) {
+            Neighbors& nb = neighbors[thread];
+            kdtree.find_closest_K_points(queries.data() + begin, end - begin, num_neighbors, nb, 1);
+
+            // The neighbors are relative to the point, so the covariance doesn't lose precision for points far from
+            // the origin (e.g., in georeferenced coordinates).
+            PrincipalAxes<3, double> pca;
+            for (std::size_t i = begin; i < end; ++i) {
+                const vec3& p = queries[i];
+                const std::size_t q = i - begin;
+                pca.begin();
+                for (std::size_t j = nb.offsets[q]; j < nb.offsets[q + 1]; ++j)
+                    pca.add_point(dvec3(points[nb.indices[j]] - p));
+                pca.end();
+                normal_values[order[i]] = vec3(pca.axis(2));    // the eigenvector of the smallest eigenvalue
+            }
+        });
+
+        return true;
+    }
+
+
+    bool PointCloudNormals::reorient(PointCloud *cloud, unsigned int k, int num_threads) {
+        if (!cloud) {
+            LOG(WARNING) << "empty input point cloud";
+            return false;
+        }
+
+        auto normals = cloud->get_vertex_property<vec3>("v:normal");
+        if (!normals) {
+            LOG(WARNING) << "normal information does not exist";
+            return false;
+        }
+
+        const std::vector<vec3>& points = cloud->points();
+        const int num = static_cast<int>(points.size());
+        if (num < 2)
+            return true;
+
+        num_threads = GetEffectiveNumThreads(num_threads);
+        KdTree kdtree;
+        kdtree.set_num_threads(num_threads);
+        kdtree.begin();
+        kdtree.add_point_cloud(cloud);
+        kdtree.end();
+
+        // the K-nearest-neighbor graph (the neighbors include the point itself, which gives no edge)
+        std::vector<vec3>& normal_values = normals.vector();
+        const int num_neighbors = std::min(static_cast<int>(std::max(k, 1u)) + 1, num);
+        std::vector<int> order;
+        std::vector<vec3> queries;
+        sort_spatially(kdtree, points, order, queries);
+
+        std::vector<WeightedEdge> edges(static_cast<std::size_t>(num) * num_neighbors);
+        std::vector<Neighbors> neighbors(num_threads);
+        for_each_chunk(num, num_threads, [&](std::size_t begin, std::size_t end, int thread) {
+            Neighbors& nb = neighbors[thread];
+            kdtree.find_closest_K_points(queries.data() + begin, end - begin, num_neighbors, nb, 1);
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t q = i - begin;
+                const int source = order[i];
+                for (int j = 0; j < num_neighbors; ++j) {
+                    WeightedEdge& e = edges[i * num_neighbors + j];
+                    e.source = source;
+                    e.target = nb.indices[nb.offsets[q] + j];
+                    e.weight = 1.0f - std::abs(dot(normal_values[source], normal_values[e.target]));
+                }
+            }
+        });
+        sort_edges(edges, num_threads);
+
+        // the minimum spanning tree (a forest if the graph is not connected), by Kruskal's algorithm
+        Graph mst;
+        mst.reserve(num, num - 1);
+        for (int i = 0; i < num; ++i)
+            mst.add_vertex(points[i]);
+
+        std::vector<int> parent(num);
+        for (int i = 0; i < num; ++i)
+            parent[i] = i;
+        for (const auto& e : edges) {
+            const int s = find_set(parent, e.source);
+            const int t = find_set(parent, e.target);
+            if (s != t) {
+                parent[s] = t;
+                mst.add_edge(Graph::Vertex(e.source), Graph::Vertex(e.target));
+            }
+        }
+        std::vector<WeightedEdge>().swap(edges);
+
+        // each tree starts from its highest point
+        std::vector<int> seed(num, -1);
+        for (int i = 0; i < num; ++i) {
+            int& s = seed[find_set(parent, i)];
+            if (s == -1 || points[i].z > points[s].z)
+                s = i;
+        }
+
+        // propagate the orientation along the trees
+        std::vector<bool> visited(num, false);
+        std::queue<Graph::Vertex> queue;
+        for (int r = 0; r < num; ++r) {
+            if (seed[r] == -1)
+                continue;
+            const Graph::Vertex s(seed[r]);
+            if (normal_values[s.idx()].z < 0)
+                normal_values[s.idx()] = -normal_values[s.idx()];
+            visited[s.idx()] = true;
+            queue.push(s);
+            while (!queue.empty()) {
+                const Graph::Vertex v = queue.front();
+                queue.pop();
+                const vec3& n = normal_values[v.idx()];
+                for (auto w : mst.vertices(v)) {
+                    if (visited[w.idx()])
+                        continue;
+                    if (dot(n, normal_values[w.idx()]) < 0)
+                        normal_values[w.idx()] = -normal_values[w.idx()];
+                    visited[w.idx()] = true;
+                    queue.push(w);
+                }
+            }
+        }
+
+        return true;
+    }
+
+}
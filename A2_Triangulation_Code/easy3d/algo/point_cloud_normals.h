@@ -0,0 +1,66 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_POINT_CLOUD_NORMALS_H
+#define EASY3D_ALGO_POINT_CLOUD_NORMALS_H
+
+
+/**
+PointCloudNormals estimates the normals of a point cloud (e.g., of the triangulated points, which don't have normals),
+and orients them consistently. The normals are stored as the "v:normal" vertex property.
+
+    PointCloudNormals::estimate(cloud, 16);     // the directions of the normals
+    PointCloudNormals::reorient(cloud, 10);     // consistent orientation (i.e., all pointing outward or inward)
+    auto normals = cloud->get_vertex_property<vec3>("v:normal");
+
+@attention The deleted points (if any) are treated like the others, so call garbage_collection() first.
+*/
+
+
+namespace easy3d {
+
+    class PointCloud;
+
+    class PointCloudNormals {
+    public:
+        /// Estimates the normal of each point by principal component analysis of its K nearest neighbors (including
+        /// the point itself), i.e., the normal is the direction of the least variance of the neighborhood. The points
+        /// are processed in parallel by 'num_threads' threads (all the logical cores if it is not positive), each of
+        /// which reuses its own memory for the neighbors, and solves the 3x3 covariance matrices without allocation.
+        /// The orientation of the normals is arbitrary (see reorient()).
+        /// @return false if the point cloud has fewer than 3 points.
+        static bool estimate(PointCloud *cloud, unsigned int k = 16, int num_threads = -1);
+
+        /// Orients the normals (e.g., computed by estimate()) consistently, following Hoppe et al. (1992). The
+        /// orientation is propagated along the minimum spanning tree of the K-nearest-neighbor graph, in which two
+        /// points are closer the more parallel their normals are, so it rarely crosses sharp features. Each connected
+        /// part of the graph starts from its highest point, whose normal is made to point upward (+Z).
+        /// @return false if the point cloud has no normals.
+        static bool reorient(PointCloud *cloud, unsigned int k = 10, int num_threads = -1);
+    };
+
+}
+
+#endif  // EASY3D_ALGO_POINT_CLOUD_NORMALS_H
@@ -0,0 +1,329 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include <easy3d/algo/point_cloud_simplification.h>
+#include <easy3d/core/point_cloud.h>
+#include <easy3d/core/box.h>
+#include <easy3d/util/logging.h>
+#include <easy3d/util/threading.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+
+namespace easy3d {
+
+
+    namespace {
+
+        // the number of points processed by a task of the thread pool (fewer points are handled by a single range)
+        const std::size_t kChunkSize = 65536;
+
+        // the radix sort handles the keys at most 11 bits at a time
+        const int kMaxRadixBits = 11;
+
+
+        // a point and the key of the cell containing it
+        struct CellItem {
+            uint64_t key;
+            int index;
+        };
+
+
+        // Splits [0, num) into at most 'num_threads' contiguous ranges (of at least kChunkSize elements), and calls
+        // task(begin, end, range) for each of them concurrently. Returns the number of ranges.
+        template <typename Task>
+        std::size_t for_each_range(ThreadPool* pool, std::size_t num, std::size_t num_ranges, const Task& task) {
+            if (num_ranges <= 1 || !pool) {
+                task(std::size_t(0), num, std::size_t(0));
+                return 1;
+            }
+
+            for (std::size_t r = 0; r < num_ranges; ++r) {
+                const std::size_t begin = num * r / num_ranges;
+                const std::size_t end = num * (r + 1) / num_ranges;
+                pool->AddTask([&task, begin, end, r]() { task(begin, end, r); });
+            }
+            pool->Wait();
+            return num_ranges;
+        }
+
+
+        // the number of bits to represent the values in [0, num)
+        inline int num_bits(uint64_t num) {
+            int bits = 0;
+            while (bits < 64 && (num - 1) >> bits)
+                ++bits;
+            return bits;
+        }
+
+
+        // Sorts the items by their keys (stable, i.e., the items of a cell keep their order), considering only the
+        // lowest 'key_bits' bits. It is a least significant digit radix sort: each pass counts the digits of each
+        // range, and then scatters the items of the ranges concurrently (each range writes to its own positions). The
+        // digits are as wide as the fewest passes allow, e.g., 24 bits are sorted in 3 passes of 8 bits.
+        void radix_sort(std::vector<CellItem>& items, int key_bits, ThreadPool* pool, std::size_t num_ranges) {
+            const int num_passes = (key_bits + kMaxRadixBits - 1) / kMaxRadixBits;
+            if (num_passes == 0)
+                return;
+            const int radix_bits = (key_bits + num_passes - 1) / num_passes;
+            const std::size_t radix_size = std::size_t(1) << radix_bits;
+            const uint64_t mask = radix_size - 1;
+
+            const std::size_t num = items.size();
+            std::vector<CellItem> buffer(num);
+            std::vector<std::size_t> counts(num_ranges * radix_size);
+
+            for (int shift = 0; shift < key_bits; shift += radix_bits) {
+                std::fill(counts.begin(), counts.end(), 0);
+                for_each_range(pool, num, num_ranges, [&](std::size_t begin, std::size_t end, std::size_t r) {
+                    std::size_t* count = &counts[r * radix_size];
+                    for (std::size_t i = begin; i < end; ++i)
+                        ++count[(items[i].key >> shift) & mask];
+                });
+
+                // the first position of each (digit, range), in the order of the digits and then the ranges
+                std::size_t position = 0;
+                for (std::size_t d = 0; d < radix_size; ++d) {
+                    for (std::size_t r = 0; r < num_ranges; ++r) {
+                        const std::size_t count = counts[r * radix_size + d];
+                        counts[r * radix_size + d] = position;
+                        position += count;
+                    }
+                }
+
+                for_each_range(pool, num, num_ranges, [&](std::size_t begin, std::size_t end, std::size_t r) {
+                    std::size_t* next = &counts[r * radix_size];
+                    for (std::size_t i = begin; i < end; ++i)
+                        buffer[next[(items[i].key >> shift) & mask]++] = items[i];
+                });
+                items.swap(buffer);
+            }
+        }
+
+
+        // Computes the cell of each point (packed into a key) and groups the points by their cells. Returns false if
+        // the cell size is not positive or the keys need more than 64 bits.
+        bool compute_cells(const std::vector<vec3>& points, float cell_size, ThreadPool* pool, std::size_t num_ranges,
+                           std::vector<std::size_t>& offsets, std::vector<int>& indices)
+        {
+            offsets.assign(1, 0);
+            indices.clear();
+            if (!(cell_size > 0.0f)) {
+                LOG(ERROR) << "the cell size must be positive: " << cell_size;
+                return false;
+            }
+
+            const std::size_t num = points.size();
+            if (num == 0)
+                return true;
+
+            Box3 box;
+            for (std::size_t i = 0; i < num; ++i)
+                box.add_point(points[i]);
+
+            // the number of cells along each axis, and the bits of the cell coordinates in the key (x is the lowest)
+            uint64_t num_cells[3];
+            int shifts[3];
+            int key_bits = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                const double extent = std::floor(double(box.range(axis)) / cell_size);
+                if (!(extent < 4.0e18)) {
+                    LOG(ERROR) << "the cell size is too small for the extent of the points: " << cell_size;
+                    return false;
+                }
+                num_cells[axis] = static_cast<uint64_t>(extent) + 1;
+                shifts[axis] = key_bits;
+                key_bits += num_bits(num_cells[axis]);
+            }
+            if (key_bits > 64) {
+                LOG(ERROR) << "the cell size is too small for the extent of the points: " << cell_size
+                           << " (the cells need " << key_bits << " bits)";
+                return false;
+            }
+
+            const vec3 origin = box.min();
+            const double inv_cell_size = 1.0 / cell_size;
+            std::vector<CellItem> items(num);
+            for_each_range(pool, num, num_ranges, [&](std::size_t begin, std::size_t end, std::size_t) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    uint64_t key = 0;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        const double c = (double(points[i][axis]) - origin[axis]) * inv_cell_size;
+                        const uint64_t cell = std::min(static_cast<uint64_t>(std::max(c, 0.0)), num_cells[axis] - 1);
+                        key |= cell << shifts[axis];
+                    }
+                    items[i].key = key;
+                    items[i].index = static_cast<int>(i);
+                }
+            });
+
+            radix_sort(items, key_bits, pool, num_ranges);
+
+            // the cells start where the keys change: each range counts its starts first, and then writes them
+            std::vector<std::size_t> starts(num_ranges + 1, 0);
+            indices.resize(num);
+            for_each_range(pool, num, num_ranges, [&](std::size_t begin, std::size_t end, std::size_t r) {
+                std::size_t count = 0;
+                for (std::size_t i = begin; i < end; ++i) {
+                    if (i == 0 || items[i].key != items[i - 1].key)
+                        ++count;
+                    indices[i] = items[i].index;
+                }
+                starts[r + 1] = count;
+            });
+            for (std::size_t r = 0; r < num_ranges; ++r)
+                starts[r + 1] += starts[r];
+
+            offsets.resize(starts[num_ranges] + 1);
+            offsets.back() = num;
+            for_each_range(pool, num, num_ranges, [&](std::size_t begin, std::size_t end, std::size_t r) {
+                std::size_t cell = starts[r];
+                for (std::size_t i = begin; i < end; ++i) {
+                    if (i == 0 || items[i].key != items[i - 1].key)
+                        offsets[cell++] = i;
+                }
+            });
+            return true;
+        }
+
+
+        // the number of ranges that 'num' elements are split into for 'num_threads' threads
+        inline std::size_t num_ranges_of(std::size_t num, int num_threads) {
+            return std::max<std::size_t>(1, std::min<std::size_t>(num_threads, num / kChunkSize));
+        }
+
+    }
+
+
+    bool PointCloudSimplification::grid_cells(const std::vector<vec3> &points, float cell_size,
+                                              std::vector<std::size_t> &offsets, std::vector<int> &indices,
+                                              int num_threads)
+    {
+        const std::size_t num_ranges = num_ranges_of(points.size(), GetEffectiveNumThreads(num_threads));
+        if (num_ranges <= 1)
+            return compute_cells(points, cell_size, nullptr, 1, offsets, indices);
+
+        ThreadPool pool(static_cast<int>(num_ranges));
+        return compute_cells(points, cell_size, &pool, num_ranges, offsets, indices);
+    }
+
+
+    bool PointCloudSimplification::grid_simplification(PointCloud *cloud, float cell_size,
+                                                       Representative representative, int num_threads)
+    {
+        if (!cloud || cloud->empty()) {
+            LOG(WARNING) << "empty input point cloud";
+            return false;
+        }
+
+        // the deleted points would be counted in the cells
+        if (cloud->n_vertices() != cloud->vertices_size())
+            cloud->garbage_collection();
+
+        std::vector<vec3>& points = cloud->points();
+        const std::size_t num = points.size();
+        const std::size_t num_ranges = num_ranges_of(num, GetEffectiveNumThreads(num_threads));
+        std::unique_ptr<ThreadPool> pool(num_ranges > 1 ? new ThreadPool(static_cast<int>(num_ranges)) : nullptr);
+
+        std::vector<std::size_t> offsets;
+        std::vector<int> indices;
+        if (!compute_cells(points, cell_size, pool.get(), num_ranges, offsets, indices))
+            return false;
+
+        PointCloud::VertexProperty<vec3> colors = cloud->get_vertex_property<vec3>("v:color");
+        PointCloud::VertexProperty<vec3> normals = cloud->get_vertex_property<vec3>("v:normal");
+        const bool average = (representative == CENTROID);
+
+        // Each cell is reduced to its point nearest to the centroid (the first one for ties). The cells are disjoint,
+        // so the ranges of cells are processed concurrently.
+        std::vector<unsigned char> keep(num, 0);
+        const std::size_t num_cells = offsets.size() - 1;
+        for_each_range(pool.get(), num_cells, num_ranges_of(num_cells, static_cast<int>(num_ranges)),
+                       [&](std::size_t begin, std::size_t end, std::size_t) {
+            for (std::size_t c = begin; c < end; ++c) {
+                const int* first = indices.data() + offsets[c];
+                const int* last = indices.data() + offsets[c + 1];
+                const double inv_count = 1.0 / double(last - first);
+
+                double center[3] = {0, 0, 0};
+                for (const int* id = first; id != last; ++id) {
+                    const vec3& p = points[*id];
+                    center[0] += p.x;   center[1] += p.y;   center[2] += p.z;
+                }
+                const vec3 centroid(float(center[0] * inv_count), float(center[1] * inv_count),
+                                    float(center[2] * inv_count));
+
+                int nearest = *first;
+                float min_dist = distance2(points[nearest], centroid);
+                for (const int* id = first + 1; id != last; ++id) {
+                    const float dist = distance2(points[*id], centroid);
+                    if (dist < min_dist) {
+                        min_dist = dist;
+                        nearest = *id;
+                    }
+                }
+                keep[nearest] = 1;
+
+                if (!average || last - first == 1)
+                    continue;
+
+                points[nearest] = centroid;
+                if (colors) {
+                    double sum[3] = {0, 0, 0};
+                    for (const int* id = first; id != last; ++id) {
+                        const vec3& color = colors[PointCloud::Vertex(*id)];
+                        sum[0] += color.r;  sum[1] += color.g;  sum[2] += color.b;
+                    }
+                    colors[PointCloud::Vertex(nearest)] = vec3(float(sum[0] * inv_count), float(sum[1] * inv_count),
+                                                               float(sum[2] * inv_count));
+                }
+                if (normals) {
+                    const vec3 reference = normals[PointCloud::Vertex(nearest)];
+                    vec3 sum(0, 0, 0);
+                    for (const int* id = first; id != last; ++id) {
+                        const vec3& n = normals[PointCloud::Vertex(*id)];
+                        sum += (dot(n, reference) < 0.0f) ? -n : n;
+                    }
+                    if (length2(sum) > 0.0f)
+                        normals[PointCloud::Vertex(nearest)] = normalize(sum);
+                }
+            }
+        });
+        pool.reset();
+
+        for (std::size_t i = 0; i < num; ++i) {
+            if (!keep[i])
+                cloud->delete_vertex(PointCloud::Vertex(static_cast<int>(i)));
+        }
+        cloud->garbage_collection();
+        return true;
+    }
+
+}
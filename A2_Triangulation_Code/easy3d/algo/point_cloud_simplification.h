@@ -0,0 +1,77 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EASY3D_ALGO_POINT_CLOUD_SIMPLIFICATION_H
+#define EASY3D_ALGO_POINT_CLOUD_SIMPLIFICATION_H
+
+#include <easy3d/core/types.h>
+#include <vector>
+
+
+/**
+PointCloudSimplification reduces the density of a point cloud with a voxel grid, i.e., the points in each cell of the
+grid are replaced by one point.
+
+    PointCloudSimplification::grid_simplification(cloud, 0.01f);   // at most one point per 1cm cell
+
+The points are grouped by a spatial hash (the coordinates of their cells packed into an integer key), sorted by a
+parallel radix sort, so the points of a cell are consecutive and each cell is reduced independently.
+*/
+
+
+namespace easy3d {
+
+    class PointCloud;
+
+    class PointCloudSimplification {
+    public:
+        /// the point that represents a cell
+        enum Representative {
+            CENTROID,               // the average of the points, and of their colors and normals
+            NEAREST_TO_CENTROID     // the point that is the closest to the centroid, with all its properties
+        };
+
+    public:
+        /// Keeps one point in each cell of a grid (of cubic cells of size 'cell_size') by deleting the others. The
+        /// kept point (i.e., the one nearest to the centroid of the cell) carries all its vertex properties. For
+        /// CENTROID, its position, color ("v:color"), and normal ("v:normal") are then replaced by the averages of the
+        /// cell (the normals are flipped to agree with the kept one before they are averaged, so unoriented normals
+        /// don't cancel out). The order of the remaining points changes.
+        /// @param num_threads: the number of threads (all the logical cores if it is not positive).
+        /// @return false if the cell size is not positive or too small for the extent of the points.
+        static bool grid_simplification(PointCloud *cloud, float cell_size, Representative representative = CENTROID,
+                                        int num_threads = -1);
+
+        /// Groups the points by the cells of a grid (of cubic cells of size 'cell_size'), in compressed rows: the
+        /// points of the i_th non-empty cell are indices[offsets[i]], ..., indices[offsets[i + 1] - 1]. The cells are
+        /// sorted by their coordinates (x varies fastest), and the points of each cell by their indices.
+        /// @return false if the cell size is not positive or too small for the extent of the points.
+        static bool grid_cells(const std::vector<vec3> &points, float cell_size,
+                               std::vector<std::size_t> &offsets, std::vector<int> &indices, int num_threads = -1);
+    };
+
+}
+
+#endif  // EASY3D_ALGO_POINT_CLOUD_SIMPLIFICATION_H
@@ -65,7 +65,7 @@ namespace easy3d {
         FT	axis_[DIM][DIM];
         FT	eigen_value_[DIM];
 
-        FT**    M_;
+        FT      M_[DIM][DIM];   // fixed size, so no memory is allocated (e.g., for the neighborhoods of many points)
         int		nb_points_;
         FT		sum_weights_;
     } ;
@@ -82,17 +82,11 @@ namespace easy3d {
 
     template <int DIM, typename FT>
     PrincipalAxes<DIM, FT>::PrincipalAxes() {
-        M_ = new FT*[DIM];
-        for (unsigned short i = 0; i < DIM; ++i)
-            M_[i] = new FT[DIM];
     }
 
 
     template <int DIM, typename FT>
     PrincipalAxes<DIM, FT>::~PrincipalAxes() {
-        for (unsigned short i = 0; i < DIM; ++i)
-            delete[] M_[i];
-        delete[] M_;
     }
 
 
@@ -153,13 +147,15 @@ namespace easy3d {
                     M_[i][i] = std::numeric_limits<FT>::min();
             }
 
-            EigenSolver<FT> solver(DIM);
-            solver.solve(M_, EigenSolver<FT>::DECREASING);
+            FT* rows[DIM];
+            for (unsigned short i = 0; i < DIM; ++i)
+                rows[i] = M_[i];
+            FT subd[DIM];
+            EigenSolver<FT>::solve(DIM, rows, eigen_value_, subd, EigenSolver<FT>::DECREASING);
 
             for (unsigned short i=0; i<DIM; ++i) {
-                eigen_value_[i] = solver.eigen_value(i);
                 for (unsigned short j=0; j<DIM; ++j)
-                    axis_[i][j] = solver.eigen_vector(j, i); // eigenvectors are stored in columns
+                    axis_[i][j] = M_[j][i]; // eigenvectors are stored in columns
             }
 
             // Normalize the eigen vectors
@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_RQ_DECOMPOSITION_H
+#define EASY3D_RQ_DECOMPOSITION_H
+
+
+namespace easy3d {
+
+    /**
+     * RQ decomposition of a 3 by 3 matrix, i.e., A = K * R, where K is upper triangular with a non-negative diagonal
+     * and R is orthonormal. It uses three Givens rotations (Hartley and Zisserman, Multiple View Geometry, A4.1.1)
+     * on fixed-size arrays, so it doesn't allocate and takes a constant number of operations.
+     * @param A The input matrix.
+     * @param K Returns the upper triangular matrix.
+     * @param R Returns the orthonormal matrix. det(R) has the same sign as det(A).
+     */
+    template <typename FT>
+    void rq_decompose(const FT A[3][3], FT K[3][3], FT R[3][3]);
+
+
+    /**
+     * Decompose a 3 by 4 camera projection matrix M = s * K * [R, t] into the intrinsic matrix K (with K[2][2] = 1),
+     * the rotation R (with det(R) = 1), and the translation t. The unknown scale s (which can be negative, e.g., when
+     * M is the null vector of a linear system) is factored out by the sign of det(M[:, 0:3]).
+     * @param M The 3 by 4 projection matrix.
+     * @param K Returns the 3 by 3 intrinsic matrix, i.e., [fx, skew, cx; 0, fy, cy; 0, 0, 1].
+     * @param R Returns the 3 by 3 rotation matrix.
+     * @param t Returns the translation vector.
+     * @return false if M is degenerate (i.e., the left 3 by 3 block of M is singular).
+     */
+    template <typename FT>
+    bool decompose_projection(const FT M[3][4], FT K[3][3], FT R[3][3], FT t[3]);
+
+} // namespace easy3d
+
+
+#include <cmath>
+
+
+namespace easy3d {
+
+    namespace details {
+
+        // Computes the Givens rotation (c, s) such that b * c + a * s = 0 and c^2 + s^2 = 1. The signs of the
+        // resulting diagonal entries are not controlled here, they are fixed after all three rotations.
+        template <typename FT>
+        inline void givens(FT a, FT b, FT &c, FT &s) {
+            const FT r = std::sqrt(a * a + b * b);
+            if (r == FT(0)) {   // nothing to eliminate
+                c = FT(1);
+                s = FT(0);
+                return;
+            }
+            c = -a / r;
+            s = b / r;
+        }
+
+    } // namespace details
+
+
+    template <typename FT>
+    void rq_decompose(const FT A[3][3], FT K[3][3], FT R[3][3]) {
+        FT B[3][3];
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                B[i][j] = A[i][j];
+
+        // Q accumulates the transposed rotations, so that A = B * Q holds after each step.
+        FT Q[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        FT c, s;
+
+        // Qx = [1, 0, 0; 0, c, -s; 0, s, c] sets B[2][1] to zero.
+        details::givens(B[2][2], B[2][1], c, s);
+        for (int i = 0; i < 3; ++i) {
+            const FT b1 = B[i][1], b2 = B[i][2];
+            B[i][1] = b1 * c + b2 * s;
+            B[i][2] = -b1 * s + b2 * c;
+            const FT q1 = Q[1][i], q2 = Q[2][i];
+            Q[1][i] = c * q1 + s * q2;
+            Q[2][i] = -s * q1 + c * q2;
+        }
+
+        // Qy = [c, 0, s; 0, 1, 0; -s, 0, c] sets B[2][0] to zero.
+        details::givens(B[2][2], -B[2][0], c, s);
+        for (int i = 0; i < 3; ++i) {
+            const FT b0 = B[i][0], b2 = B[i][2];
+            B[i][0] = b0 * c - b2 * s;
+            B[i][2] = b0 * s + b2 * c;
+            const FT q0 = Q[0][i], q2 = Q[2][i];
+            Q[0][i] = c * q0 - s * q2;
+            Q[2][i] = s * q0 + c * q2;
+        }
+
+        // Qz = [c, -s, 0; s, c, 0; 0, 0, 1] sets B[1][0] to zero.
+        details::givens(B[1][1], B[1][0], c, s);
+        for (int i = 0; i < 3; ++i) {
+            const FT b0 = B[i][0], b1 = B[i][1];
+            B[i][0] = b0 * c + b1 * s;
+            B[i][1] = -b0 * s + b1 * c;
+            const FT q0 = Q[0][i], q1 = Q[1][i];
+            Q[0][i] = c * q0 + s * q1;
+            Q[1][i] = -s * q0 + c * q1;
+        }
+
+        // Make the diagonal of K non-negative: K = B * D and R = D * Q, with D = diag(+/-1) and D * D = I.
+        for (int j = 0; j < 3; ++j) {
+            const FT d = (B[j][j] < FT(0)) ? FT(-1) : FT(1);
+            for (int i = 0; i < 3; ++i) {
+                K[i][j] = (i <= j) ? B[i][j] * d : FT(0);
+                R[j][i] = Q[j][i] * d;
+            }
+        }
+    }
+
+
+    template <typename FT>
+    bool decompose_projection(const FT M[3][4], FT K[3][3], FT R[3][3], FT t[3]) {
+        const FT det = M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+                       - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+                       + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0]);
+        if (det == FT(0))
+            return false;
+
+        // a proper camera has det(K * R) > 0, so a negative determinant means M has a negative scale.
+        const FT sign = (det < FT(0)) ? FT(-1) : FT(1);
+        FT A[3][3], b[3];
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j)
+                A[i][j] = sign * M[i][j];
+            b[i] = sign * M[i][3];
+        }
+
+        rq_decompose(A, K, R);
+
+        // t = (s * K)^-1 * b by back substitution, then normalize K so that K[2][2] = 1
+        t[2] = b[2] / K[2][2];
+        t[1] = (b[1] - K[1][2] * t[2]) / K[1][1];
+        t[0] = (b[0] - K[0][1] * t[1] - K[0][2] * t[2]) / K[0][0];
+
+        const FT scale = K[2][2];
+        for (int i = 0; i < 3; ++i)
+            for (int j = i; j < 3; ++j)
+                K[i][j] /= scale;
+        return true;
+    }
+
+} // namespace easy3d
+
+
+#endif  // EASY3D_RQ_DECOMPOSITION_H
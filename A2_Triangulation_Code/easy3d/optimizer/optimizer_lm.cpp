@@ -25,7 +25,9 @@
 
 #include <easy3d/optimizer/optimizer_lm.h>
 #include <cminpack.h>
-#include <cstdio>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
 
 namespace easy3d {
 
@@ -61,6 +63,120 @@ namespace easy3d {
         xtol = 1.e-14;
         gtol = 1.e-14;
         nprint = 0;
+        fnorm = 0.0;
+        nfev = 0;
+        info = 0;
+        listener = nullptr;
+        cancel = nullptr;
+        max_seconds = 0.0;
+        max_evaluations = 0;
+        loss = nullptr;
+        termination = INVALID_INPUT;
+    }
+
+
+    namespace {
+
+        // Sits between lmdif() and the objective if a listener, a cancellation token, a budget, or a loss is set. It
+        // counts the evaluations, applies the loss, reports to the listener, and asks lmdif() to stop (by a negative
+        // return value) when needed. lmdif() reports (iflag = 0) each accepted iterate before it perturbs x for the
+        // Jacobian, so the monitor keeps a copy of it to restore x if it stops the optimization in the middle of the
+        // Jacobian.
+        class Monitor {
+        public:
+            Monitor(Objective_LM *func, const Optimizer_LM::Parameters &param, const double *damping)
+                    : func_(func), param_(param), damping_(damping), evaluations_(0), reports_(0), iterations_(0),
+                      stop_(Optimizer_LM::INVALID_INPUT), start_(std::chrono::steady_clock::now()),
+                      previous_x_(func->num_variables()), accepted_x_(func->num_variables()) {}
+
+            int evaluate(const double *x, double *fvec, int iflag) {
+                if (iflag == 0)     // lmdif() only reports the current state
+                    return report(x, fvec);
+
+                if (param_.cancel && param_.cancel->is_cancelled())
+                    return stop(Optimizer_LM::CANCELLED);
+                if (param_.max_evaluations > 0 && evaluations_ >= param_.max_evaluations)
+                    return stop(Optimizer_LM::EVALUATION_BUDGET_EXCEEDED);
+                if (param_.max_seconds > 0.0 && seconds() > param_.max_seconds)
+                    return stop(Optimizer_LM::TIME_BUDGET_EXCEEDED);
+
+                ++evaluations_;
+                const int status = func_->evaluate(x, fvec);
+                if (status < 0)
+                    return stop(Optimizer_LM::STOPPED_BY_OBJECTIVE);
+                if (param_.loss)
+                    param_.loss->apply(fvec, func_->num_function());
+                return status;
+            }
+
+            int evaluations() const { return evaluations_; }
+
+            // the reason if the monitor stopped the optimization, otherwise INVALID_INPUT
+            Optimizer_LM::Termination stopped() const { return stop_; }
+
+            // copies the last accepted iterate to x (x is left untouched if lmdif() stopped before the first one)
+            void restore(double *x) const {
+                if (iterations_ > 0)
+                    std::copy(accepted_x_.begin(), accepted_x_.end(), x);
+            }
+
+        private:
+            int report(const double *x, const double *fvec) {
+                const int m = func_->num_function();
+                const int n = func_->num_variables();
+                // after a stop, lmdif() reports the x it was evaluating, which may be a perturbed one
+                if (stop_ != Optimizer_LM::INVALID_INPUT)
+                    return 0;
+                std::copy(x, x + n, accepted_x_.begin());
+                const int iteration = iterations_++;
+                if (!param_.listener || iteration % std::max(1, param_.nprint) != 0)
+                    return 0;
+
+                double cost = 0.0;
+                for (int i = 0; i < m; ++i)
+                    cost += fvec[i] * fvec[i];
+                double step = 0.0;
+                if (reports_ > 0) {
+                    for (int i = 0; i < n; ++i)
+                        step += (x[i] - previous_x_[i]) * (x[i] - previous_x_[i]);
+                }
+                std::copy(x, x + n, previous_x_.begin());
+
+                IterationInfo info;
+                info.iteration = iteration;
+                info.cost = cost;
+                info.step_norm = std::sqrt(step);
+                info.damping = *damping_;
+                info.seconds = seconds();
+                info.evaluations = evaluations_;
+                info.x = x;
+                ++reports_;
+
+                return param_.listener->iteration(info) ? 0 : stop(Optimizer_LM::STOPPED_BY_LISTENER);
+            }
+
+            int stop(Optimizer_LM::Termination reason) {
+                stop_ = reason;
+                return -1;
+            }
+
+            double seconds() const {
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+            }
+
+        private:
+            Objective_LM *func_;
+            const Optimizer_LM::Parameters &param_;
+            const double *damping_;     // the Levenberg-Marquardt parameter, updated by lmdif() before each report
+            int evaluations_;
+            int reports_;
+            int iterations_;
+            Optimizer_LM::Termination stop_;
+            std::chrono::steady_clock::time_point start_;
+            std::vector<double> previous_x_;
+            std::vector<double> accepted_x_;
+        };
+
     }
 
 
@@ -106,11 +222,29 @@ namespace easy3d {
             return reinterpret_cast<Optimizer_LM *>(instance)->func_->evaluate(var, fvec);
         };
 
+        // the objective is called directly unless the optimization has to be monitored
+        const bool monitored = param->listener || param->cancel || param->max_seconds > 0.0 ||
+                               param->max_evaluations > 0 || param->loss;
+        double damping = 0.0;
+        Monitor *monitor = monitored ? new Monitor(func, *param, &damping) : nullptr;
+        auto monitored_func = [](void *instance, int num_fun, int num_var, const double *var, double *fvec,
+                                 int iflag) -> int {
+            return reinterpret_cast<Monitor *>(instance)->evaluate(var, fvec, iflag);
+        };
+        cminpack_func_mn fcn = evaluate_func;
+        void *instance = this;
+        if (monitor) {
+            fcn = monitored_func;
+            instance = monitor;
+        }
+        // the monitor needs every iterate (it decides itself how often the listener is called)
+        const int nprint = monitor ? 1 : param->nprint;
+
         // this goes through the modified legacy interface:
         param->info =
                 lmdif(
-                        evaluate_func,
-                        this,
+                        fcn,
+                        instance,
                         m,
                         n,
                         x,
@@ -123,7 +257,7 @@ namespace easy3d {
                         diag,
                         1,
                         param->stepbound,
-                        param->nprint,
+                        nprint,
                         &(param->nfev),
                         fjac,
                         m,
@@ -132,12 +266,26 @@ namespace easy3d {
                         wa1,
                         wa2,
                         wa3,
-                        wa4
+                        wa4,
+                        &damping
                 );
 
+        if (param->info < 0) {
+            param->termination = monitor ? monitor->stopped() : STOPPED_BY_OBJECTIVE;
+            // x may have been perturbed for the Jacobian when the optimization was stopped
+            if (monitor)
+                monitor->restore(x);
+        }
+        else
+            param->termination = static_cast<Termination>(param->info);
         if (param->info >= 8)
             param->info = 4;
 
+        param->fnorm = 0.0;
+        for (int i = 0; i < m; ++i)
+            param->fnorm += fvec[i] * fvec[i];
+        param->fnorm = std::sqrt(param->fnorm);
+
         // *** clean up.
 
         delete[](fvec);
@@ -149,10 +297,20 @@ namespace easy3d {
         delete[](wa3);
         delete[](wa4);
         delete[](ipvt);
-
-        printf("LM optimization terminated with status code = %d. num_iter = %d\n", param->info, param->nfev);
-
-        return true;
+        delete monitor;
+
+        switch (param->termination) {
+            case CONVERGED_FTOL:
+            case CONVERGED_XTOL:
+            case CONVERGED_FTOL_XTOL:
+            case CONVERGED_GTOL:
+            case FTOL_TOO_SMALL:
+            case XTOL_TOO_SMALL:
+            case GTOL_TOO_SMALL:
+                return true;
+            default:
+                return false;
+        }
     }
 
 
@@ -160,4 +318,39 @@ namespace easy3d {
         return optimize(func, x.data(), param);
     }
 
+
+    const char *Optimizer_LM::termination_message(Termination reason) {
+        switch (reason) {
+            case INVALID_INPUT:
+                return "improper input parameters";
+            case CONVERGED_FTOL:
+                return "converged: the relative reduction of the sum of squares is at most ftol";
+            case CONVERGED_XTOL:
+                return "converged: the relative change of the variables is at most xtol";
+            case CONVERGED_FTOL_XTOL:
+                return "converged: both the sum of squares and the variables have settled";
+            case CONVERGED_GTOL:
+                return "converged: the functions are orthogonal to the Jacobian up to gtol";
+            case MAX_CALLS_REACHED:
+                return "the maximum number of calls was reached";
+            case FTOL_TOO_SMALL:
+                return "ftol is too small: no further reduction of the sum of squares is possible";
+            case XTOL_TOO_SMALL:
+                return "xtol is too small: no further improvement of the variables is possible";
+            case GTOL_TOO_SMALL:
+                return "gtol is too small: the functions are orthogonal to the Jacobian to machine precision";
+            case CANCELLED:
+                return "cancelled";
+            case TIME_BUDGET_EXCEEDED:
+                return "the time budget was exceeded";
+            case EVALUATION_BUDGET_EXCEEDED:
+                return "the evaluation budget was exceeded";
+            case STOPPED_BY_LISTENER:
+                return "stopped by the listener";
+            case STOPPED_BY_OBJECTIVE:
+                return "stopped by the objective";
+        }
+        return "unknown";
+    }
+
 }
\ No newline at end of file
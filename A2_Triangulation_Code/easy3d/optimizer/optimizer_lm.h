@@ -27,6 +27,9 @@
 #define EASY3D_OPTIMIZER_LM_H
 
 #include <vector>
+#include <atomic>
+
+#include <easy3d/optimizer/robust_loss.h>
 
 /**
 Optimizer_LM for nonlinear least squares problems using Levenberg-Marquardt method.
@@ -96,6 +99,27 @@ Where:
         // the results are: -0.664837  0.807553
         return status;
      }
+
+*********************************
+
+3) monitoring and stopping an optimization
+
+    class Progress : public IterationListener {
+    public:
+        bool iteration(const IterationInfo &info) {
+            std::cout << info.iteration << ": cost " << info.cost << ", step " << info.step_norm << std::endl;
+            return true;    // return false to stop
+        }
+    };
+
+    Progress progress;
+    CancellationToken token;        // token.cancel() can be called from any other thread
+    Optimizer_LM::Parameters param;
+    param.listener = &progress;
+    param.cancel = &token;
+    param.max_seconds = 0.5;        // give up after half a second
+    bool converged = lm.optimize(&obj, x, &param);
+    std::cout << Optimizer_LM::termination_message(param.termination) << std::endl;
 */
 
 
@@ -136,6 +160,45 @@ namespace easy3d {
     };
 
 
+    /// the state of an optimization after an iteration, see IterationListener
+    struct IterationInfo {
+        int iteration;      // the number of iterations so far.
+        double cost;        // the sum of the squared function values at x.
+        double step_norm;   // the norm of the change of x since the previous report.
+        double damping;     // the damping of the step (e.g., the Levenberg-Marquardt parameter), negative if unknown.
+        double seconds;     // the wall time since the optimization started.
+        int evaluations;    // the number of evaluations of the functions so far.
+        const double *x;    // the current values of the variables.
+    };
+
+
+    /// receives the progress of an optimization
+    class IterationListener {
+    public:
+        virtual ~IterationListener() {}
+
+        /// called after each iteration (or every Parameters::nprint iterations).
+        /// @return false to stop the optimization.
+        virtual bool iteration(const IterationInfo &info) = 0;
+    };
+
+
+    /// a flag to cancel running optimizations, e.g., from another thread
+    class CancellationToken {
+    public:
+        CancellationToken() : cancelled_(false) {}
+
+        void cancel() { cancelled_ = true; }
+
+        void reset() { cancelled_ = false; }
+
+        bool is_cancelled() const { return cancelled_; }
+
+    private:
+        std::atomic<bool> cancelled_;
+    };
+
+
     /// the optimizer
     class Optimizer_LM {
     public:
@@ -143,6 +206,24 @@ namespace easy3d {
 
         virtual ~Optimizer_LM();
 
+        /// why an optimization stopped. The first ones are the status codes of cminpack's lmdif().
+        enum Termination {
+            INVALID_INPUT = 0,          // improper input parameters.
+            CONVERGED_FTOL = 1,         // the relative reduction of the sum of squares is at most ftol.
+            CONVERGED_XTOL = 2,         // the relative change of x is at most xtol.
+            CONVERGED_FTOL_XTOL = 3,    // both of the above.
+            CONVERGED_GTOL = 4,         // fvec is orthogonal to the columns of the Jacobian up to gtol.
+            MAX_CALLS_REACHED = 5,      // the number of evaluations reached maxcall * (num_variables + 1).
+            FTOL_TOO_SMALL = 6,         // no further reduction of the sum of squares is possible.
+            XTOL_TOO_SMALL = 7,         // no further improvement of x is possible.
+            GTOL_TOO_SMALL = 8,         // fvec is orthogonal to the columns of the Jacobian to machine precision.
+            CANCELLED,                  // the cancellation token was set.
+            TIME_BUDGET_EXCEEDED,       // it ran longer than max_seconds.
+            EVALUATION_BUDGET_EXCEEDED, // the functions were evaluated max_evaluations times.
+            STOPPED_BY_LISTENER,        // the listener returned false.
+            STOPPED_BY_OBJECTIVE        // Objective_LM::evaluate() returned a negative value.
+        };
+
         // parameters for calling the high-level interface functions
         struct Parameters {
             Parameters();
@@ -152,11 +233,18 @@ namespace easy3d {
             double gtol;        // orthogonality desired between fvec and its derivs.
             double epsilon;    // step used to calculate the Jacobian.
             double stepbound;    // initial bound to steps in the outer loop.
-            double fnorm;        // norm of the residue vector fvec.
+            double fnorm;        // norm of the residue vector fvec (i.e., the square root of the robust cost if loss is set).
             int maxcall;        // maximum number of iterations.
             int nfev;            // actual number of iterations.
-            int nprint;        // desired frequency of print outs.
+            int nprint;        // desired frequency of reports to the listener (every iteration if not positive).
             int info;            // status of minimization.
+
+            IterationListener *listener;    // receives the progress (none by default).
+            const CancellationToken *cancel; // stops the optimization when it is cancelled (none by default).
+            double max_seconds;             // the time budget in seconds (unlimited if not positive).
+            int max_evaluations;            // the budget of function evaluations (unlimited if not positive).
+            const RobustLoss *loss;         // the loss of the residuals (the squared error by default).
+            Termination termination;        // why the optimization stopped.
         };
 
     public:
@@ -164,10 +252,17 @@ namespace easy3d {
         //  func:   your evaluate function (no need to provide Jacobian)
         //  x:      the variable vector (should be initialized with guess), which also returns the result.
         //  param:  parameter for the optimizer (use default parameters if para is null).
+        //  return: true if it converged (i.e., CONVERGED_* or *_TOO_SMALL), see Parameters::termination for why it
+        //          stopped. x carries the best solution found so far (i.e., the last accepted iterate) in any case.
+        // The listener, the cancellation token, the budgets, and the loss are handled only if they are set, so they don't
+        // cost anything otherwise.
         bool optimize(Objective_LM *func, double *x, Parameters *para = nullptr);
 
         bool optimize(Objective_LM *func, std::vector<double> &x, Parameters *para = nullptr);
 
+        /// a human-readable description of a termination reason
+        static const char *termination_message(Termination reason);
+
     private:
         Parameters default_control_;        // control of this object
         Objective_LM *func_;
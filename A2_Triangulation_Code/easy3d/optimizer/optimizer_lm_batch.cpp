@@ -0,0 +1,236 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <easy3d/optimizer/optimizer_lm_batch.h>
+#include <easy3d/util/threading.h>
+#include <cminpack.h>
+
+#include <mutex>
+#include <thread>
+#include <iostream>
+#include <algorithm>
+
+
+namespace easy3d {
+
+
+    namespace {
+
+        // the work space of lmdif(), allocated once per thread and reused by all its problems
+        struct Workspace {
+            Workspace(int m, int n)
+                    : fvec(m), diag(n), fjac(n * m), qtf(n), wa1(n), wa2(n), wa3(n), wa4(m), ipvt(n) {}
+
+            std::vector<double> fvec, diag, fjac, qtf, wa1, wa2, wa3, wa4;
+            std::vector<int> ipvt;
+        };
+
+
+        // the problems [begin, end) not processed yet by a thread
+        struct Range {
+            Range() : begin(0), end(0) {}
+
+            std::size_t begin;
+            std::size_t end;
+            std::mutex mutex;
+        };
+
+
+        // Takes the next problem of the thread's own range. If it is empty, half of the largest remaining range of the
+        // other threads is stolen. Returns false if there is no problem left at all.
+        bool next_problem(std::vector<Range> &ranges, std::size_t self, std::size_t &problem) {
+            {
+                std::lock_guard<std::mutex> lock(ranges[self].mutex);
+                if (ranges[self].begin < ranges[self].end) {
+                    problem = ranges[self].begin++;
+                    return true;
+                }
+            }
+
+            while (true) {
+                // the victim is the one with the most problems left (its range may shrink as soon as it is
+                // unlocked, so it is only a hint)
+                std::size_t victim = self, most = 0;
+                for (std::size_t i = 0; i < ranges.size(); ++i) {
+                    if (i == self)
+                        continue;
+                    std::lock_guard<std::mutex> lock(ranges[i].mutex);
+                    const std::size_t left = ranges[i].end - ranges[i].begin;
+                    if (left > most) {
+                        most = left;
+                        victim = i;
+                    }
+                }
+                if (victim == self)
+                    return false;
+
+                std::size_t begin, end;
+                {
+                    std::lock_guard<std::mutex> lock(ranges[victim].mutex);
+                    const std::size_t left = ranges[victim].end - ranges[victim].begin;
+                    if (left == 0)
+                        continue;   // it was finished meanwhile, look for another one
+                    end = ranges[victim].end;
+                    begin = end - (left + 1) / 2;
+                    ranges[victim].end = begin;
+                }
+
+                std::lock_guard<std::mutex> lock(ranges[self].mutex);
+                ranges[self].begin = begin + 1;
+                ranges[self].end = end;
+                problem = begin;
+                return true;
+            }
+        }
+
+
+        // the problems given as separate objectives
+        class ProblemList : public Objective_LM_Batch {
+        public:
+            explicit ProblemList(const std::vector<Objective_LM *> &problems)
+                    : Objective_LM_Batch(problems[0]->num_function(), problems[0]->num_variables()),
+                      problems_(problems) {}
+
+            int evaluate(std::size_t problem, const double *x, double *fvec) const {
+                return problems_[problem]->evaluate(x, fvec);
+            }
+
+        private:
+            const std::vector<Objective_LM *> &problems_;
+        };
+
+
+        // a problem of the batch, whose residuals are passed through the robust loss (if any)
+        struct Problem {
+            const Objective_LM_Batch *objective;
+            std::size_t index;
+            const RobustLoss *loss;
+        };
+
+
+        void solve(const Problem &problem, double *x, Workspace &ws, const Optimizer_LM::Parameters &param,
+                   Optimizer_LM_Batch::Result &result) {
+            // the loss is applied to the residuals before lmdif() sees them
+            auto evaluate_func = [](void *instance, int num_fun, int num_var, const double *var, double *fvec,
+                                    int iflag) -> int {
+                const Problem *p = reinterpret_cast<const Problem *>(instance);
+                const int status = p->objective->evaluate(p->index, var, fvec);
+                if (status >= 0 && p->loss)
+                    p->loss->apply(fvec, num_fun);
+                return status;
+            };
+            cminpack_func_mn fcn = evaluate_func;
+            void *instance = const_cast<Problem *>(&problem);
+
+            const int m = problem.objective->num_function();
+            const int n = problem.objective->num_variables();
+            result.nfev = 0;
+            result.info = lmdif(fcn, instance, m, n, x, ws.fvec.data(), param.ftol, param.xtol, param.gtol,
+                                param.maxcall * (n + 1), param.epsilon, ws.diag.data(), 1, param.stepbound,
+                                param.nprint, &result.nfev, ws.fjac.data(), m, ws.ipvt.data(), ws.qtf.data(),
+                                ws.wa1.data(), ws.wa2.data(), ws.wa3.data(), ws.wa4.data(), nullptr);
+            if (result.info >= 8)
+                result.info = 4;
+        }
+
+    }
+
+
+    Optimizer_LM_Batch::Optimizer_LM_Batch(int num_threads) {
+        num_threads_ = num_threads > 0 ? num_threads : static_cast<int>(std::thread::hardware_concurrency());
+        if (num_threads_ < 1)
+            num_threads_ = 1;
+        // the calling thread is one of the workers
+        pool_ = num_threads_ > 1 ? new ThreadPool(num_threads_ - 1) : nullptr;
+    }
+
+
+    Optimizer_LM_Batch::~Optimizer_LM_Batch() {
+        delete pool_;
+    }
+
+
+    bool Optimizer_LM_Batch::optimize(const std::vector<Objective_LM *> &problems, std::vector<double> &x,
+                                      std::vector<Result> &results, const Optimizer_LM::Parameters *param) {
+        results.clear();
+        if (problems.empty())
+            return true;
+
+        const int m = problems[0]->num_function();
+        const int n = problems[0]->num_variables();
+        for (std::size_t i = 1; i < problems.size(); ++i) {
+            if (problems[i]->num_function() != m || problems[i]->num_variables() != n) {
+                std::cerr << "could not optimize: the problems don't have the same structure" << std::endl;
+                return false;
+            }
+        }
+        const ProblemList objective(problems);
+        return optimize(&objective, problems.size(), x, results, param);
+    }
+
+
+    bool Optimizer_LM_Batch::optimize(const Objective_LM_Batch *objective, std::size_t num_problems,
+                                      std::vector<double> &x, std::vector<Result> &results,
+                                      const Optimizer_LM::Parameters *param) {
+        results.clear();
+        if (num_problems == 0)
+            return true;
+
+        const int n = objective->num_variables();
+        const int m = objective->num_function();
+        if (x.size() != num_problems * n) {
+            std::cerr << "could not optimize: the size of x doesn't match the number of problems" << std::endl;
+            return false;
+        }
+
+        const Optimizer_LM::Parameters default_param;
+        if (!param)
+            param = &default_param;
+        results.resize(num_problems);
+
+        // each thread starts with an equal share of the problems
+        const std::size_t num = std::min(num_problems, static_cast<std::size_t>(num_threads_));
+        std::vector<Range> ranges(num);
+        for (std::size_t t = 0; t < num; ++t) {
+            ranges[t].begin = num_problems * t / num;
+            ranges[t].end = num_problems * (t + 1) / num;
+        }
+
+        auto worker = [&](std::size_t self) {
+            Workspace ws(m, n);
+            Problem problem = {objective, 0, param->loss};
+            while (next_problem(ranges, self, problem.index))
+                solve(problem, x.data() + problem.index * n, ws, *param, results[problem.index]);
+        };
+
+        for (std::size_t t = 1; t < num; ++t)
+            pool_->AddTask(worker, t);
+        worker(0);
+        if (pool_)
+            pool_->Wait();
+
+        return true;
+    }
+
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_OPTIMIZER_LM_BATCH_H
+#define EASY3D_OPTIMIZER_LM_BATCH_H
+
+#include <easy3d/optimizer/optimizer_lm.h>
+
+/**
+Optimizer_LM_Batch solves many independent small nonlinear least squares problems (e.g., the refinement of each
+triangulated point, or the pose of each camera) with the same Levenberg-Marquardt method as Optimizer_LM.
+
+All problems must have the same structure, i.e., the same numbers of functions and variables. They are distributed
+over a pool of threads, which is created with the optimizer and reused by all its optimize() calls. Each thread
+allocates its workspace only once per call. A thread takes the problems of its own range one by one, and when its range
+is exhausted, it steals half of the remaining range of the busiest thread. So the load stays balanced even if some
+problems take much longer than others.
+
+The problems are given either as one Objective_LM per problem, or as a single Objective_LM_Batch that evaluates any of
+them by its index. The latter doesn't need an object (and a copy of the shared data) per problem:
+
+    class PointObjective : public Objective_LM_Batch {
+    public:
+        PointObjective(const Data &data) : Objective_LM_Batch(4, 3), data_(data) {}
+        int evaluate(std::size_t problem, const double *x, double *fvec) const { ... }  // point 'problem' of data_
+        const Data &data_;
+    };
+    PointObjective objective(data);
+    batch.optimize(&objective, num_points, x, results);
+
+    std::vector<PointObjective> objectives = ...;   // Objective_LM with 4 functions and 3 variables each
+    std::vector<Objective_LM *> problems;
+    for (auto &obj : objectives)
+        problems.push_back(&obj);
+
+    std::vector<double> x = ...;                    // the initial guess of problem k is in x[3k], x[3k+1], x[3k+2]
+    std::vector<Optimizer_LM_Batch::Result> results;
+    Optimizer_LM_Batch batch;
+    batch.optimize(problems, x, results);           // x now holds the solutions
+
+@attention The problems are evaluated concurrently, so they must not share any mutable state.
+*/
+
+
+namespace easy3d {
+
+    class ThreadPool;
+
+
+    /// The objective of a batch of problems with the same structure, which usually share their data (e.g., the
+    /// cameras when refining many points). evaluate() is called concurrently for different problems, so it is const.
+    class Objective_LM_Batch {
+    public:
+        Objective_LM_Batch(int num_func, int num_var) : num_func_(num_func), num_var_(num_var) {}
+        virtual ~Objective_LM_Batch() {}
+
+        int num_function() const { return num_func_; }
+        int num_variables() const { return num_var_; }
+
+        /// evaluates the functions of a problem at x (its num_variables() variables), the same as
+        /// Objective_LM::evaluate().
+        virtual int evaluate(std::size_t problem, const double *x, double *fvec) const = 0;
+
+    private:
+        int num_func_;
+        int num_var_;
+    };
+
+
+    class Optimizer_LM_Batch {
+    public:
+        /// the outcome of a problem
+        struct Result {
+            int info;   // status of minimization (the same as Optimizer_LM::Parameters::info).
+            int nfev;   // actual number of iterations (i.e., evaluations of the functions).
+        };
+
+    public:
+        /// @param num_threads: the number of threads. All the logical cores are used if it is not positive.
+        explicit Optimizer_LM_Batch(int num_threads = -1);
+        ~Optimizer_LM_Batch();
+
+        int num_threads() const { return num_threads_; }
+
+        //  problems:   the problems, all with the same numbers of functions (m) and variables (n).
+        //  x:          the variables of all problems, i.e., those of the k_th problem are x[k * n] ... x[k * n + n - 1].
+        //              It should be initialized with the guess, and it also returns the results.
+        //  results:    the status and number of iterations of each problem.
+        //  param:      parameter for the optimizer (use default parameters if para is null). Its output fields (i.e.,
+        //              fnorm, nfev, and info) are not used, see results instead. Its loss (if any) is applied to every
+        //              problem, but the listener, the cancellation token, and the budgets are ignored.
+        //  return:     false if the problems don't have the same structure or x doesn't match their size.
+        bool optimize(const std::vector<Objective_LM *> &problems, std::vector<double> &x,
+                      std::vector<Result> &results, const Optimizer_LM::Parameters *param = nullptr);
+
+        // The same as above, but the 'num_problems' problems are evaluated by a single objective.
+        bool optimize(const Objective_LM_Batch *objective, std::size_t num_problems, std::vector<double> &x,
+                      std::vector<Result> &results, const Optimizer_LM::Parameters *param = nullptr);
+
+        // NOTE: the threads are shared by the calls, so an optimizer must not run optimize() concurrently.
+
+    private:
+        int num_threads_;
+        ThreadPool *pool_;  // the threads other than the calling one (null if there is only one thread)
+
+    private:
+        //copying disabled
+        Optimizer_LM_Batch(const Optimizer_LM_Batch&);
+        Optimizer_LM_Batch& operator=(const Optimizer_LM_Batch&);
+    };
+
+}
+
+#endif  // EASY3D_OPTIMIZER_LM_BATCH_H
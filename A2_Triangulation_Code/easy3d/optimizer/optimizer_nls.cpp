@@ -0,0 +1,605 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <easy3d/optimizer/optimizer_nls.h>
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+
+namespace easy3d {
+
+
+    Optimizer_NLS::Options::Options() {
+        strategy = STRATEGY_LEVENBERG_MARQUARDT;
+        linear_solver = LINEAR_DENSE_CHOLESKY;
+        ftol = 1.e-14;
+        xtol = 1.e-14;
+        gtol = 1.e-14;
+        epsilon = 1.e-14;
+        initial_radius = 100.;
+        initial_damping = 1.e-3;
+        max_iterations = 1000;
+        listener = nullptr;
+        cancel = nullptr;
+        loss = nullptr;
+    }
+
+
+    namespace {
+
+        const double machine_epsilon = std::numeric_limits<double>::epsilon();
+
+
+        double dot(const double *a, const double *b, int n) {
+            double sum = 0.0;
+            for (int i = 0; i < n; ++i)
+                sum += a[i] * b[i];
+            return sum;
+        }
+
+
+        double norm(const double *a, int n) {
+            return std::sqrt(dot(a, a, n));
+        }
+
+
+        // y = J * v, with J stored row by row (i.e., J(i, j) = J[i * n + j])
+        void mult(const double *J, const double *v, int m, int n, double *y) {
+            for (int i = 0; i < m; ++i)
+                y[i] = dot(J + i * n, v, n);
+        }
+
+
+        // y = J^T * v
+        void mult_transpose(const double *J, const double *v, int m, int n, double *y) {
+            std::fill(y, y + n, 0.0);
+            for (int i = 0; i < m; ++i) {
+                const double *row = J + i * n;
+                for (int j = 0; j < n; ++j)
+                    y[j] += row[j] * v[i];
+            }
+        }
+
+
+        // The linear least squares problem of a step, i.e., min ||J * dx + f||^2 + lambda * ||D * dx||^2 with a
+        // diagonal D. The Jacobian is set once, and the problem can then be solved for several lambda.
+        class LinearSystem {
+        public:
+            LinearSystem(Optimizer_NLS::LinearSolver solver, int m, int n)
+                    : solver_(solver), m_(m), n_(n), J_(nullptr), f_(nullptr) {
+                if (solver_ == Optimizer_NLS::LINEAR_DENSE_CHOLESKY) {
+                    JtJ_.resize(n * n);
+                    Jtf_.resize(n);
+                    A_.resize(n * n);
+                } else
+                    A_.resize((m + n) * n);
+                b_.resize(m + n);
+            }
+
+            void set(const double *J, const double *f) {
+                J_ = J;
+                f_ = f;
+                if (solver_ != Optimizer_NLS::LINEAR_DENSE_CHOLESKY)
+                    return;
+                // only the lower triangle of J^T * J is needed
+                std::fill(JtJ_.begin(), JtJ_.end(), 0.0);
+                for (int i = 0; i < m_; ++i) {
+                    const double *row = J + i * n_;
+                    for (int r = 0; r < n_; ++r) {
+                        for (int c = 0; c <= r; ++c)
+                            JtJ_[r * n_ + c] += row[r] * row[c];
+                    }
+                }
+                mult_transpose(J, f, m_, n_, Jtf_.data());
+            }
+
+            // d holds the diagonal of D. Returns false if the system is (numerically) singular.
+            bool solve(double lambda, const double *d, double *dx) {
+                return solver_ == Optimizer_NLS::LINEAR_DENSE_CHOLESKY ? cholesky(lambda, d, dx) : qr(lambda, d, dx);
+            }
+
+        private:
+            // (J^T * J + lambda * D^2) * dx = -J^T * f
+            bool cholesky(double lambda, const double *d, double *dx) {
+                const int n = n_;
+                double max_diagonal = 0.0;
+                for (int r = 0; r < n; ++r) {
+                    for (int c = 0; c < r; ++c)
+                        A_[r * n + c] = JtJ_[r * n + c];
+                    A_[r * n + r] = JtJ_[r * n + r] + lambda * d[r] * d[r];
+                    max_diagonal = std::max(max_diagonal, A_[r * n + r]);
+                }
+
+                // A = L * L^T, with L overwriting the lower triangle of A
+                const double threshold = n * machine_epsilon * max_diagonal;
+                for (int j = 0; j < n; ++j) {
+                    double pivot = A_[j * n + j] - dot(A_.data() + j * n, A_.data() + j * n, j);
+                    if (pivot <= threshold)
+                        return false;
+                    pivot = std::sqrt(pivot);
+                    A_[j * n + j] = pivot;
+                    for (int i = j + 1; i < n; ++i)
+                        A_[i * n + j] = (A_[i * n + j] - dot(A_.data() + i * n, A_.data() + j * n, j)) / pivot;
+                }
+
+                // L * y = -J^T * f, then L^T * dx = y
+                for (int i = 0; i < n; ++i)
+                    dx[i] = (-Jtf_[i] - dot(A_.data() + i * n, dx, i)) / A_[i * n + i];
+                for (int i = n - 1; i >= 0; --i) {
+                    double sum = dx[i];
+                    for (int k = i + 1; k < n; ++k)
+                        sum -= A_[k * n + i] * dx[k];
+                    dx[i] = sum / A_[i * n + i];
+                }
+                return true;
+            }
+
+            // the Householder QR decomposition of [J; sqrt(lambda) * D], applied to the right-hand side [-f; 0]
+            bool qr(double lambda, const double *d, double *dx) {
+                const int n = n_;
+                const int rows = (lambda > 0.0) ? m_ + n : m_;
+
+                // stored column by column, so the reflections run over contiguous memory
+                for (int j = 0; j < n; ++j) {
+                    double *col = A_.data() + j * rows;
+                    for (int i = 0; i < m_; ++i)
+                        col[i] = J_[i * n + j];
+                    for (int i = m_; i < rows; ++i)
+                        col[i] = 0.0;
+                    if (rows > m_)
+                        col[m_ + j] = std::sqrt(lambda) * d[j];
+                }
+                for (int i = 0; i < m_; ++i)
+                    b_[i] = -f_[i];
+                for (int i = m_; i < rows; ++i)
+                    b_[i] = 0.0;
+
+                double max_diagonal = 0.0;
+                for (int j = 0; j < n; ++j) {
+                    double *v = A_.data() + j * rows;
+                    const double alpha = norm(v + j, rows - j);
+                    if (alpha == 0.0)
+                        return false;
+                    const double beta = (v[j] > 0.0) ? -alpha : alpha;    // the new diagonal element
+                    v[j] -= beta;
+                    const double vv = dot(v + j, v + j, rows - j);
+                    for (int k = j + 1; k < n; ++k) {
+                        double *w = A_.data() + k * rows;
+                        const double s = 2.0 * dot(v + j, w + j, rows - j) / vv;
+                        for (int i = j; i < rows; ++i)
+                            w[i] -= s * v[i];
+                    }
+                    const double s = 2.0 * dot(v + j, b_.data() + j, rows - j) / vv;
+                    for (int i = j; i < rows; ++i)
+                        b_[i] -= s * v[i];
+                    v[j] = beta;
+                    max_diagonal = std::max(max_diagonal, std::fabs(beta));
+                }
+
+                // R * dx = (Q^T * b)[0 .. n)
+                const double threshold = rows * machine_epsilon * max_diagonal;
+                for (int i = n - 1; i >= 0; --i) {
+                    const double r_ii = A_[i * rows + i];
+                    if (std::fabs(r_ii) <= threshold)
+                        return false;
+                    double sum = b_[i];
+                    for (int k = i + 1; k < n; ++k)
+                        sum -= A_[k * rows + i] * dx[k];
+                    dx[i] = sum / r_ii;
+                }
+                return true;
+            }
+
+        private:
+            Optimizer_NLS::LinearSolver solver_;
+            int m_, n_;
+            const double *J_;
+            const double *f_;
+            std::vector<double> JtJ_, Jtf_;
+            std::vector<double> A_, b_;
+        };
+
+
+        // evaluates the objective and counts the evaluations
+        class Problem {
+        public:
+            explicit Problem(Objective_LM *func) : func_(func), evaluations_(0) {}
+
+            int num_function() const { return func_->num_function(); }
+
+            int num_variables() const { return func_->num_variables(); }
+
+            int evaluations() const { return evaluations_; }
+
+            // returns false if the objective asked to stop
+            bool evaluate(const double *x, double *f) {
+                ++evaluations_;
+                return func_->evaluate(x, f) >= 0;
+            }
+
+            // The Jacobian by forward differences, with the same steps as lmdif(). x is restored on return.
+            bool jacobian(double *x, const double *f, double epsilon, double *J, double *wa) {
+                const int m = num_function();
+                const int n = num_variables();
+                const double eps = std::sqrt(std::max(epsilon, machine_epsilon));
+                for (int j = 0; j < n; ++j) {
+                    const double temp = x[j];
+                    double h = eps * std::fabs(temp);
+                    if (h == 0.0)
+                        h = eps;
+                    x[j] = temp + h;
+                    const bool ok = evaluate(x, wa);
+                    x[j] = temp;
+                    if (!ok)
+                        return false;
+                    for (int i = 0; i < m; ++i)
+                        J[i * n + j] = (wa[i] - f[i]) / h;
+                }
+                return true;
+            }
+
+        private:
+            Objective_LM *func_;
+            int evaluations_;
+        };
+
+    }
+
+
+    bool Optimizer_NLS::optimize(Objective_LM *func, double *x, const Options &options, Summary *summary) {
+        Summary local_summary;
+        if (!summary)
+            summary = &local_summary;
+        summary->termination = Optimizer_LM::INVALID_INPUT;
+        summary->iterations = 0;
+        summary->evaluations = 0;
+        summary->linear_solves = 0;
+        summary->initial_cost = 0.0;
+        summary->final_cost = 0.0;
+
+        Problem problem(func);
+        const int m = problem.num_function();
+        const int n = problem.num_variables();
+        if (n <= 0 || m < n || options.ftol < 0.0 || options.xtol < 0.0 || options.gtol < 0.0 ||
+            options.max_iterations <= 0)
+            return false;
+
+        std::vector<double> f(m), f_new(m), J(m * n), Jh(m), wa(m);
+        std::vector<double> g(n), d(n, 0.0), h(n), h_gn(n), x_new(n);
+        LinearSystem system(options.linear_solver, m, n);
+
+        // With a robust loss, the cost is Sum_i rho(f_i^2), and each step solves the weighted problem, i.e., the rows
+        // of f and J are scaled by the square roots of the weights rho'(f_i^2) at the current x.
+        const RobustLoss *loss = (options.loss && options.loss->type() != RobustLoss::LOSS_TRIVIAL) ? options.loss
+                                                                                                     : nullptr;
+        std::vector<double> fw(loss ? m : 0), Jw(loss ? m * n : 0);
+        auto robust_cost = [&](const double *fvec) -> double {
+            if (!loss)
+                return dot(fvec, fvec, m);
+            double sum = 0.0;
+            for (int i = 0; i < m; ++i)
+                sum += loss->rho(fvec[i] * fvec[i]);
+            return sum;
+        };
+
+        std::chrono::steady_clock::time_point start;
+        if (options.listener)
+            start = std::chrono::steady_clock::now();
+
+        if (!problem.evaluate(x, f.data())) {
+            summary->termination = Optimizer_LM::STOPPED_BY_OBJECTIVE;
+            summary->evaluations = problem.evaluations();
+            return false;
+        }
+        double cost = robust_cost(f.data());
+        summary->initial_cost = cost;
+
+        Optimizer_LM::Termination termination = Optimizer_LM::MAX_CALLS_REACHED;
+        double mu = -1.0, nu = 2.0;     // the damping of Levenberg-Marquardt and its growth factor
+        double radius = -1.0;           // the trust region radius of the dogleg
+        for (int iter = 0; iter < options.max_iterations; ++iter) {
+            if (options.cancel && options.cancel->is_cancelled()) {
+                termination = Optimizer_LM::CANCELLED;
+                break;
+            }
+            if (!problem.jacobian(x, f.data(), options.epsilon, J.data(), wa.data())) {
+                termination = Optimizer_LM::STOPPED_BY_OBJECTIVE;
+                break;
+            }
+            ++summary->iterations;
+
+            // the (weighted) linear model of this iteration, i.e., ||fr + Jr * h||^2
+            const double *fr = f.data();
+            const double *Jr = J.data();
+            if (loss) {
+                for (int i = 0; i < m; ++i) {
+                    const double w = std::sqrt(loss->weight(f[i] * f[i]));
+                    fw[i] = w * f[i];
+                    for (int j = 0; j < n; ++j)
+                        Jw[i * n + j] = w * J[i * n + j];
+                }
+                fr = fw.data();
+                Jr = Jw.data();
+            }
+            const double model_cost = dot(fr, fr, m);   // equal to cost without a loss
+
+            // the scaling of the variables, i.e., the largest column norms of J so far (like mode 1 of lmdif())
+            for (int j = 0; j < n; ++j) {
+                double s = 0.0;
+                for (int i = 0; i < m; ++i)
+                    s += Jr[i * n + j] * Jr[i * n + j];
+                d[j] = std::max(d[j], std::sqrt(s));
+            }
+
+            // converged if f is orthogonal to the columns of J, i.e., the gradient J^T * f vanishes
+            mult_transpose(Jr, fr, m, n, g.data());
+            const double fnorm = std::sqrt(model_cost);
+            double gnorm = 0.0;
+            for (int j = 0; j < n; ++j) {
+                double s = 0.0;
+                for (int i = 0; i < m; ++i)
+                    s += Jr[i * n + j] * Jr[i * n + j];
+                if (s > 0.0 && fnorm > 0.0)
+                    gnorm = std::max(gnorm, std::fabs(g[j]) / (std::sqrt(s) * fnorm));
+            }
+            if (gnorm <= options.gtol) {
+                termination = Optimizer_LM::CONVERGED_GTOL;
+                break;
+            }
+
+            system.set(Jr, fr);
+            const double xnorm = norm(x, n);
+            const double xtol = options.xtol * (xnorm + options.xtol);
+
+            // the steepest descent step to the minimum along -g (i.e., the Cauchy point)
+            mult(Jr, g.data(), m, n, Jh.data());
+            const double g2 = dot(g.data(), g.data(), n);
+            const double Jg2 = dot(Jh.data(), Jh.data(), m);
+            const double alpha = (Jg2 > 0.0) ? g2 / Jg2 : 0.0;
+
+            // Tries x + h, i.e., evaluates it and predicts the new cost by the linear model ||fr + Jr * h||^2.
+            // Returns false if the objective asked to stop.
+            double cost_new = 0.0, predicted = 0.0;
+            auto try_step = [&]() -> bool {
+                for (int j = 0; j < n; ++j)
+                    x_new[j] = x[j] + h[j];
+                if (!problem.evaluate(x_new.data(), f_new.data()))
+                    return false;
+                cost_new = robust_cost(f_new.data());
+                mult(Jr, h.data(), m, n, Jh.data());
+                predicted = 0.0;
+                for (int i = 0; i < m; ++i)
+                    predicted += (fr[i] + Jh[i]) * (fr[i] + Jh[i]);
+                return true;
+            };
+
+            bool accepted = false;
+            bool stop = false;
+            double hnorm = 0.0;
+            double damping = -1.0;
+            switch (options.strategy) {
+                case STRATEGY_LEVENBERG_MARQUARDT: {
+                    // the damping is relative to D^2, i.e., (the largest so far of) the diagonal of J^T * J
+                    if (mu < 0.0)
+                        mu = options.initial_damping;
+                    while (!accepted && !stop) {
+                        ++summary->linear_solves;
+                        if (system.solve(mu, d.data(), h.data())) {
+                            hnorm = norm(h.data(), n);
+                            if (hnorm <= xtol) {
+                                termination = Optimizer_LM::CONVERGED_XTOL;
+                                stop = true;
+                                break;
+                            }
+                            if (!try_step()) {
+                                termination = Optimizer_LM::STOPPED_BY_OBJECTIVE;
+                                stop = true;
+                                break;
+                            }
+                            const double rho = (model_cost - predicted > 0.0) ?
+                                               (cost - cost_new) / (model_cost - predicted) : -1.0;
+                            if (rho > 0.0) {
+                                const double t = 2.0 * rho - 1.0;
+                                mu *= std::max(1.0 / 3.0, 1.0 - t * t * t);
+                                nu = 2.0;
+                                accepted = true;
+                                break;
+                            }
+                        }
+                        mu *= nu;
+                        nu *= 2.0;
+                        if (!std::isfinite(mu) || mu > 1.0 / machine_epsilon) {
+                            termination = Optimizer_LM::XTOL_TOO_SMALL;
+                            stop = true;
+                        }
+                    }
+                    damping = mu;
+                    break;
+                }
+
+                case STRATEGY_DOGLEG: {
+                    if (radius < 0.0)
+                        radius = options.initial_radius * (xnorm > 0.0 ? xnorm : 1.0);
+                    // the Gauss-Newton step is computed only once for all the trials of this Jacobian
+                    ++summary->linear_solves;
+                    const bool has_gn = system.solve(0.0, d.data(), h_gn.data());
+                    const double gn_norm = has_gn ? norm(h_gn.data(), n) : 0.0;
+                    const double sd_norm = alpha * std::sqrt(g2);
+                    while (!accepted && !stop) {
+                        if (has_gn && gn_norm <= radius)
+                            h = h_gn;
+                        else if (!has_gn || sd_norm >= radius) {
+                            const double s = std::min(radius, sd_norm) / std::sqrt(g2);
+                            for (int j = 0; j < n; ++j)
+                                h[j] = -s * g[j];
+                        } else {
+                            // from the Cauchy point a towards the Gauss-Newton step b, up to the boundary
+                            double c = 0.0, bma2 = 0.0;
+                            for (int j = 0; j < n; ++j) {
+                                const double a = -alpha * g[j];
+                                c += a * (h_gn[j] - a);
+                                bma2 += (h_gn[j] - a) * (h_gn[j] - a);
+                            }
+                            const double beta = (-c + std::sqrt(c * c + bma2 * (radius * radius - sd_norm * sd_norm)))
+                                                / bma2;
+                            for (int j = 0; j < n; ++j) {
+                                const double a = -alpha * g[j];
+                                h[j] = a + beta * (h_gn[j] - a);
+                            }
+                        }
+
+                        hnorm = norm(h.data(), n);
+                        if (hnorm <= xtol) {
+                            termination = Optimizer_LM::CONVERGED_XTOL;
+                            stop = true;
+                            break;
+                        }
+                        if (!try_step()) {
+                            termination = Optimizer_LM::STOPPED_BY_OBJECTIVE;
+                            stop = true;
+                            break;
+                        }
+                        const double rho = (model_cost - predicted > 0.0) ?
+                                           (cost - cost_new) / (model_cost - predicted) : -1.0;
+                        if (rho > 0.75)
+                            radius = std::max(radius, 3.0 * hnorm);
+                        else if (rho < 0.25)
+                            radius = 0.5 * hnorm;
+                        accepted = (rho > 0.0);
+                    }
+                    break;
+                }
+
+                case STRATEGY_GAUSS_NEWTON: {
+                    // the steepest descent step is taken where the Jacobian is rank deficient
+                    ++summary->linear_solves;
+                    if (!system.solve(0.0, d.data(), h_gn.data())) {
+                        for (int j = 0; j < n; ++j)
+                            h_gn[j] = -alpha * g[j];
+                    }
+                    for (double t = 1.0; !accepted && !stop; t *= 0.5) {
+                        for (int j = 0; j < n; ++j)
+                            h[j] = t * h_gn[j];
+                        hnorm = norm(h.data(), n);
+                        if (hnorm <= xtol) {
+                            termination = Optimizer_LM::CONVERGED_XTOL;
+                            stop = true;
+                            break;
+                        }
+                        if (!try_step()) {
+                            termination = Optimizer_LM::STOPPED_BY_OBJECTIVE;
+                            stop = true;
+                            break;
+                        }
+                        accepted = (cost_new < cost);
+                    }
+                    damping = 0.0;
+                    break;
+                }
+            }
+
+            if (!accepted)
+                break;
+
+            const double reduction = cost - cost_new;
+            std::copy(x_new.begin(), x_new.end(), x);
+            f.swap(f_new);
+            cost = cost_new;
+
+            if (options.listener) {
+                IterationInfo info;
+                info.iteration = iter + 1;
+                info.cost = cost;
+                info.step_norm = hnorm;
+                info.damping = damping;
+                info.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                info.evaluations = problem.evaluations();
+                info.x = x;
+                if (!options.listener->iteration(info)) {
+                    termination = Optimizer_LM::STOPPED_BY_LISTENER;
+                    break;
+                }
+            }
+
+            const bool ftol_reached = (reduction <= options.ftol * (cost + reduction));
+            const bool xtol_reached = (hnorm <= options.xtol * (norm(x, n) + options.xtol));
+            if (ftol_reached || xtol_reached) {
+                if (ftol_reached && xtol_reached)
+                    termination = Optimizer_LM::CONVERGED_FTOL_XTOL;
+                else
+                    termination = ftol_reached ? Optimizer_LM::CONVERGED_FTOL : Optimizer_LM::CONVERGED_XTOL;
+                break;
+            }
+        }
+
+        summary->termination = termination;
+        summary->evaluations = problem.evaluations();
+        summary->final_cost = cost;
+
+        switch (termination) {
+            case Optimizer_LM::CONVERGED_FTOL:
+            case Optimizer_LM::CONVERGED_XTOL:
+            case Optimizer_LM::CONVERGED_FTOL_XTOL:
+            case Optimizer_LM::CONVERGED_GTOL:
+            case Optimizer_LM::XTOL_TOO_SMALL:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+
+    bool Optimizer_NLS::optimize(Objective_LM *func, std::vector<double> &x, const Options &options,
+                                 Summary *summary) {
+        return optimize(func, x.data(), options, summary);
+    }
+
+
+    const char *Optimizer_NLS::name(Strategy strategy) {
+        switch (strategy) {
+            case STRATEGY_LEVENBERG_MARQUARDT:
+                return "Levenberg-Marquardt";
+            case STRATEGY_DOGLEG:
+                return "dogleg";
+            case STRATEGY_GAUSS_NEWTON:
+                return "Gauss-Newton";
+        }
+        return "unknown";
+    }
+
+
+    const char *Optimizer_NLS::name(LinearSolver solver) {
+        switch (solver) {
+            case LINEAR_DENSE_CHOLESKY:
+                return "Cholesky";
+            case LINEAR_DENSE_QR:
+                return "QR";
+        }
+        return "unknown";
+    }
+
+}
@@ -0,0 +1,140 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_OPTIMIZER_NLS_H
+#define EASY3D_OPTIMIZER_NLS_H
+
+#include <easy3d/optimizer/optimizer_lm.h>
+
+/**
+Optimizer_NLS solves the same nonlinear least squares problems as Optimizer_LM (i.e., an Objective_LM), but with a
+choice of the strategy that computes the steps and of the linear solver behind it:
+
+    strategies:
+        - STRATEGY_LEVENBERG_MARQUARDT: the damped Gauss-Newton step, i.e., (J^T J + mu * D) dx = -J^T f, where the
+          damping mu is adapted to how well the linear model predicts the reduction of the cost. A rejected step costs
+          another linear solve.
+        - STRATEGY_DOGLEG: Powell's dogleg, i.e., a combination of the Gauss-Newton step and the steepest descent step
+          that fits in a trust region. The Gauss-Newton step is only computed once per Jacobian, so a rejected step
+          doesn't need another linear solve. For well-conditioned problems with small residuals (e.g., triangulation
+          and calibration), it usually needs fewer linear solves than Levenberg-Marquardt.
+        - STRATEGY_GAUSS_NEWTON: the plain Gauss-Newton step, halved until the cost decreases. It converges fastest
+          near the solution, but is the least robust from a poor initial guess.
+    linear solvers:
+        - LINEAR_DENSE_CHOLESKY: the Cholesky decomposition of the normal equations. It is the fastest, but squares
+          the condition number of J.
+        - LINEAR_DENSE_QR: the Householder QR decomposition of J (augmented by the damping), which is more accurate
+          for ill-conditioned problems.
+
+The Jacobian is approximated by forward differences (like lmdif()), so any Objective_LM can be used without changes.
+With a robust loss (see RobustLoss), each step is computed by iteratively reweighted least squares, i.e., the functions
+and the Jacobian are scaled by the weights of the current residuals.
+
+    Objective obj(3, 2);
+    std::vector<double> x = {4.0, -4.0};
+    Optimizer_NLS::Options options;
+    options.strategy = Optimizer_NLS::STRATEGY_DOGLEG;
+    Optimizer_NLS::Summary summary;
+    Optimizer_NLS solver;
+    bool converged = solver.optimize(&obj, x, options, &summary);
+    std::cout << summary.iterations << " iterations, "
+              << Optimizer_LM::termination_message(summary.termination) << std::endl;
+*/
+
+
+namespace easy3d {
+
+
+    class Optimizer_NLS {
+    public:
+        /// how the steps are computed
+        enum Strategy {
+            STRATEGY_LEVENBERG_MARQUARDT,
+            STRATEGY_DOGLEG,
+            STRATEGY_GAUSS_NEWTON
+        };
+
+        /// how the linear least squares problem of each step is solved
+        enum LinearSolver {
+            LINEAR_DENSE_CHOLESKY,
+            LINEAR_DENSE_QR
+        };
+
+        struct Options {
+            Options();
+
+            Strategy strategy;
+            LinearSolver linear_solver;
+
+            double ftol;            // relative reduction of the sum of squares to stop at.
+            double xtol;            // relative change of the variables to stop at.
+            double gtol;            // orthogonality desired between fvec and its derivs.
+            double epsilon;         // relative step used to calculate the Jacobian (the same as lmdif()).
+            double initial_radius;  // the initial trust region radius of the dogleg (relative to the norm of x).
+            double initial_damping; // the initial damping of Levenberg-Marquardt (relative to the diagonal of J^T J).
+            int max_iterations;     // the maximum number of iterations (i.e., of Jacobians).
+
+            IterationListener *listener;        // receives the progress after each iteration (none by default).
+            const CancellationToken *cancel;    // stops the optimization when it is cancelled (none by default).
+            const RobustLoss *loss;             // the loss of the residuals (the squared error by default).
+        };
+
+        struct Summary {
+            Optimizer_LM::Termination termination;  // why it stopped (MAX_CALLS_REACHED for max_iterations).
+            int iterations;         // the number of iterations, i.e., of computed Jacobians.
+            int evaluations;        // the number of evaluations of the functions (including those for the Jacobians).
+            int linear_solves;      // the number of solved linear systems.
+            double initial_cost;    // the sum of the squared function values (or their losses) at the initial guess.
+            double final_cost;      // the sum of the squared function values (or their losses) at the solution.
+        };
+
+    public:
+        Optimizer_NLS() {}
+
+        //  func:       your evaluate function (no need to provide Jacobian)
+        //  x:          the variable vector (should be initialized with guess), which also returns the result.
+        //  options:    the strategy, the linear solver, and the stopping criteria.
+        //  summary:    returns the statistics of the optimization (ignored if it is null).
+        //  return:     true if it converged, see Summary::termination for why it stopped. x carries the best solution
+        //              found so far in any case.
+        bool optimize(Objective_LM *func, double *x, const Options &options, Summary *summary = nullptr);
+
+        bool optimize(Objective_LM *func, std::vector<double> &x, const Options &options,
+                      Summary *summary = nullptr);
+
+        /// the name of a strategy or a linear solver (e.g., for printing)
+        static const char *name(Strategy strategy);
+
+        static const char *name(LinearSolver solver);
+
+    private:
+        //copying disabled
+        Optimizer_NLS(const Optimizer_NLS &);
+
+        Optimizer_NLS &operator=(const Optimizer_NLS &);
+    };
+
+}
+
+#endif  // EASY3D_OPTIMIZER_NLS_H
@@ -0,0 +1,123 @@
+/**
+ * Copyright (C) 2015 by Liangliang Nan (liangliang.nan@gmail.com)
+ * https://3d.bk.tudelft.nl/liangliang/
+ *
+ * This file is part of Easy3D. If it is useful in your research/work,
+ * I would be grateful if you show your appreciation by citing it:
+ * ------------------------------------------------------------------
+ *      Liangliang Nan.
+ *      Easy3D: a lightweight, easy-to-use, and efficient C++
+ *      library for processing and rendering 3D data. 2018.
+ * ------------------------------------------------------------------
+ * Easy3D is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 3
+ * as published by the Free Software Foundation.
+ *
+ * Easy3D is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EASY3D_OPTIMIZER_ROBUST_LOSS_H
+#define EASY3D_OPTIMIZER_ROBUST_LOSS_H
+
+#include <cmath>
+
+/**
+RobustLoss reduces the influence of large residuals (e.g., of wrong matches), i.e., the optimizers minimize
+Sum_i rho(f_i^2) instead of Sum_i f_i^2. The losses behave like the squared error for residuals well below the scale c:
+    - LOSS_HUBER:   rho(s) = s for s <= c^2, 2c * sqrt(s) - c^2 otherwise (i.e., linear growth for outliers).
+    - LOSS_CAUCHY:  rho(s) = c^2 * log(1 + s / c^2) (i.e., logarithmic growth).
+    - LOSS_TUKEY:   rho(s) = c^2 / 3 * (1 - (1 - s / c^2)^3) for s <= c^2, c^2 / 3 otherwise (i.e., outliers have no
+                    influence at all, but the cost is not convex, so it needs a good initial guess).
+
+The objectives don't have to change, the loss is applied by the optimizer:
+
+    RobustLoss loss(RobustLoss::LOSS_HUBER, 2.0);   // residuals (e.g., in pixels) beyond 2 are outliers
+    Optimizer_LM::Parameters param;
+    param.loss = &loss;
+    lm.optimize(&obj, x, &param);
+*/
+
+
+namespace easy3d {
+
+
+    class RobustLoss {
+    public:
+        enum Type {
+            LOSS_TRIVIAL,   // the squared error, i.e., rho(s) = s
+            LOSS_HUBER,
+            LOSS_CAUCHY,
+            LOSS_TUKEY
+        };
+
+    public:
+        /// @param scale: the residual at which the loss starts to differ from the squared error.
+        explicit RobustLoss(Type type = LOSS_TRIVIAL, double scale = 1.0)
+                : type_(type), c_(scale), c2_(scale * scale) {}
+
+        Type type() const { return type_; }
+
+        double scale() const { return c_; }
+
+        /// the loss rho(s) of a squared residual s
+        double rho(double s) const {
+            switch (type_) {
+                case LOSS_HUBER:
+                    return s <= c2_ ? s : 2.0 * c_ * std::sqrt(s) - c2_;
+                case LOSS_CAUCHY:
+                    return c2_ * std::log1p(s / c2_);
+                case LOSS_TUKEY: {
+                    if (s > c2_)
+                        return c2_ / 3.0;
+                    const double t = 1.0 - s / c2_;
+                    return c2_ / 3.0 * (1.0 - t * t * t);
+                }
+                default:
+                    return s;
+            }
+        }
+
+        /// the weight of a squared residual s in iteratively reweighted least squares, i.e., rho'(s)
+        double weight(double s) const {
+            switch (type_) {
+                case LOSS_HUBER:
+                    return s <= c2_ ? 1.0 : c_ / std::sqrt(s);
+                case LOSS_CAUCHY:
+                    return 1.0 / (1.0 + s / c2_);
+                case LOSS_TUKEY: {
+                    if (s > c2_)
+                        return 0.0;
+                    const double t = 1.0 - s / c2_;
+                    return t * t;
+                }
+                default:
+                    return 1.0;
+            }
+        }
+
+        /// Replaces the residuals f_i by sign(f_i) * sqrt(rho(f_i^2)), so the sum of their squares is the robust cost.
+        /// This is how the loss is applied in solvers that only see the residuals (e.g., lmdif()).
+        void apply(double *fvec, int num_func) const {
+            if (type_ == LOSS_TRIVIAL)
+                return;
+            for (int i = 0; i < num_func; ++i) {
+                const double r = std::sqrt(rho(fvec[i] * fvec[i]));
+                fvec[i] = fvec[i] < 0.0 ? -r : r;
+            }
+        }
+
+    private:
+        Type type_;
+        double c_;
+        double c2_;
+    };
+
+}
+
+#endif  // EASY3D_OPTIMIZER_ROBUST_LOSS_H